@@ -0,0 +1,15 @@
+################################################################################
+#####
+##### Tectiform TFLinux CMake Configuration File
+##### Created by: Steve Wilson
+#####
+################################################################################
+
+function(build_benchmark BINARY_NAME SOURCES)
+    add_executable(${BINARY_NAME} ${SOURCES})
+    target_compile_options(${BINARY_NAME} PRIVATE ${COMPILE_OPTIONS})
+    target_link_libraries(${BINARY_NAME} PRIVATE ${STATIC_LIBRARY_NAME})
+    if(BENCHMARK_LIBRARIES)
+        target_link_libraries(${BINARY_NAME} PRIVATE ${BENCHMARK_LIBRARIES})
+    endif()
+endfunction()
@@ -0,0 +1,12 @@
+################################################################################
+#####
+##### Tectiform TFLinux CMake Configuration File
+##### Created by: Steve Wilson
+#####
+################################################################################
+
+include_directories(benchmarks/support)
+
+include(benchmarks/cmake/config.cmake)
+include(benchmarks/files/config.cmake)
+include(benchmarks/udev/config.cmake)
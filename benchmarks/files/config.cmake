@@ -0,0 +1,16 @@
+################################################################################
+#####
+##### Tectiform TFLinux CMake Configuration File
+##### Created by: Steve Wilson
+#####
+################################################################################
+
+build_benchmark(
+        files_observer_latency_benchmark
+        benchmarks/files/observer_latency_benchmark.cpp
+)
+
+build_benchmark(
+        files_permission_benchmark
+        benchmarks/files/permission_benchmark.cpp
+)
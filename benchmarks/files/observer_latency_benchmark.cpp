@@ -0,0 +1,141 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <semaphore>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux;
+using namespace TF::Linux::Benchmark;
+
+namespace
+{
+    /**
+     * Print the percentiles of a list of latencies in nanoseconds.
+     */
+    void report_latencies(const std::string & name, std::vector<int64_t> & latencies)
+    {
+        if (latencies.empty())
+        {
+            return;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << name << " latency_us p50=" << percentile(latencies, 0.5) / 1000.0
+                  << " p99=" << percentile(latencies, 0.99) / 1000.0 << " max=" << percentile(latencies, 1.0) / 1000.0
+                  << std::endl;
+    }
+} // namespace
+
+/**
+ * Measure the latency from write() on a marked file to the FileObserver callback for the event,
+ * and from stop() to run() returning for an idle observer.  fanotify needs CAP_SYS_ADMIN.
+ *
+ * usage: files_observer_latency_benchmark [writes] [path]
+ */
+int main(int argc, char ** argv)
+{
+    size_t write_count = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 10000;
+    std::string path = argc > 2 ? argv[2] : "/tmp/files_observer_latency_benchmark.data";
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "cannot create " << path << std::endl;
+        return 1;
+    }
+
+    FileObserver observer{FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK, O_RDONLY | O_CLOEXEC};
+    observer.mark(String{path.c_str()}, FAN_MARK_ADD, FAN_MODIFY);
+
+    // The writer waits for the callback before the next write so that events are not merged.
+    std::binary_semaphore delivered{0};
+    std::atomic<clock_type::rep> write_time{0};
+    std::vector<int64_t> latencies;
+    latencies.reserve(write_count);
+
+    auto start = clock_type::now();
+    std::thread writer{[&]() {
+        for (size_t i = 0; i < write_count; i++)
+        {
+            write_time = clock_type::now().time_since_epoch().count();
+            (void)!write(fd, "x", 1);
+            delivered.acquire();
+        }
+        observer.stop();
+    }};
+
+    observer.run([&](FileObserver::event_metadata_type * event) {
+        auto latency = clock_type::now() - clock_type::time_point{clock_type::duration{write_time.load()}};
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        if (event->fd >= 0)
+        {
+            (void)close(event->fd);
+        }
+        delivered.release();
+    });
+    auto elapsed = clock_type::now() - start;
+    writer.join();
+    (void)close(fd);
+    (void)unlink(path.c_str());
+
+    report(std::cout, Result{"write to callback", 1, latencies.size(), elapsed});
+    report_latencies("write to callback", latencies);
+
+    auto statistics = observer.get_statistics();
+    std::cout << "reads=" << statistics.reads << " events_per_read=" << statistics.get_events_per_read()
+              << " reads_per_second=" << statistics.get_reads_per_second() << std::endl;
+
+    std::vector<int64_t> stop_latencies;
+    for (size_t i = 0; i < 100; i++)
+    {
+        clock_type::time_point stop_time{};
+        std::thread stopper{[&observer, &stop_time]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            stop_time = clock_type::now();
+            observer.stop();
+        }};
+        observer.run([](FileObserver::event_metadata_type *) {});
+        stop_latencies.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - stop_time).count());
+        stopper.join();
+    }
+    report_latencies("stop to return", stop_latencies);
+
+    return 0;
+}
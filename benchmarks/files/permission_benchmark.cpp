@@ -0,0 +1,134 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux;
+using namespace TF::Linux::Benchmark;
+
+namespace
+{
+    /**
+     * Open a file guarded by FAN_OPEN_PERM repeatedly and report the open() latency, with a
+     * decision callback that takes @e decision_time to decide.
+     */
+    void run_opens(const std::string & name, const std::string & path, size_t open_count,
+                   std::chrono::microseconds decision_time, size_t cache_capacity)
+    {
+        FileObserver observer{FAN_CLASS_CONTENT | FAN_CLOEXEC, O_RDONLY | O_CLOEXEC};
+        observer.mark(String{path.c_str()}, FAN_MARK_ADD, FAN_OPEN_PERM);
+
+        FilePermissionHandler::Options options{};
+        options.cache_capacity = cache_capacity;
+        FilePermissionHandler handler{observer,
+                                      [decision_time](FileEvent &) {
+                                          // Stand in for scanning the file.
+                                          auto end = clock_type::now() + decision_time;
+                                          while (clock_type::now() < end)
+                                          {
+                                          }
+                                          return FilePermissionHandler::Verdict::ALLOW;
+                                      },
+                                      options};
+
+        std::thread runner{[&observer, &handler]() {
+            observer.run([&handler](FileObserver::event_list_type events) {
+                handler.handle(events);
+            });
+        }};
+
+        std::vector<int64_t> latencies;
+        latencies.reserve(open_count);
+        auto start = clock_type::now();
+        for (size_t i = 0; i < open_count; i++)
+        {
+            auto open_start = clock_type::now();
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            latencies.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - open_start).count());
+            if (fd >= 0)
+            {
+                (void)close(fd);
+            }
+        }
+        auto elapsed = clock_type::now() - start;
+        observer.stop();
+        runner.join();
+
+        report(std::cout, Result{name, 1, latencies.size(), elapsed});
+        if (latencies.empty())
+        {
+            return;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        auto statistics = handler.get_statistics();
+        std::cout << "    open_latency_us p50=" << percentile(latencies, 0.5) / 1000.0
+                  << " p99=" << percentile(latencies, 0.99) / 1000.0 << " max=" << percentile(latencies, 1.0) / 1000.0
+                  << " cache_hits=" << statistics.cache_hits << " cache_misses=" << statistics.cache_misses
+                  << std::endl;
+    }
+} // namespace
+
+/**
+ * Measure the open() latency of a file guarded by FAN_OPEN_PERM when every open is decided by
+ * the callback and when unchanged files are answered from the verdict cache.  fanotify
+ * permission events need CAP_SYS_ADMIN.
+ *
+ * usage: files_permission_benchmark [opens] [decision_us] [path]
+ */
+int main(int argc, char ** argv)
+{
+    size_t open_count = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 10000;
+    std::chrono::microseconds decision_time{argc > 2 ? std::strtol(argv[2], nullptr, 10) : 50};
+    std::string path = argc > 3 ? argv[3] : "/tmp/files_permission_benchmark.data";
+
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+    {
+        std::cerr << "cannot create " << path << std::endl;
+        return 1;
+    }
+    (void)!write(fd, "data", 4);
+    (void)close(fd);
+
+    run_opens("decide every open", path, open_count, decision_time, 0);
+    run_opens("verdict cache", path, open_count, decision_time, FilePermissionHandler::DEFAULT_CACHE_CAPACITY);
+
+    (void)unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFBENCHMARK_HPP
+#define TFBENCHMARK_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace TF::Linux::Benchmark
+{
+
+    using clock_type = std::chrono::steady_clock;
+
+    /**
+     * The Result struct records the outcome of one timed benchmark run.
+     */
+    struct Result
+    {
+        std::string name;
+        size_t iterations;
+        size_t items;
+        clock_type::duration elapsed;
+    };
+
+    /**
+     * @brief function to time a callable.
+     * @param name the name reported for the run
+     * @param iterations the number of times to call @e f
+     * @param f the callable, it returns the number of items it processed in one call.
+     * @return the result of the run.
+     */
+    template<typename CALLABLE>
+    Result measure(const std::string & name, size_t iterations, CALLABLE && f)
+    {
+        size_t items{0};
+        auto start = clock_type::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            items += static_cast<size_t>(f());
+        }
+        auto end = clock_type::now();
+        return Result{name, iterations, items, end - start};
+    }
+
+    /**
+     * @brief function to write a result to a stream as one line of a report.
+     * @param o the stream
+     * @param result the result
+     */
+    inline void report(std::ostream & o, const Result & result)
+    {
+        using namespace std::chrono;
+        auto total_ns = static_cast<double>(duration_cast<nanoseconds>(result.elapsed).count());
+        auto per_iteration_us = result.iterations > 0 ? total_ns / static_cast<double>(result.iterations) / 1000.0 : 0.0;
+        auto per_item_ns = result.items > 0 ? total_ns / static_cast<double>(result.items) : 0.0;
+
+        o << std::left << std::setw(48) << result.name << std::right << std::fixed << std::setprecision(3)
+          << " iterations=" << result.iterations << " items=" << result.items << " total_ms=" << total_ns / 1.0e6
+          << " per_iteration_us=" << per_iteration_us << " per_item_ns=" << per_item_ns << std::endl;
+    }
+
+    /**
+     * @brief function to compare two results and write the speedup of @e candidate over @e baseline.
+     * @param o the stream
+     * @param baseline the baseline result
+     * @param candidate the result being compared with the baseline
+     */
+    inline void report_speedup(std::ostream & o, const Result & baseline, const Result & candidate)
+    {
+        auto baseline_count = static_cast<double>(baseline.elapsed.count());
+        auto candidate_count = static_cast<double>(candidate.elapsed.count());
+        if (candidate_count > 0.0)
+        {
+            o << candidate.name << " vs " << baseline.name << ": " << std::fixed << std::setprecision(2)
+              << baseline_count / candidate_count << "x" << std::endl;
+        }
+    }
+
+    /**
+     * @brief function to get a percentile of a list of samples.
+     * @param sorted_samples the samples, sorted in ascending order.
+     * @param p the percentile as a fraction, 0.5 for the median and 1.0 for the maximum.
+     * @return the sample at @e p, or 0 if there are no samples.
+     */
+    template<typename T>
+    double percentile(const std::vector<T> & sorted_samples, double p)
+    {
+        if (sorted_samples.empty())
+        {
+            return 0.0;
+        }
+        auto index = static_cast<size_t>(std::clamp(p, 0.0, 1.0) * static_cast<double>(sorted_samples.size() - 1));
+        return static_cast<double>(sorted_samples[index]);
+    }
+
+} // namespace TF::Linux::Benchmark
+
+#endif // TFBENCHMARK_HPP
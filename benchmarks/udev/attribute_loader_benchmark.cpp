@@ -0,0 +1,98 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+/**
+ * Compare the FileManager based Device::load_attributes_from_device_path with the directory
+ * descriptor based Device::load_attributes_from_sysfs over every device in the block subsystem.
+ *
+ * usage: udev_attribute_loader_benchmark [iterations]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 10;
+
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+
+    std::vector<Device> devices;
+    for (auto & path : query.run())
+    {
+        devices.emplace_back(context, path);
+    }
+
+    std::cout << "block devices: " << devices.size() << std::endl;
+
+    // Sanity check that both loaders agree on the attribute names before timing them.
+    size_t mismatches{0};
+    for (auto & device : devices)
+    {
+        auto file_manager_map = device.load_attributes_from_device_path();
+        auto sysfs_map = device.load_attributes_from_sysfs();
+        if (file_manager_map.size() != sysfs_map.size())
+        {
+            std::cout << "attribute count mismatch for " << device << ": " << file_manager_map.size() << " vs "
+                      << sysfs_map.size() << std::endl;
+            mismatches++;
+        }
+    }
+
+    auto file_manager_result = measure("load_attributes_from_device_path", iterations, [&devices]() {
+        size_t attributes{0};
+        for (auto & device : devices)
+        {
+            attributes += device.load_attributes_from_device_path().size();
+        }
+        return attributes;
+    });
+
+    auto sysfs_result = measure("load_attributes_from_sysfs", iterations, [&devices]() {
+        size_t attributes{0};
+        for (auto & device : devices)
+        {
+            attributes += device.load_attributes_from_sysfs().size();
+        }
+        return attributes;
+    });
+
+    report(std::cout, file_manager_result);
+    report(std::cout, sysfs_result);
+    report_speedup(std::cout, file_manager_result, sysfs_result);
+
+    return mismatches == 0 ? 0 : 1;
+}
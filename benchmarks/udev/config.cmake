@@ -0,0 +1,41 @@
+################################################################################
+#####
+##### Tectiform TFLinux CMake Configuration File
+##### Created by: Steve Wilson
+#####
+################################################################################
+
+build_benchmark(
+        udev_attribute_loader_benchmark
+        benchmarks/udev/attribute_loader_benchmark.cpp
+)
+
+build_benchmark(
+        udev_device_number_cache_benchmark
+        benchmarks/udev/device_number_cache_benchmark.cpp
+)
+
+build_benchmark(
+        udev_event_replay_benchmark
+        benchmarks/udev/event_replay_benchmark.cpp
+)
+
+build_benchmark(
+        udev_getter_benchmark
+        benchmarks/udev/getter_benchmark.cpp
+)
+
+build_benchmark(
+        udev_inventory_benchmark
+        benchmarks/udev/inventory_benchmark.cpp
+)
+
+build_benchmark(
+        udev_parallel_query_benchmark
+        benchmarks/udev/parallel_query_benchmark.cpp
+)
+
+build_benchmark(
+        udev_property_memory_benchmark
+        benchmarks/udev/property_memory_benchmark.cpp
+)
@@ -0,0 +1,119 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+/**
+ * Compare creating a Device from a block device number for every lookup with looking the number
+ * up in a DeviceNumberCache, for the devices alone and with their attributes.
+ *
+ * usage: udev_device_number_cache_benchmark [iterations] [lookups]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 5;
+    size_t lookups = argc > 2 ? static_cast<size_t>(std::strtoul(argv[2], nullptr, 10)) : 10000;
+
+    Context context{};
+
+    std::vector<dev_t> device_numbers{};
+    Query query{context};
+    query.match_subsystem("block");
+    for (Device & device : query.devices())
+    {
+        if (device.get_devnum() != 0)
+        {
+            device_numbers.emplace_back(device.get_devnum());
+        }
+    }
+    std::cout << "block devices: " << device_numbers.size() << std::endl;
+    if (device_numbers.empty())
+    {
+        return 0;
+    }
+
+    auto device_result = measure("Device from devnum", iterations, [&context, &device_numbers, lookups]() {
+        size_t found{0};
+        for (size_t i = 0; i < lookups; i++)
+        {
+            Device device{context, 'b', device_numbers[i % device_numbers.size()]};
+            found += device.get_devnum() != 0 ? size_t{1} : size_t{0};
+        }
+        return found;
+    });
+
+    auto cached_device_result =
+        measure("DeviceNumberCache get_device", iterations, [&context, &device_numbers, lookups]() {
+            size_t found{0};
+            DeviceNumberCache cache{context};
+            for (size_t i = 0; i < lookups; i++)
+            {
+                found += cache.get_device('b', device_numbers[i % device_numbers.size()]) ? size_t{1} : size_t{0};
+            }
+            return found;
+        });
+
+    auto attributes_result =
+        measure("Device from devnum with attributes", iterations, [&context, &device_numbers, lookups]() {
+            size_t attributes{0};
+            for (size_t i = 0; i < lookups; i++)
+            {
+                Device device{context, 'b', device_numbers[i % device_numbers.size()]};
+                attributes += device.load_attributes_from_sysfs().size();
+            }
+            return attributes;
+        });
+
+    auto cached_attributes_result =
+        measure("DeviceNumberCache get_attributes", iterations, [&context, &device_numbers, lookups]() {
+            size_t attributes{0};
+            DeviceNumberCache cache{context};
+            for (size_t i = 0; i < lookups; i++)
+            {
+                attributes += cache.get_attributes('b', device_numbers[i % device_numbers.size()])->size();
+            }
+            return attributes;
+        });
+
+    report(std::cout, device_result);
+    report(std::cout, cached_device_result);
+    report_speedup(std::cout, device_result, cached_device_result);
+    report(std::cout, attributes_result);
+    report(std::cout, cached_attributes_result);
+    report_speedup(std::cout, attributes_result, cached_attributes_result);
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+namespace
+{
+    /**
+     * Replay the events over a socketpair and receive them through a SocketEventSource,
+     * reporting throughput and the latency from send to receive.
+     */
+    void run_replay(const std::string & name, EventReplayer & replayer, EventReplayer::Options options)
+    {
+        int sockets[2];
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0)
+        {
+            std::cerr << "socketpair failed" << std::endl;
+            return;
+        }
+
+        options.stamp_send_time = true;
+        auto expected = replayer.get_events().size() * options.repeat;
+        std::vector<int64_t> latencies;
+        latencies.reserve(expected);
+
+        SocketEventSource source{sockets[1]};
+        auto start = clock_type::now();
+        std::thread sender{[&replayer, &options, &sockets]() {
+            (void)replayer.replay(sockets[0], options);
+            (void)shutdown(sockets[0], SHUT_WR);
+        }};
+
+        while (latencies.size() < expected)
+        {
+            auto event = source.get_event();
+            if (! event)
+            {
+                break;
+            }
+            auto send_time = EventReplayer::get_send_time(*event);
+            if (send_time)
+            {
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(event->received - *send_time)
+                                        .count());
+            }
+        }
+        auto elapsed = clock_type::now() - start;
+        sender.join();
+        (void)close(sockets[0]);
+        (void)close(sockets[1]);
+
+        report(std::cout, Result{name, 1, latencies.size(), elapsed});
+        if (! latencies.empty())
+        {
+            std::sort(latencies.begin(), latencies.end());
+            std::cout << "    latency_us p50=" << percentile(latencies, 0.5) / 1000.0
+                      << " p99=" << percentile(latencies, 0.99) / 1000.0
+                      << " max=" << percentile(latencies, 1.0) / 1000.0 << " events_per_second="
+                      << static_cast<double>(latencies.size()) /
+                             std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count()
+                      << std::endl;
+        }
+    }
+} // namespace
+
+/**
+ * Measure the latency and throughput of hotplug events replayed over a socketpair at several
+ * rates and in burst mode.  Without a recording, the events are synthesised from the devices
+ * on the system.
+ *
+ * usage: udev_event_replay_benchmark [events] [recording]
+ */
+int main(int argc, char ** argv)
+{
+    size_t event_count = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 10000;
+
+    EventReplayer::event_list_type events;
+    if (argc > 2)
+    {
+        events = EventReplayer{String{argv[2]}}.get_events();
+    }
+    else
+    {
+        Context context{};
+        Query query{context};
+        std::vector<std::string> messages;
+        for (Device & device : query.devices())
+        {
+            auto event = DeviceEvent::from_device(device);
+            event.action = "change";
+            messages.push_back(event.to_message());
+        }
+        for (size_t i = 0; i < event_count && ! messages.empty(); i++)
+        {
+            events.push_back(RecordedEvent{std::chrono::microseconds{i * 100}, messages[i % messages.size()]});
+        }
+    }
+    std::cout << "events: " << events.size() << std::endl;
+
+    EventReplayer replayer{std::move(events)};
+
+    for (double rate : {1000.0, 10000.0, 100000.0})
+    {
+        EventReplayer::Options options{};
+        options.mode = EventReplayer::Mode::FIXED_RATE;
+        options.events_per_second = rate;
+        run_replay("fixed rate " + std::to_string(static_cast<size_t>(rate)) + "/s", replayer, options);
+    }
+
+    EventReplayer::Options recorded_options{};
+    recorded_options.speed = 10.0;
+    run_replay("recorded pace x10", replayer, recorded_options);
+
+    EventReplayer::Options burst_options{};
+    burst_options.mode = EventReplayer::Mode::BURST;
+    burst_options.burst_size = 1000;
+    burst_options.burst_interval = std::chrono::milliseconds{10};
+    run_replay("bursts of 1000", replayer, burst_options);
+
+    burst_options.burst_size = 0;
+    run_replay("single burst", replayer, burst_options);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <vector>
+#include <libudev.h>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+namespace
+{
+    // The getter helpers as they were before they became templates, kept here as the baseline.
+    String function_get_property(const std::function<const char *(udev_device *)> & f, udev_device * device)
+    {
+        String string_result;
+        auto api_result = f(device);
+        if (api_result)
+        {
+            string_result = api_result;
+        }
+        return string_result;
+    }
+
+    Device::string_map_type function_get_values(const std::function<udev_list_entry *(udev_device *)> & f,
+                                                udev_device * device)
+    {
+        Device::string_map_type result_map;
+        auto entries = f(device);
+        if (entries == nullptr)
+        {
+            return result_map;
+        }
+        udev_list_entry * entry;
+        udev_list_entry_foreach(entry, entries)
+        {
+            auto key = udev_list_entry_get_name(entry);
+            auto value = udev_list_entry_get_value(entry);
+            if (key && value)
+            {
+                result_map.insert(std::make_pair(key, value));
+            }
+        }
+        return result_map;
+    }
+} // namespace
+
+/**
+ * Measure the throughput of the Device getters over every device on the system, comparing the
+ * former std::function based helpers with the template based getters and the string_view getters.
+ *
+ * usage: udev_getter_benchmark [iterations]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 100;
+
+    Context context{};
+    Query query{context};
+    auto syspaths = query.run();
+
+    std::vector<Device> devices;
+    auto raw_context = udev_new();
+    std::vector<udev_device *> raw_devices;
+    for (auto & path : syspaths)
+    {
+        devices.emplace_back(context, path);
+        auto path_cstring_value = path.cStr();
+        auto raw_device = udev_device_new_from_syspath(raw_context, path_cstring_value.get());
+        if (raw_device != nullptr)
+        {
+            raw_devices.push_back(raw_device);
+        }
+    }
+
+    std::cout << "devices: " << devices.size() << std::endl;
+
+    auto function_scalar_result = measure("std::function scalar getters", iterations, [&raw_devices]() {
+        size_t length{0};
+        for (auto device : raw_devices)
+        {
+            length += function_get_property(udev_device_get_sysname, device).length();
+            length += function_get_property(udev_device_get_subsystem, device).length();
+            length += function_get_property(udev_device_get_devtype, device).length();
+        }
+        return length;
+    });
+
+    auto template_scalar_result = measure("template scalar getters", iterations, [&devices]() {
+        size_t length{0};
+        for (auto & device : devices)
+        {
+            length += device.get_sysname().length();
+            length += device.get_subsystem().length();
+            length += device.get_devtype().length();
+        }
+        return length;
+    });
+
+    auto view_scalar_result = measure("string_view scalar getters", iterations, [&devices]() {
+        size_t length{0};
+        for (auto & device : devices)
+        {
+            length += device.get_sysname_view().length();
+            length += device.get_subsystem_view().length();
+            length += device.get_devtype_view().length();
+        }
+        return length;
+    });
+
+    auto function_values_result = measure("std::function get_properties", iterations, [&raw_devices]() {
+        size_t count{0};
+        for (auto device : raw_devices)
+        {
+            count += function_get_values(udev_device_get_properties_list_entry, device).size();
+        }
+        return count;
+    });
+
+    auto template_values_result = measure("template get_properties", iterations, [&devices]() {
+        size_t count{0};
+        for (auto & device : devices)
+        {
+            count += device.get_properties().size();
+        }
+        return count;
+    });
+
+    report(std::cout, function_scalar_result);
+    report(std::cout, template_scalar_result);
+    report(std::cout, view_scalar_result);
+    report_speedup(std::cout, function_scalar_result, template_scalar_result);
+    report_speedup(std::cout, function_scalar_result, view_scalar_result);
+
+    report(std::cout, function_values_result);
+    report(std::cout, template_values_result);
+    report_speedup(std::cout, function_values_result, template_values_result);
+
+    for (auto device : raw_devices)
+    {
+        udev_device_unref(device);
+    }
+    udev_unref(raw_context);
+
+    return 0;
+}
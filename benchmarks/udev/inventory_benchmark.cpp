@@ -0,0 +1,88 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+#include <cstdlib>
+#include <iostream>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+/**
+ * Compare building a DeviceInventory from scratch with loading a snapshot of it and refreshing
+ * the snapshot against the devices on the system.
+ *
+ * usage: udev_inventory_benchmark [iterations] [snapshot_path]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 5;
+    String snapshot_path = argc > 2 ? String{argv[2]} : String{"/tmp/udev_inventory_benchmark.snapshot"};
+    DeviceInventory::string_set_type attribute_keys{"size", "queue/rotational"};
+
+    Context context{};
+
+    {
+        DeviceInventory inventory{};
+        inventory.set_attribute_keys(attribute_keys);
+        inventory.build(context);
+        inventory.save(snapshot_path);
+        std::cout << "devices: " << inventory.size() << std::endl;
+    }
+
+    auto build_result = measure("DeviceInventory build", iterations, [&context, &attribute_keys]() {
+        DeviceInventory inventory{};
+        inventory.set_attribute_keys(attribute_keys);
+        inventory.build(context);
+        return inventory.size();
+    });
+
+    auto load_result = measure("DeviceInventory load", iterations, [&snapshot_path, &attribute_keys]() {
+        DeviceInventory inventory{};
+        inventory.set_attribute_keys(attribute_keys);
+        (void)inventory.load(snapshot_path);
+        return inventory.size();
+    });
+
+    auto refresh_result =
+        measure("DeviceInventory load and refresh", iterations, [&context, &snapshot_path, &attribute_keys]() {
+            DeviceInventory inventory{};
+            inventory.set_attribute_keys(attribute_keys);
+            (void)inventory.load(snapshot_path);
+            auto statistics = inventory.refresh(context);
+            return statistics.updated + statistics.added + statistics.removed;
+        });
+
+    report(std::cout, build_result);
+    report(std::cout, load_result);
+    report(std::cout, refresh_result);
+    report_speedup(std::cout, build_result, refresh_result);
+
+    return 0;
+}
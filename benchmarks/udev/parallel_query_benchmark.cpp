@@ -0,0 +1,103 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+/**
+ * Compare creating every device on the system and loading its attributes one at a time with
+ * ParallelQuery, doubling the number of worker threads each run.
+ *
+ * usage: udev_parallel_query_benchmark [iterations] [max_threads]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 5;
+    size_t max_threads = argc > 2 ? static_cast<size_t>(std::strtoul(argv[2], nullptr, 10))
+                                  : std::max(std::thread::hardware_concurrency(), 1u) * 2;
+
+    Context context{};
+
+    {
+        Query query{context};
+        std::cout << "devices: " << query.run().size() << std::endl;
+    }
+
+    auto device_path_result = measure("serial load_attributes_from_device_path", iterations, [&context]() {
+        size_t attributes{0};
+        Query query{context};
+        for (auto & path : query.run())
+        {
+            Device device{context, path};
+            attributes += device.load_attributes_from_device_path().size();
+        }
+        return attributes;
+    });
+
+    auto serial_result = measure("serial load_attributes_from_sysfs", iterations, [&context]() {
+        size_t attributes{0};
+        Query query{context};
+        for (auto & path : query.run())
+        {
+            Device device{context, path};
+            attributes += device.load_attributes_from_sysfs().size();
+        }
+        return attributes;
+    });
+
+    report(std::cout, device_path_result);
+    report(std::cout, serial_result);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        auto parallel_result =
+            measure("ParallelQuery threads=" + std::to_string(threads), iterations, [&context, threads]() {
+                size_t attributes{0};
+                Query query{context};
+                ParallelQuery parallel_query{context, threads};
+                parallel_query.for_each(query, [&attributes](ParallelQuery::Result & result) {
+                    attributes += result.attributes.size();
+                });
+                return attributes;
+            });
+
+        report(std::cout, parallel_result);
+        report_speedup(std::cout, serial_result, parallel_result);
+    }
+
+    return 0;
+}
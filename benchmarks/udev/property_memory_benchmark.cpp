@@ -0,0 +1,145 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+#include <atomic>
+#include <malloc.h>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "tfbenchmark.hpp"
+
+using namespace TF::Foundation;
+using namespace TF::Linux::Udev;
+using namespace TF::Linux::Benchmark;
+
+namespace
+{
+    std::atomic<size_t> allocated_bytes{0};
+}
+
+// Track the heap memory in use so the benchmark can report what each representation keeps
+// allocated, including allocator rounding.
+void * operator new(size_t size)
+{
+    if (auto pointer = std::malloc(size == 0 ? 1 : size))
+    {
+        allocated_bytes += malloc_usable_size(pointer);
+        return pointer;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void * pointer) noexcept
+{
+    if (pointer != nullptr)
+    {
+        allocated_bytes -= malloc_usable_size(pointer);
+        std::free(pointer);
+    }
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+    operator delete(pointer);
+}
+
+/**
+ * Compare the heap memory and time used to keep the properties of every device on the system
+ * as std::unordered_map<String, String> and as CompactPropertyMap.
+ *
+ * usage: udev_property_memory_benchmark [iterations]
+ */
+int main(int argc, char ** argv)
+{
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 5;
+
+    Context context{};
+    std::vector<Device> devices{};
+    {
+        Query query{context};
+        for (auto & path : query.run())
+        {
+            devices.emplace_back(context, path);
+        }
+    }
+    std::cout << "devices: " << devices.size() << std::endl;
+
+    {
+        auto before = allocated_bytes.load();
+        std::vector<Device::string_map_type> maps{};
+        maps.reserve(devices.size());
+        for (auto & device : devices)
+        {
+            maps.push_back(device.get_properties());
+        }
+        std::cout << "std::unordered_map<String, String> bytes in use: " << allocated_bytes.load() - before
+                  << std::endl;
+    }
+
+    {
+        StringPool pool{};
+        auto before = allocated_bytes.load();
+        std::vector<CompactPropertyMap> maps{};
+        maps.reserve(devices.size());
+        size_t map_bytes{0};
+        for (auto & device : devices)
+        {
+            maps.push_back(device.get_compact_properties(pool));
+            map_bytes += maps.back().get_memory_usage();
+        }
+        std::cout << "CompactPropertyMap bytes in use: " << allocated_bytes.load() - before
+                  << " (maps: " << map_bytes << ", pool: " << pool.get_memory_usage() << ", strings: " << pool.size()
+                  << ")" << std::endl;
+    }
+
+    auto map_result = measure("get_properties", iterations, [&devices]() {
+        size_t properties{0};
+        for (auto & device : devices)
+        {
+            properties += device.get_properties().size();
+        }
+        return properties;
+    });
+
+    StringPool pool{};
+    auto compact_result = measure("get_compact_properties", iterations, [&devices, &pool]() {
+        size_t properties{0};
+        for (auto & device : devices)
+        {
+            properties += device.get_compact_properties(pool).size();
+        }
+        return properties;
+    });
+
+    report(std::cout, map_result);
+    report(std::cout, compact_result);
+    report_speedup(std::cout, map_result, compact_result);
+
+    return 0;
+}
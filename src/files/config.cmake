@@ -7,7 +7,15 @@
 
 list(APPEND LIBRARY_HEADER_FILES
         "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tfautofiledescriptor.hpp"
-        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffileobserver.hpp")
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffileevent.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffileeventdispatcher.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffileio.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffileobserver.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/files/tffilepermissionhandler.hpp")
 
 list(APPEND LIBRARY_SOURCE_FILES
-        src/files/tffileobserver.cpp)
+        src/files/tffileevent.cpp
+        src/files/tffileeventdispatcher.cpp
+        src/files/tffileio.cpp
+        src/files/tffileobserver.cpp
+        src/files/tffilepermissionhandler.cpp)
@@ -33,27 +33,78 @@ SOFTWARE.
 namespace TF::Linux
 {
 
+    /**
+     * The AutoFileDescriptor class owns a file descriptor and closes it when destroyed.
+     *
+     * Ownership can be moved to another AutoFileDescriptor, which leaves the source holding
+     * no descriptor, so an owned descriptor can be returned from functions and stored in
+     * containers.  A negative value means no descriptor is held and nothing is closed.
+     */
     class AutoFileDescriptor
     {
     public:
+        AutoFileDescriptor() : m_fd(-1) {}
+
         explicit AutoFileDescriptor(int fd) : m_fd(fd) {}
 
         AutoFileDescriptor(const AutoFileDescriptor & fd) = delete;
-        AutoFileDescriptor(AutoFileDescriptor && fd) = delete;
+
+        AutoFileDescriptor(AutoFileDescriptor && fd) noexcept : m_fd(fd.release()) {}
 
         ~AutoFileDescriptor()
         {
-            (void)close(m_fd);
+            reset();
         }
 
         AutoFileDescriptor & operator=(const AutoFileDescriptor & fd) = delete;
-        AutoFileDescriptor & operator=(AutoFileDescriptor && fd) = delete;
+
+        AutoFileDescriptor & operator=(AutoFileDescriptor && fd) noexcept
+        {
+            if (this != &fd)
+            {
+                reset(fd.release());
+            }
+            return *this;
+        }
 
         int operator*() const
         {
             return m_fd;
         }
 
+        /**
+         * @brief method to check if a descriptor is held.
+         * @return true if the descriptor is not negative.
+         */
+        [[nodiscard]] bool is_valid() const
+        {
+            return m_fd >= 0;
+        }
+
+        /**
+         * @brief method to give up ownership of the descriptor without closing it.
+         * @return the descriptor, which the caller must now close.
+         */
+        [[nodiscard]] int release()
+        {
+            auto fd = m_fd;
+            m_fd = -1;
+            return fd;
+        }
+
+        /**
+         * @brief method to close the descriptor held and take ownership of another.
+         * @param fd the new descriptor, negative to hold none.
+         */
+        void reset(int fd = -1)
+        {
+            if (m_fd >= 0)
+            {
+                (void)close(m_fd);
+            }
+            m_fd = fd;
+        }
+
     private:
         int m_fd;
     };
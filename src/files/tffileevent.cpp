@@ -0,0 +1,204 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include "tffileevent.hpp"
+
+namespace TF::Linux
+{
+
+    FileEvent::FileEvent(const event_metadata_type * event) : m_metadata{*event}, m_fd{event->fd}
+    {
+        auto data = reinterpret_cast<const unsigned char *>(event);
+        if (event->event_len > event->metadata_len)
+        {
+            m_info.assign(data + event->metadata_len, data + event->event_len);
+        }
+
+        size_t offset{0};
+        while (auto header = next_info_record(offset))
+        {
+            if (header->info_type == FAN_EVENT_INFO_TYPE_PIDFD && header->len >= sizeof(fanotify_event_info_pidfd))
+            {
+                m_pidfd.reset(reinterpret_cast<const fanotify_event_info_pidfd *>(header)->pidfd);
+            }
+        }
+    }
+
+    const FileEvent::event_metadata_type & FileEvent::get_metadata() const
+    {
+        return m_metadata;
+    }
+
+    uint64_t FileEvent::get_mask() const
+    {
+        return m_metadata.mask;
+    }
+
+    pid_t FileEvent::get_pid() const
+    {
+        return m_metadata.pid;
+    }
+
+    int FileEvent::get_file_descriptor() const
+    {
+        return *m_fd;
+    }
+
+    int FileEvent::release_file_descriptor()
+    {
+        return m_fd.release();
+    }
+
+    int FileEvent::get_pidfd() const
+    {
+        return *m_pidfd;
+    }
+
+    const FileEvent::string_type & FileEvent::get_path() const
+    {
+        if (! m_path)
+        {
+            m_path.emplace();
+            if (m_fd.is_valid())
+            {
+                auto link = "/proc/self/fd/" + std::to_string(*m_fd);
+                char buffer[PATH_MAX];
+                auto length = readlink(link.c_str(), buffer, sizeof(buffer));
+                if (length < 0)
+                {
+                    m_path.reset();
+                    throw std::system_error{errno, std::system_category(), "readlink failed"};
+                }
+                m_path.emplace(buffer, static_cast<size_t>(length));
+            }
+        }
+        return *m_path;
+    }
+
+    const FileEvent::file_id_record_type * FileEvent::get_file_id_record() const
+    {
+        const file_id_record_type * file_id_record{nullptr};
+        size_t offset{0};
+        while (auto header = next_info_record(offset))
+        {
+            auto info_type = header->info_type;
+            if ((info_type == FAN_EVENT_INFO_TYPE_FID || info_type == FAN_EVENT_INFO_TYPE_DFID ||
+                 info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) &&
+                get_file_handle_end(header) > 0)
+            {
+                if (file_id_record == nullptr || info_type == FAN_EVENT_INFO_TYPE_FID)
+                {
+                    file_id_record = reinterpret_cast<const file_id_record_type *>(header);
+                }
+            }
+        }
+        return file_id_record;
+    }
+
+    std::string_view FileEvent::get_name() const
+    {
+        size_t offset{0};
+        while (auto header = next_info_record(offset))
+        {
+            if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME)
+            {
+                // The name follows the file handle, null terminated and padded to the record length.
+                auto name_offset = get_file_handle_end(header);
+                if (name_offset == 0 || name_offset >= header->len)
+                {
+                    return {};
+                }
+                auto name = reinterpret_cast<const char *>(header) + name_offset;
+                return std::string_view{name, strnlen(name, header->len - name_offset)};
+            }
+        }
+        return {};
+    }
+
+    AutoFileDescriptor FileEvent::open_file_by_handle(int mount_fd, int flags) const
+    {
+        auto record = get_file_id_record();
+        if (record == nullptr)
+        {
+            throw std::logic_error{"the event has no file id record"};
+        }
+
+        // open_by_handle_at takes a mutable handle, so pass it a copy.
+        auto handle_source = reinterpret_cast<const struct file_handle *>(record->handle);
+        std::vector<unsigned char> handle(sizeof(struct file_handle) + handle_source->handle_bytes);
+        std::memcpy(handle.data(), handle_source, handle.size());
+        auto handle_pointer = reinterpret_cast<struct file_handle *>(handle.data());
+        AutoFileDescriptor fd{open_by_handle_at(mount_fd, handle_pointer, flags)};
+        if (! fd.is_valid())
+        {
+            throw std::system_error{errno, std::system_category(), "open_by_handle_at failed"};
+        }
+        return fd;
+    }
+
+    const fanotify_event_info_header * FileEvent::next_info_record(size_t & offset) const
+    {
+        if (offset + sizeof(fanotify_event_info_header) > m_info.size())
+        {
+            return nullptr;
+        }
+
+        // The kernel pads each record to keep the next one aligned, and the vector's storage is
+        // aligned for any type.
+        auto header = reinterpret_cast<const fanotify_event_info_header *>(m_info.data() + offset);
+        if (header->len < sizeof(*header) || offset + header->len > m_info.size())
+        {
+            return nullptr;
+        }
+        offset += header->len;
+        return header;
+    }
+
+    size_t FileEvent::get_file_handle_end(const fanotify_event_info_header * header)
+    {
+        // Only read handle_bytes once the record is known to hold the file_handle header, and
+        // only trust it if the record is long enough for the handle it describes.
+        auto handle_offset = sizeof(file_id_record_type) + sizeof(struct file_handle);
+        if (header->len < handle_offset)
+        {
+            return 0;
+        }
+        auto record = reinterpret_cast<const file_id_record_type *>(header);
+        auto handle = reinterpret_cast<const struct file_handle *>(record->handle);
+        if (handle->handle_bytes > header->len - handle_offset)
+        {
+            return 0;
+        }
+        return handle_offset + handle->handle_bytes;
+    }
+
+} // namespace TF::Linux
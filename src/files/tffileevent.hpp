@@ -0,0 +1,169 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFFILEEVENT_HPP
+#define TFFILEEVENT_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#include "TFFoundation.hpp"
+#include "tfautofiledescriptor.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux
+{
+
+    /**
+     * The FileEvent class holds one fanotify event and owns the file descriptors that come
+     * with it, so they are closed when the event is destroyed however the handler returns.
+     *
+     * An event is move-only: moving it into a queue or another thread moves ownership of the
+     * descriptors with it.  The path of the file is read from /proc/self/fd only when asked
+     * for.  In FAN_REPORT_FID mode the kernel opens no descriptor at all and the file is
+     * identified by the file system id and file handle in the event's info records instead,
+     * which can be opened with open_file_by_handle when the file itself is needed.
+     */
+    class FileEvent
+    {
+    public:
+        using event_metadata_type = struct fanotify_event_metadata;
+        using file_id_record_type = struct fanotify_event_info_fid;
+        using string_type = String;
+
+        /**
+         * @brief constructor with the event read from fanotify
+         * @param event the event, copied along with its info records.  The new object takes
+         * ownership of the event's file descriptor and pidfd.
+         */
+        explicit FileEvent(const event_metadata_type * event);
+
+        FileEvent(const FileEvent &) = delete;
+        FileEvent(FileEvent &&) noexcept = default;
+
+        FileEvent & operator=(const FileEvent &) = delete;
+        FileEvent & operator=(FileEvent &&) noexcept = default;
+
+        /**
+         * @brief method to get the metadata of the event.
+         * @return the metadata, whose fd field is the descriptor read from fanotify even after
+         * the descriptor has been released.
+         */
+        [[nodiscard]] const event_metadata_type & get_metadata() const;
+
+        /**
+         * @brief method to get the mask of events that occurred.
+         * @return the mask.
+         */
+        [[nodiscard]] uint64_t get_mask() const;
+
+        /**
+         * @brief method to get the id of the process that caused the event.
+         * @return the process id.
+         */
+        [[nodiscard]] pid_t get_pid() const;
+
+        /**
+         * @brief method to get the file descriptor of the file, owned by the event.
+         * @return the descriptor, negative if the event has none, as in FAN_REPORT_FID mode.
+         */
+        [[nodiscard]] int get_file_descriptor() const;
+
+        /**
+         * @brief method to take ownership of the file descriptor away from the event.
+         * @return the descriptor, which the caller must now close.
+         */
+        [[nodiscard]] int release_file_descriptor();
+
+        /**
+         * @brief method to get the pidfd reported with FAN_REPORT_PIDFD, owned by the event.
+         * @return the pidfd, negative if the event has none.
+         */
+        [[nodiscard]] int get_pidfd() const;
+
+        /**
+         * @brief method to get the path of the file.
+         * @return the path, resolved from /proc/self/fd the first time it is requested, or an
+         * empty string if the event has no file descriptor.
+         */
+        [[nodiscard]] const string_type & get_path() const;
+
+        /**
+         * @brief method to get the record identifying the file in FAN_REPORT_FID mode.
+         * @return the record for the file itself if the event has one, otherwise the record
+         * for its directory, or nullptr if the event has no file id records.
+         */
+        [[nodiscard]] const file_id_record_type * get_file_id_record() const;
+
+        /**
+         * @brief method to get the name of the directory entry reported with FAN_REPORT_DFID_NAME.
+         * @return the name, empty if the event has no name record.
+         */
+        [[nodiscard]] std::string_view get_name() const;
+
+        /**
+         * @brief method to open the file identified by the event's file id record.
+         * @param mount_fd a descriptor of any file on the file system of the event.
+         * @param flags the open flags
+         * @return the descriptor.
+         *
+         * This calls open_by_handle_at, which needs CAP_DAC_READ_SEARCH.
+         */
+        [[nodiscard]] AutoFileDescriptor open_file_by_handle(int mount_fd, int flags = O_RDONLY) const;
+
+    private:
+        /**
+         * @brief helper method to step through the info records.
+         * @param offset the offset of the record, moved on to the next record.
+         * @return the record at @e offset, or nullptr after the last record.
+         */
+        const fanotify_event_info_header * next_info_record(size_t & offset) const;
+
+        /**
+         * @brief helper function to get the length of the file id and file handle of a file id record.
+         * @param header the record
+         * @return the offset just past the file handle, or 0 if the record is too short to hold it.
+         */
+        static size_t get_file_handle_end(const fanotify_event_info_header * header);
+
+        event_metadata_type m_metadata;
+
+        // The info records that follow the metadata, empty unless the group reports them.
+        std::vector<unsigned char> m_info;
+
+        AutoFileDescriptor m_fd;
+        AutoFileDescriptor m_pidfd;
+        mutable std::optional<string_type> m_path;
+    };
+
+} // namespace TF::Linux
+
+#endif // TFFILEEVENT_HPP
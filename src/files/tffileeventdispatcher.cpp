@@ -0,0 +1,248 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <sys/stat.h>
+#include "tffileeventdispatcher.hpp"
+
+namespace TF::Linux
+{
+
+    namespace
+    {
+        constexpr uint64_t fnv_offset_basis = 14695981039346656037ULL;
+        constexpr uint64_t fnv_prime = 1099511628211ULL;
+
+        /**
+         * @brief helper function to add bytes to an FNV-1a hash.
+         */
+        uint64_t hash_bytes(uint64_t hash, const void * data, size_t length)
+        {
+            auto bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < length; i++)
+            {
+                hash = (hash ^ bytes[i]) * fnv_prime;
+            }
+            return hash;
+        }
+    } // namespace
+
+    FileEventDispatcher::FileEventDispatcher(const event_callback_type & handler, size_t thread_count,
+                                             size_t queue_capacity) :
+        m_handler{handler}, m_queue_capacity{queue_capacity}, m_dispatched{0}, m_handled{0}, m_blocked{0},
+        m_max_queue_length{0}
+    {
+        if (m_queue_capacity == 0)
+        {
+            throw std::invalid_argument{"queue capacity must be greater than 0"};
+        }
+
+        if (thread_count == 0)
+        {
+            thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        for (size_t i = 0; i < thread_count; i++)
+        {
+            m_shards.emplace_back(std::make_unique<Shard>());
+        }
+        for (auto & shard : m_shards)
+        {
+            m_threads.emplace_back([this, &shard]() {
+                work(*shard);
+            });
+        }
+    }
+
+    FileEventDispatcher::~FileEventDispatcher()
+    {
+        for (auto & shard : m_shards)
+        {
+            std::lock_guard<std::mutex> lock{shard->mutex};
+            shard->stopping = true;
+            shard->not_empty.notify_all();
+        }
+        for (auto & thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void FileEventDispatcher::dispatch(event_list_type events)
+    {
+        // Take ownership of every descriptor in the batch before anything can throw or block on a
+        // full queue, so that unwinding closes the descriptors of events that are never queued.
+        std::vector<event_type> file_events{};
+        file_events.reserve(events.size());
+        for (auto event : events)
+        {
+            file_events.emplace_back(event);
+        }
+
+        rethrow_error();
+        for (auto & file_event : file_events)
+        {
+            dispatch(std::move(file_event));
+        }
+    }
+
+    void FileEventDispatcher::dispatch(event_type && event)
+    {
+        auto & shard = *m_shards[get_file_key(event) % m_shards.size()];
+
+        std::unique_lock<std::mutex> lock{shard.mutex};
+        if (shard.queue.size() >= m_queue_capacity)
+        {
+            m_blocked++;
+            shard.not_full.wait(lock, [&shard, this]() {
+                return shard.queue.size() < m_queue_capacity;
+            });
+        }
+        shard.queue.emplace_back(std::move(event));
+        auto queue_length = shard.queue.size();
+        shard.not_empty.notify_one();
+        lock.unlock();
+
+        m_dispatched++;
+        auto max_queue_length = m_max_queue_length.load();
+        while (queue_length > max_queue_length &&
+               ! m_max_queue_length.compare_exchange_weak(max_queue_length, queue_length))
+        {
+        }
+    }
+
+    void FileEventDispatcher::wait()
+    {
+        for (auto & shard : m_shards)
+        {
+            std::unique_lock<std::mutex> lock{shard->mutex};
+            shard->idle.wait(lock, [&shard]() {
+                return shard->queue.empty() && ! shard->busy;
+            });
+        }
+        rethrow_error();
+    }
+
+    size_t FileEventDispatcher::get_thread_count() const
+    {
+        return m_threads.size();
+    }
+
+    size_t FileEventDispatcher::get_queue_capacity() const
+    {
+        return m_queue_capacity;
+    }
+
+    FileEventDispatcher::Statistics FileEventDispatcher::get_statistics() const
+    {
+        return Statistics{m_dispatched.load(), m_handled.load(), m_blocked.load(), m_max_queue_length.load()};
+    }
+
+    FileEventDispatcher::key_type FileEventDispatcher::get_file_key(const event_type & event)
+    {
+        if (event.get_file_descriptor() >= 0)
+        {
+            struct stat file_stat{};
+            if (fstat(event.get_file_descriptor(), &file_stat) < 0)
+            {
+                return 0;
+            }
+            auto hash = hash_bytes(fnv_offset_basis, &file_stat.st_dev, sizeof(file_stat.st_dev));
+            return hash_bytes(hash, &file_stat.st_ino, sizeof(file_stat.st_ino));
+        }
+
+        // In FID mode the file is identified by the file system id and handle in its info record.
+        auto file_id_record = event.get_file_id_record();
+        if (file_id_record == nullptr)
+        {
+            return 0;
+        }
+        auto record_length = file_id_record->hdr.len - sizeof(file_id_record->hdr);
+        return hash_bytes(fnv_offset_basis, &file_id_record->fsid, record_length);
+    }
+
+    void FileEventDispatcher::work(Shard & shard)
+    {
+        while (true)
+        {
+            std::unique_lock<std::mutex> lock{shard.mutex};
+            shard.not_empty.wait(lock, [&shard]() {
+                return ! shard.queue.empty() || shard.stopping;
+            });
+            if (shard.queue.empty())
+            {
+                return;
+            }
+
+            std::optional<event_type> event{std::move(shard.queue.front())};
+            shard.queue.pop_front();
+            shard.busy = true;
+            shard.not_full.notify_one();
+            lock.unlock();
+
+            try
+            {
+                m_handler(*event);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> error_lock{m_error_mutex};
+                if (! m_error)
+                {
+                    m_error = std::current_exception();
+                }
+            }
+
+            // Close the descriptors before the event counts as handled.
+            event.reset();
+            m_handled++;
+
+            lock.lock();
+            shard.busy = false;
+            if (shard.queue.empty())
+            {
+                shard.idle.notify_all();
+            }
+        }
+    }
+
+    void FileEventDispatcher::rethrow_error()
+    {
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock{m_error_mutex};
+            std::swap(error, m_error);
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+} // namespace TF::Linux
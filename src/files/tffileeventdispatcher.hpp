@@ -0,0 +1,188 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFFILEEVENTDISPATCHER_HPP
+#define TFFILEEVENTDISPATCHER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "tffileobserver.hpp"
+
+namespace TF::Linux
+{
+
+    /**
+     * The FileEventDispatcher class hands the events read by a FileObserver to a pool of worker
+     * threads, so that one slow handler does not hold up every other event.
+     *
+     * Events are sharded by the identity of the file they refer to, the device and inode of
+     * the event's file descriptor or the file system id and file handle reported in FID mode,
+     * and each shard is served by one thread, so the events for one file are handled in the
+     * order they were read.  Each shard has a bounded queue.  When a queue is full, dispatch
+     * blocks, so the observer stops reading and events wait in the fanotify queue until the
+     * workers catch up.
+     *
+     * Pass dispatch as the batch callback of FileObserver::run:
+     * @code
+     * observer.run([&dispatcher](FileObserver::event_list_type events) { dispatcher.dispatch(events); });
+     * @endcode
+     * Each event is wrapped in a FileEvent as it is dispatched, so its file descriptor is closed
+     * once the handler returns, or when the dispatcher is destroyed if it is never handled.
+     */
+    class FileEventDispatcher
+    {
+    public:
+        using event_metadata_type = FileObserver::event_metadata_type;
+        using event_list_type = FileObserver::event_list_type;
+        using event_type = FileEvent;
+        using event_callback_type = FileObserver::file_event_callback_type;
+        using key_type = uint64_t;
+
+        /** The number of events dispatched and handled, and how often dispatch had to wait. */
+        struct Statistics
+        {
+            size_t dispatched{0};
+            size_t handled{0};
+            size_t blocked{0};
+            size_t max_queue_length{0};
+        };
+
+        constexpr static size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+        /**
+         * @brief constructor with handler, thread count and queue capacity
+         * @param handler the function the workers call with each event.
+         * @param thread_count the number of worker threads, 0 means one per hardware thread.
+         * @param queue_capacity the largest number of events queued for each worker, must be
+         * greater than 0.
+         */
+        explicit FileEventDispatcher(const event_callback_type & handler, size_t thread_count = 0,
+                                     size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+
+        FileEventDispatcher(const FileEventDispatcher &) = delete;
+        FileEventDispatcher & operator=(const FileEventDispatcher &) = delete;
+
+        /** destructor, handles the queued events and then stops the workers. */
+        ~FileEventDispatcher();
+
+        /**
+         * @brief method to queue a batch of events for the workers.
+         * @param events the events, copied, along with ownership of their descriptors, before
+         * the method returns.
+         *
+         * If a handler has thrown since the last call, the exception is rethrown here, which
+         * makes FileObserver::run return with it.  The events of the batch are wrapped first, so
+         * their descriptors are closed rather than leaked.
+         */
+        void dispatch(event_list_type events);
+
+        /**
+         * @brief method to queue one event for the workers.
+         * @param event the event
+         */
+        void dispatch(event_type && event);
+
+        /**
+         * @brief method to wait until every queued event has been handled.
+         *
+         * If a handler has thrown, the first exception is rethrown.
+         */
+        void wait();
+
+        /**
+         * @brief method to get the number of worker threads.
+         * @return the number of worker threads.
+         */
+        [[nodiscard]] size_t get_thread_count() const;
+
+        /**
+         * @brief method to get the largest number of events queued for each worker.
+         * @return the queue capacity.
+         */
+        [[nodiscard]] size_t get_queue_capacity() const;
+
+        /**
+         * @brief method to get the dispatch counts, safe to call from any thread.
+         * @return the statistics.
+         */
+        [[nodiscard]] Statistics get_statistics() const;
+
+        /**
+         * @brief function to get the key events are sharded by.
+         * @param event the event
+         * @return the same key for every event that refers to the same file, 0 for events such as
+         * queue overflows that refer to no file.
+         */
+        [[nodiscard]] static key_type get_file_key(const event_type & event);
+
+    private:
+        struct Shard
+        {
+            std::mutex mutex;
+            std::condition_variable not_empty;
+            std::condition_variable not_full;
+            std::condition_variable idle;
+            std::deque<event_type> queue;
+            bool busy{false};
+            bool stopping{false};
+        };
+
+        /**
+         * @brief helper method run by each worker thread.
+         * @param shard the shard the worker serves
+         */
+        void work(Shard & shard);
+
+        /**
+         * @brief helper method to rethrow the first exception thrown by a handler.
+         */
+        void rethrow_error();
+
+        event_callback_type m_handler;
+        size_t m_queue_capacity;
+        std::vector<std::unique_ptr<Shard>> m_shards;
+        std::vector<std::thread> m_threads;
+
+        std::mutex m_error_mutex;
+        std::exception_ptr m_error;
+
+        std::atomic<size_t> m_dispatched;
+        std::atomic<size_t> m_handled;
+        std::atomic<size_t> m_blocked;
+        std::atomic<size_t> m_max_queue_length;
+    };
+
+} // namespace TF::Linux
+
+#endif // TFFILEEVENTDISPATCHER_HPP
@@ -26,32 +26,72 @@ SOFTWARE.
 ******************************************************************************/
 
 #include <system_error>
+#include <algorithm>
+#include <stdexcept>
 #include <cerrno>
 #include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/fanotify.h>
+#include <sys/uio.h>
+#include <climits>
 #include <unistd.h>
 #include "tffileobserver.hpp"
 
 namespace TF::Linux
 {
 
-    FileObserver::FileObserver(unsigned int flags, unsigned int modes) : m_notifier_fd{0}, m_pipe_fd{0, 0}
+    double FileObserver::Statistics::get_reads_per_second() const
     {
+        auto seconds = std::chrono::duration<double>(elapsed).count();
+        return seconds > 0 ? static_cast<double>(reads) / seconds : 0;
+    }
+
+    double FileObserver::Statistics::get_events_per_read() const
+    {
+        return reads > 0 ? static_cast<double>(events) / static_cast<double>(reads) : 0;
+    }
+
+    FileObserver::FileObserver(unsigned int flags, unsigned int modes) :
+        m_notifier_fd{-1}, m_epoll_fd{-1}, m_stop_fd{-1}, m_buffer_size{0}
+    {
+        set_buffer_size(DEFAULT_BUFFER_SIZE);
+
         m_notifier_fd = fanotify_init(flags, modes);
         if (m_notifier_fd < 0)
         {
             throw std::system_error{errno, std::system_category(), "fanotify_init failed"};
         }
 
-        auto pipe_api_result = pipe2(m_pipe_fd, O_CLOEXEC | O_NONBLOCK);
-        if (pipe_api_result < 0)
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd < 0)
         {
-            throw std::system_error{errno, std::system_category()};
+            auto error = errno;
+            (void)close(m_notifier_fd);
+            throw std::system_error{error, std::system_category(), "epoll_create1 failed"};
+        }
+
+        m_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        epoll_event stop_event{};
+        stop_event.events = EPOLLIN;
+        stop_event.data.fd = m_stop_fd;
+        if (m_stop_fd < 0 || epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &stop_event) < 0)
+        {
+            auto error = errno;
+            if (m_stop_fd >= 0)
+            {
+                (void)close(m_stop_fd);
+            }
+            (void)close(m_epoll_fd);
+            (void)close(m_notifier_fd);
+            throw std::system_error{error, std::system_category(), "stop eventfd setup failed"};
         }
     }
 
     FileObserver::~FileObserver()
     {
+        close(m_stop_fd);
+        close(m_epoll_fd);
         close(m_notifier_fd);
     }
 
@@ -70,63 +110,252 @@ namespace TF::Linux
         }
     }
 
-    void FileObserver::run(const std::function<void(event_metadata_type *)> & event_callback)
+    void FileObserver::run(const event_callback_type & event_callback)
     {
-        bool keep_monitoring{true};
-        Poller poller;
-        poller.add_handle(m_pipe_fd[0], PollEvent::Read, [&keep_monitoring](int) -> void {
-            keep_monitoring = false;
+        run([&event_callback](event_list_type events) {
+            for (auto event : events)
+            {
+                event_callback(event);
+            }
         });
+    }
 
-        poller.add_handle(m_notifier_fd, PollEvent::Read, [&event_callback, &keep_monitoring, this](int) -> void {
-            event_metadata_type event_buffer[EVENT_BUFFER_SIZE];
-            event_metadata_type * current_event;
-
-            while (keep_monitoring)
+    void FileObserver::run(const file_event_callback_type & file_event_callback)
+    {
+        run([&file_event_callback](event_list_type events) {
+            // Take ownership of every descriptor in the batch first, so none leaks if the callback throws.
+            std::vector<FileEvent> file_events{};
+            file_events.reserve(events.size());
+            for (auto event : events)
+            {
+                file_events.emplace_back(event);
+            }
+            for (auto & file_event : file_events)
             {
-                auto bytes_read =
-                    read(this->m_notifier_fd, reinterpret_cast<void *>(event_buffer), sizeof(event_buffer));
-                if (bytes_read < 0 && errno != EAGAIN)
-                {
-                    throw std::system_error{errno, std::system_category(), "read failed"};
-                }
-
-                if (bytes_read <= 0)
-                {
-                    break;
-                }
-
-                current_event = event_buffer;
-
-                while (keep_monitoring && FAN_EVENT_OK(current_event, bytes_read))
-                {
-                    if (current_event->vers != FANOTIFY_METADATA_VERSION)
-                    {
-                        throw std::runtime_error{"Mismatched event metadata version"};
-                    }
-
-                    event_callback(current_event);
-
-                    current_event = FAN_EVENT_NEXT(current_event, bytes_read);
-                }
-                break;
+                file_event_callback(file_event);
             }
         });
+    }
+
+    void FileObserver::run(const batch_callback_type & batch_callback)
+    {
+        add_handle(m_notifier_fd, [&batch_callback, this](int) -> void {
+            read_events(batch_callback, m_keep_monitoring);
+        });
 
-        while (keep_monitoring)
+        auto start_time = clock_type::now();
+        m_keep_monitoring = true;
+        try
         {
-            (void)poller.wait_for(std::chrono::milliseconds(250));
+            while (m_keep_monitoring)
+            {
+                wait_for_events();
+            }
+        }
+        catch (...)
+        {
+            remove_handle(m_notifier_fd);
+            throw;
         }
+        remove_handle(m_notifier_fd);
 
-        // Read any pending signals from the signal pipe.
-        char buffer[1024];
-        (void)!read(m_pipe_fd[0], buffer, sizeof(buffer));
+        {
+            std::lock_guard<std::mutex> lock{m_statistics_mutex};
+            m_statistics.elapsed += clock_type::now() - start_time;
+        }
     }
 
     void FileObserver::stop()
     {
-        char signal_value = '1';
-        (void)!write(m_pipe_fd[1], &signal_value, sizeof(signal_value));
+        (void)eventfd_write(m_stop_fd, 1);
+    }
+
+    size_t FileObserver::respond(response_list_type responses) const
+    {
+        size_t rejected{0};
+        std::vector<iovec> vectors{};
+        vectors.reserve(std::min<size_t>(responses.size(), IOV_MAX));
+        while (! responses.empty())
+        {
+            auto count = std::min<size_t>(responses.size(), IOV_MAX);
+            vectors.clear();
+            for (auto & response : responses.first(count))
+            {
+                vectors.push_back(iovec{const_cast<response_type *>(&response), sizeof(response)});
+            }
+
+            // writev stops at the first response the kernel rejects, reporting an error only if
+            // it was the first one, so skip over the rejected response and carry on.
+            auto bytes_written = writev(m_notifier_fd, vectors.data(), static_cast<int>(vectors.size()));
+            if (bytes_written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+
+            auto written = bytes_written < 0 ? 0 : static_cast<size_t>(bytes_written) / sizeof(response_type);
+            if (written < count)
+            {
+                rejected++;
+                written++;
+            }
+            responses = responses.subspan(written);
+        }
+        return rejected;
+    }
+
+    int FileObserver::get_file_descriptor() const
+    {
+        return m_notifier_fd;
+    }
+
+    void FileObserver::add_handle(int fd, const handle_callback_type & callback)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        auto operation = m_handles.contains(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(m_epoll_fd, operation, fd, &event) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+        m_handles[fd] = std::make_shared<handle_callback_type>(callback);
+    }
+
+    void FileObserver::remove_handle(int fd)
+    {
+        if (m_handles.erase(fd) > 0 && epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+    }
+
+    void FileObserver::add_observer(FileObserver & observer, const batch_callback_type & batch_callback)
+    {
+        if (&observer == this)
+        {
+            throw std::invalid_argument{"an observer cannot be added to itself"};
+        }
+
+        add_handle(observer.m_notifier_fd, [&observer, batch_callback, this](int) -> void {
+            observer.read_events(batch_callback, m_keep_monitoring);
+        });
+    }
+
+    void FileObserver::remove_observer(const FileObserver & observer)
+    {
+        remove_handle(observer.m_notifier_fd);
+    }
+
+    void FileObserver::wait_for_events()
+    {
+        constexpr int max_events = 64;
+        epoll_event events[max_events];
+        auto event_count = epoll_wait(m_epoll_fd, events, max_events, -1);
+        if (event_count < 0)
+        {
+            if (errno == EINTR)
+            {
+                return;
+            }
+            throw std::system_error{errno, std::system_category(), "epoll_wait failed"};
+        }
+
+        for (int i = 0; i < event_count; i++)
+        {
+            auto fd = events[i].data.fd;
+            if (fd == m_stop_fd)
+            {
+                eventfd_t value{0};
+                (void)eventfd_read(m_stop_fd, &value);
+                m_keep_monitoring = false;
+                continue;
+            }
+
+            // An earlier callback may have removed this handle.
+            auto handle_iterator = m_handles.find(fd);
+            if (m_keep_monitoring && handle_iterator != m_handles.end())
+            {
+                auto callback = handle_iterator->second;
+                (*callback)(fd);
+            }
+        }
+    }
+
+    void FileObserver::set_buffer_size(size_t size)
+    {
+        auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size = std::max((size + page_size - 1) / page_size * page_size, page_size);
+
+        buffer_type buffer{std::aligned_alloc(page_size, size)};
+        if (! buffer)
+        {
+            throw std::bad_alloc{};
+        }
+
+        m_buffer = std::move(buffer);
+        m_buffer_size = size;
+
+        // Every event is at least the size of the metadata, so this is the most one read can return.
+        m_events.reserve(size / sizeof(event_metadata_type));
+    }
+
+    size_t FileObserver::get_buffer_size() const
+    {
+        return m_buffer_size;
+    }
+
+    FileObserver::Statistics FileObserver::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock{m_statistics_mutex};
+        return m_statistics;
+    }
+
+    void FileObserver::reset_statistics()
+    {
+        std::lock_guard<std::mutex> lock{m_statistics_mutex};
+        m_statistics = Statistics{};
+    }
+
+    void FileObserver::read_events(const batch_callback_type & batch_callback, const bool & keep_monitoring)
+    {
+        auto bytes_read = read(m_notifier_fd, m_buffer.get(), m_buffer_size);
+        if (bytes_read < 0 && errno != EAGAIN)
+        {
+            throw std::system_error{errno, std::system_category(), "read failed"};
+        }
+
+        if (bytes_read <= 0)
+        {
+            return;
+        }
+
+        // FAN_EVENT_NEXT counts bytes_read down as it steps through the buffer.
+        auto bytes_returned = static_cast<size_t>(bytes_read);
+        m_events.clear();
+        auto current_event = static_cast<event_metadata_type *>(m_buffer.get());
+        while (FAN_EVENT_OK(current_event, bytes_read))
+        {
+            if (current_event->vers != FANOTIFY_METADATA_VERSION)
+            {
+                throw std::runtime_error{"Mismatched event metadata version"};
+            }
+
+            m_events.emplace_back(current_event);
+            current_event = FAN_EVENT_NEXT(current_event, bytes_read);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{m_statistics_mutex};
+            m_statistics.reads++;
+            m_statistics.events += m_events.size();
+            m_statistics.bytes += bytes_returned;
+            m_statistics.max_events_per_read = std::max(m_statistics.max_events_per_read, m_events.size());
+        }
+
+        if (keep_monitoring)
+        {
+            batch_callback(event_list_type{m_events});
+        }
     }
 
 } // namespace TF::Linux
@@ -28,9 +28,17 @@ SOFTWARE.
 #ifndef TFFILEOBSERVER_HPP
 #define TFFILEOBSERVER_HPP
 
+#include <chrono>
+#include <cstdlib>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
 #include <sys/fanotify.h>
 #include "TFFoundation.hpp"
+#include "tffileevent.hpp"
 
 using namespace TF::Foundation;
 
@@ -42,6 +50,41 @@ namespace TF::Linux
     public:
         using string_type = String;
         using event_metadata_type = struct fanotify_event_metadata;
+        using response_type = struct fanotify_response;
+        using response_list_type = std::span<const response_type>;
+        using event_callback_type = std::function<void(event_metadata_type *)>;
+        using file_event_callback_type = std::function<void(FileEvent &)>;
+        using event_list_type = std::span<event_metadata_type * const>;
+        using batch_callback_type = std::function<void(event_list_type)>;
+        using handle_callback_type = std::function<void(int)>;
+        using clock_type = std::chrono::steady_clock;
+
+        /**
+         * The Statistics struct counts the reads made by run and the events they returned.
+         */
+        struct Statistics
+        {
+            size_t reads{0};
+            size_t events{0};
+            size_t bytes{0};
+            size_t max_events_per_read{0};
+            // Time spent in run since the statistics were last reset.
+            clock_type::duration elapsed{};
+
+            /**
+             * @brief method to get the rate of reads while running.
+             * @return the number of reads per second, 0 if run has not been called.
+             */
+            [[nodiscard]] double get_reads_per_second() const;
+
+            /**
+             * @brief method to get the average number of events returned by a read.
+             * @return the number of events per read, 0 if nothing has been read.
+             */
+            [[nodiscard]] double get_events_per_read() const;
+        };
+
+        constexpr static size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
 
         FileObserver(unsigned int flags, unsigned int modes);
 
@@ -51,15 +94,155 @@ namespace TF::Linux
 
         void mark(uint32_t flags, uint64_t mask, int dirfd, const string_type & path) const;
 
-        void run(const std::function<void(event_metadata_type *)> & event_callback);
-
+        /**
+         * @brief method to run the observer, calling the callback once for each event.
+         * @param event_callback the function to call with each event.
+         *
+         * The method blocks in epoll until another thread calls stop, so an idle observer does
+         * not wake up.  The handles and observers added to this observer are served by the same
+         * loop.
+         */
+        void run(const event_callback_type & event_callback);
+
+        /**
+         * @brief method to run the observer, calling the callback with each event as a FileEvent.
+         * @param file_event_callback the function to call with each event.
+         *
+         * The event owns its file descriptor, which is closed when the callback returns unless
+         * the callback moves the event elsewhere or releases the descriptor.
+         */
+        void run(const file_event_callback_type & file_event_callback);
+
+        /**
+         * @brief method to run the observer and deliver the events returned by each read together.
+         * @param batch_callback the function to call with the events from each read, in order.
+         *
+         * The pointers in the list refer to the read buffer and are only valid during the call.
+         */
+        void run(const batch_callback_type & batch_callback);
+
+        /**
+         * @brief method to make a running observer return, safe to call from any thread.
+         */
         void stop();
 
+        /**
+         * @brief method to answer permission events.
+         * @param responses the responses, each naming the fd of an event and FAN_ALLOW or FAN_DENY.
+         *
+         * @return the number of responses the kernel rejected, for example because no event
+         * with that descriptor is waiting for an answer.
+         *
+         * The kernel takes one response per write, so the responses are written with writev,
+         * which answers a whole batch in one system call.  Keep the events' descriptors open
+         * until this returns, since the kernel matches responses to events by descriptor number.
+         */
+        size_t respond(response_list_type responses) const;
+
+        /**
+         * @brief method to get the fanotify file descriptor.
+         * @return the file descriptor, owned by the observer.
+         */
+        [[nodiscard]] int get_file_descriptor() const;
+
+        /**
+         * @brief method to add a file descriptor to the loop run by this observer.
+         * @param fd the file descriptor, which stays owned by the caller.
+         * @param callback the function to call with @e fd each time it is readable.
+         *
+         * Adding a file descriptor that was already added replaces its callback.  Handles may be
+         * added and removed before run is called or from inside a callback, not from another
+         * thread while run is in progress.
+         */
+        void add_handle(int fd, const handle_callback_type & callback);
+
+        /**
+         * @brief method to remove a file descriptor added with add_handle.
+         * @param fd the file descriptor
+         */
+        void remove_handle(int fd);
+
+        /**
+         * @brief method to serve the events of another fanotify group from this observer's loop.
+         * @param observer the other observer, which must outlive its registration.
+         * @param batch_callback the function to call with the events from each read of @e observer.
+         *
+         * This lets groups with different flags, for example a notification group and a
+         * permission group, share one thread.  The events are read into @e observer's buffer
+         * and counted in its statistics.  Do not call run on @e observer while it is added.
+         */
+        void add_observer(FileObserver & observer, const batch_callback_type & batch_callback);
+
+        /**
+         * @brief method to stop serving an observer added with add_observer.
+         * @param observer the other observer
+         */
+        void remove_observer(const FileObserver & observer);
+
+        /**
+         * @brief method to set the size of the buffer events are read into.
+         * @param size the size in bytes, rounded up to a whole number of pages.
+         *
+         * A larger buffer returns more events from each read under heavy load.  The buffer
+         * cannot be resized while run is in progress.
+         */
+        void set_buffer_size(size_t size);
+
+        /**
+         * @brief method to get the size of the buffer events are read into.
+         * @return the size in bytes.
+         */
+        [[nodiscard]] size_t get_buffer_size() const;
+
+        /**
+         * @brief method to get the read and event counts, safe to call while run is in progress.
+         * @return the statistics.
+         */
+        [[nodiscard]] Statistics get_statistics() const;
+
+        /**
+         * @brief method to set the statistics back to zero.
+         */
+        void reset_statistics();
+
     private:
+        struct BufferDeleter
+        {
+            void operator()(void * buffer) const
+            {
+                std::free(buffer);
+            }
+        };
+
+        using buffer_type = std::unique_ptr<void, BufferDeleter>;
+
+        /**
+         * @brief helper method to read the queued events and pass them to the callback.
+         * @param batch_callback the callback
+         * @param keep_monitoring false once stop has been called, the rest of the events are dropped.
+         */
+        void read_events(const batch_callback_type & batch_callback, const bool & keep_monitoring);
+
+        /**
+         * @brief helper method to wait for the handles to become readable and call their callbacks.
+         */
+        void wait_for_events();
+
         int m_notifier_fd;
-        int m_pipe_fd[2];
 
-        const static int EVENT_BUFFER_SIZE = 100;
+        // The epoll set run waits on, the eventfd stop uses to wake it and the callback for each handle.
+        int m_epoll_fd;
+        int m_stop_fd;
+        std::unordered_map<int, std::shared_ptr<handle_callback_type>> m_handles;
+        bool m_keep_monitoring{false};
+
+        // Page aligned buffer for reading events and the list of events handed to the callback.
+        buffer_type m_buffer;
+        size_t m_buffer_size;
+        std::vector<event_metadata_type *> m_events;
+
+        mutable std::mutex m_statistics_mutex;
+        Statistics m_statistics;
     };
 
 } // namespace TF::Linux
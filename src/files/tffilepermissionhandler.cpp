@@ -0,0 +1,198 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <sys/stat.h>
+#include "tffilepermissionhandler.hpp"
+
+namespace TF::Linux
+{
+
+    FilePermissionHandler::FilePermissionHandler(const observer_type & observer,
+                                                 const decision_callback_type & decision_callback,
+                                                 const Options & options) :
+        m_observer{observer}, m_decision_callback{decision_callback}, m_options{options}
+    {}
+
+    FilePermissionHandler::FilePermissionHandler(const observer_type & observer,
+                                                 const decision_callback_type & decision_callback) :
+        FilePermissionHandler{observer, decision_callback, Options{}}
+    {}
+
+    void FilePermissionHandler::handle(event_list_type events)
+    {
+        auto read_time = clock_type::now();
+        for (auto event : events)
+        {
+            event_type file_event{event};
+            if (! is_permission_event(file_event))
+            {
+                continue;
+            }
+
+            auto verdict = decide(file_event, read_time);
+            auto response = static_cast<uint32_t>(verdict == Verdict::ALLOW ? FAN_ALLOW : FAN_DENY);
+            m_responses.push_back(FileObserver::response_type{file_event.get_file_descriptor(), response});
+            m_pending_events.emplace_back(std::move(file_event));
+
+            std::lock_guard<std::mutex> lock{m_statistics_mutex};
+            m_statistics.events++;
+            (verdict == Verdict::ALLOW ? m_statistics.allowed : m_statistics.denied)++;
+        }
+        flush();
+    }
+
+    void FilePermissionHandler::invalidate(dev_t device, ino_t inode)
+    {
+        std::lock_guard<std::mutex> lock{m_cache_mutex};
+        auto index_iterator = m_cache_index.find(FileKey{device, inode});
+        if (index_iterator != m_cache_index.end())
+        {
+            m_cache_entries.erase(index_iterator->second);
+            m_cache_index.erase(index_iterator);
+        }
+    }
+
+    void FilePermissionHandler::clear_cache()
+    {
+        std::lock_guard<std::mutex> lock{m_cache_mutex};
+        m_cache_entries.clear();
+        m_cache_index.clear();
+    }
+
+    size_t FilePermissionHandler::get_cache_size() const
+    {
+        std::lock_guard<std::mutex> lock{m_cache_mutex};
+        return m_cache_entries.size();
+    }
+
+    FilePermissionHandler::Statistics FilePermissionHandler::get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock{m_statistics_mutex};
+        return m_statistics;
+    }
+
+    void FilePermissionHandler::reset_statistics()
+    {
+        std::lock_guard<std::mutex> lock{m_statistics_mutex};
+        m_statistics = Statistics{};
+    }
+
+    bool FilePermissionHandler::is_permission_event(const event_type & event)
+    {
+        return (event.get_mask() & (FAN_OPEN_PERM | FAN_ACCESS_PERM | FAN_OPEN_EXEC_PERM)) != 0 &&
+               event.get_file_descriptor() >= 0;
+    }
+
+    size_t FilePermissionHandler::FileKeyHash::operator()(const FileKey & key) const
+    {
+        return std::hash<uint64_t>{}(static_cast<uint64_t>(key.device) * 0x9e3779b97f4a7c15ULL ^
+                                     static_cast<uint64_t>(key.inode));
+    }
+
+    FilePermissionHandler::Verdict FilePermissionHandler::decide(event_type & event, clock_type::time_point read_time)
+    {
+        struct stat file_stat{};
+        auto have_stat = m_options.cache_capacity > 0 && fstat(event.get_file_descriptor(), &file_stat) == 0;
+        FileKey key{file_stat.st_dev, file_stat.st_ino};
+        FileStamp stamp{file_stat.st_mtim.tv_sec * 1000000000LL + file_stat.st_mtim.tv_nsec,
+                        file_stat.st_ctim.tv_sec * 1000000000LL + file_stat.st_ctim.tv_nsec, file_stat.st_size};
+
+        if (have_stat)
+        {
+            std::lock_guard<std::mutex> lock{m_cache_mutex};
+            auto index_iterator = m_cache_index.find(key);
+            if (index_iterator != m_cache_index.end() && index_iterator->second->stamp == stamp)
+            {
+                m_cache_entries.splice(m_cache_entries.begin(), m_cache_entries, index_iterator->second);
+                std::lock_guard<std::mutex> statistics_lock{m_statistics_mutex};
+                m_statistics.cache_hits++;
+                return m_cache_entries.front().verdict;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock{m_statistics_mutex};
+            m_statistics.cache_misses++;
+            if (clock_type::now() - read_time > m_options.max_handler_delay)
+            {
+                m_statistics.late_events++;
+                return m_options.default_verdict;
+            }
+        }
+
+        // Answer the events already decided before the callback, which may take a while.
+        flush();
+
+        Verdict verdict;
+        try
+        {
+            verdict = m_decision_callback(event);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock{m_statistics_mutex};
+            m_statistics.callback_errors++;
+            return m_options.default_verdict;
+        }
+
+        if (have_stat)
+        {
+            std::lock_guard<std::mutex> lock{m_cache_mutex};
+            auto index_iterator = m_cache_index.find(key);
+            if (index_iterator != m_cache_index.end())
+            {
+                m_cache_entries.erase(index_iterator->second);
+                m_cache_index.erase(index_iterator);
+            }
+            m_cache_entries.emplace_front(CacheEntry{key, stamp, verdict});
+            m_cache_index.emplace(key, m_cache_entries.begin());
+            while (m_cache_entries.size() > m_options.cache_capacity)
+            {
+                m_cache_index.erase(m_cache_entries.back().key);
+                m_cache_entries.pop_back();
+            }
+        }
+        return verdict;
+    }
+
+    void FilePermissionHandler::flush()
+    {
+        if (m_responses.empty())
+        {
+            return;
+        }
+
+        auto rejected = m_observer.respond(m_responses);
+        m_responses.clear();
+        m_pending_events.clear();
+
+        std::lock_guard<std::mutex> lock{m_statistics_mutex};
+        m_statistics.response_writes++;
+        m_statistics.rejected_responses += rejected;
+    }
+
+} // namespace TF::Linux
@@ -0,0 +1,238 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFFILEPERMISSIONHANDLER_HPP
+#define TFFILEPERMISSIONHANDLER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "tffileevent.hpp"
+#include "tffileobserver.hpp"
+
+namespace TF::Linux
+{
+
+    /**
+     * The FilePermissionHandler class answers the permission events, FAN_OPEN_PERM,
+     * FAN_ACCESS_PERM and FAN_OPEN_EXEC_PERM, of a FileObserver created with
+     * FAN_CLASS_CONTENT or FAN_CLASS_PRE_CONTENT.
+     *
+     * A decision callback says whether each file may be opened or read.  Verdicts are cached
+     * by device and inode together with the file's modification time, change time and size,
+     * so a file that has not changed since it was last decided is answered without calling
+     * the callback.  The kernel does not expose i_version to user space, so the change time
+     * stands in for it.  Responses are collected and written for a whole read with one
+     * system call, and are written before each call to the callback, so answered events never
+     * wait behind a slow decision.
+     *
+     * The application that opened the file is blocked until the event is answered.  To bound
+     * how long a slow batch holds it up, an event whose turn comes more than the maximum handler
+     * delay after the read that returned it is given the default verdict without calling the
+     * callback, as is an event whose callback throws.  The delay only counts time spent in the
+     * handler: the time the event waited in the kernel queue before the read is not known to
+     * user space, and a callback that is already running is not interrupted.
+     *
+     * Pass handle as the batch callback of FileObserver::run or FileObserver::add_observer.
+     * Events that are not permission events are ignored.  The handle method must only be
+     * called from one thread; the cache methods and get_statistics may be called from any
+     * thread.
+     */
+    class FilePermissionHandler
+    {
+    public:
+        using observer_type = FileObserver;
+        using event_type = FileEvent;
+        using event_list_type = FileObserver::event_list_type;
+        using clock_type = std::chrono::steady_clock;
+
+        enum class Verdict
+        {
+            ALLOW,
+            DENY
+        };
+
+        using decision_callback_type = std::function<Verdict(event_type &)>;
+
+        /** The policy for answering events. */
+        struct Options
+        {
+            // Events reached this long after their read, without the kernel queue time, get the
+            // default verdict.
+            std::chrono::milliseconds max_handler_delay{1000};
+            Verdict default_verdict{Verdict::ALLOW};
+            // The largest number of verdicts cached, 0 turns the cache off.
+            size_t cache_capacity{DEFAULT_CACHE_CAPACITY};
+        };
+
+        /** The number of events answered and how they were answered. */
+        struct Statistics
+        {
+            size_t events{0};
+            size_t allowed{0};
+            size_t denied{0};
+            size_t cache_hits{0};
+            size_t cache_misses{0};
+            size_t late_events{0};
+            size_t callback_errors{0};
+            size_t response_writes{0};
+            size_t rejected_responses{0};
+        };
+
+        constexpr static size_t DEFAULT_CACHE_CAPACITY = 65536;
+
+        /**
+         * @brief constructor with observer, decision callback and options
+         * @param observer the observer whose permission events are answered, which must outlive
+         * the handler.
+         * @param decision_callback the function that decides whether to allow each event.
+         * @param options the policy
+         */
+        FilePermissionHandler(const observer_type & observer, const decision_callback_type & decision_callback,
+                              const Options & options);
+
+        /**
+         * @brief constructor with observer and decision callback, using the default options
+         * @param observer the observer whose permission events are answered
+         * @param decision_callback the function that decides whether to allow each event.
+         */
+        FilePermissionHandler(const observer_type & observer, const decision_callback_type & decision_callback);
+
+        /**
+         * @brief method to answer the permission events from one read of the observer.
+         * @param events the events
+         */
+        void handle(event_list_type events);
+
+        /**
+         * @brief method to remove the cached verdict for a file.
+         * @param device the device of the file
+         * @param inode the inode of the file
+         */
+        void invalidate(dev_t device, ino_t inode);
+
+        /**
+         * @brief method to remove every cached verdict, for example after the rules used by the
+         * decision callback change.
+         */
+        void clear_cache();
+
+        /**
+         * @brief method to get the number of cached verdicts.
+         * @return the number of verdicts.
+         */
+        [[nodiscard]] size_t get_cache_size() const;
+
+        /**
+         * @brief method to get the counts of events answered, safe to call from any thread.
+         * @return the statistics.
+         */
+        [[nodiscard]] Statistics get_statistics() const;
+
+        /**
+         * @brief method to set the statistics back to zero.
+         */
+        void reset_statistics();
+
+        /**
+         * @brief function to check if an event is a permission event.
+         * @param event the event
+         * @return true if the event waits for a response.
+         */
+        [[nodiscard]] static bool is_permission_event(const event_type & event);
+
+    private:
+        struct FileKey
+        {
+            dev_t device;
+            ino_t inode;
+
+            bool operator==(const FileKey &) const = default;
+        };
+
+        struct FileKeyHash
+        {
+            size_t operator()(const FileKey & key) const;
+        };
+
+        // The times and size a verdict was made for, a verdict only applies while they match.
+        struct FileStamp
+        {
+            int64_t modified_ns;
+            int64_t changed_ns;
+            off_t size;
+
+            bool operator==(const FileStamp &) const = default;
+        };
+
+        struct CacheEntry
+        {
+            FileKey key;
+            FileStamp stamp;
+            Verdict verdict;
+        };
+
+        using entry_list_type = std::list<CacheEntry>;
+
+        /**
+         * @brief helper method to decide the verdict for one event.
+         * @param event the event
+         * @param read_time the time the event was read
+         * @return the verdict.
+         */
+        Verdict decide(event_type & event, clock_type::time_point read_time);
+
+        /**
+         * @brief helper method to write the collected responses and close their events.
+         */
+        void flush();
+
+        const observer_type & m_observer;
+        decision_callback_type m_decision_callback;
+        Options m_options;
+
+        // Responses waiting to be written and the events they answer, kept open until then.
+        std::vector<FileObserver::response_type> m_responses;
+        std::vector<event_type> m_pending_events;
+
+        // Verdicts in order of use, most recent first, and an index into the list.
+        mutable std::mutex m_cache_mutex;
+        entry_list_type m_cache_entries;
+        std::unordered_map<FileKey, entry_list_type::iterator, FileKeyHash> m_cache_index;
+
+        mutable std::mutex m_statistics_mutex;
+        Statistics m_statistics;
+    };
+
+} // namespace TF::Linux
+
+#endif // TFFILEPERMISSIONHANDLER_HPP
@@ -25,14 +25,34 @@ SOFTWARE.
 
 ******************************************************************************/
 
+#include "tfasyncmonitor.hpp"
+#include "tfattributecache.hpp"
+#include "tfattributewriter.hpp"
 #include "tfautofiledescriptor.hpp"
+#include "tfcontextpool.hpp"
+#include "tfdeviceinventory.hpp"
+#include "tfdevicenumbercache.hpp"
+#include "tfdevicetree.hpp"
+#include "tfeventrecorder.hpp"
+#include "tfeventsource.hpp"
 #include "tfexceptions.hpp"
+#include "tffileevent.hpp"
+#include "tffileeventdispatcher.hpp"
+#include "tffileio.hpp"
 #include "tffileobserver.hpp"
+#include "tffilepermissionhandler.hpp"
 #include "tffilesystems.hpp"
 #include "tfitemcopier.hpp"
+#include "tflatencyhistogram.hpp"
+#include "tfmonitorcoalescer.hpp"
+#include "tfmonitorepolladaptor.hpp"
+#include "tfmonitorfilter.hpp"
 #include "tfmounter.hpp"
 #include "tfmounttable.hpp"
 #include "tfnetworkconfiguration.hpp"
 #include "tfnetworkmanager.hpp"
+#include "tfparallelquery.hpp"
+#include "tfstringpool.hpp"
+#include "tfsysfsattributeloader.hpp"
 #include "tfsystemdservice.hpp"
 #include "tfudev.hpp"
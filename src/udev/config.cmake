@@ -6,7 +6,39 @@
 ################################################################################
 
 list(APPEND LIBRARY_HEADER_FILES
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfasyncmonitor.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfattributecache.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfattributewriter.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfcontextpool.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfdeviceinventory.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfdevicenumbercache.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfdevicetree.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfeventrecorder.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfeventsource.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tflatencyhistogram.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfmonitorcoalescer.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfmonitorepolladaptor.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfmonitorfilter.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfparallelquery.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfstringpool.hpp"
+        "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfsysfsattributeloader.hpp"
         "${CMAKE_CURRENT_SOURCE_DIR}/src/udev/tfudev.hpp")
 
 list(APPEND LIBRARY_SOURCE_FILES
+        src/udev/tfasyncmonitor.cpp
+        src/udev/tfattributecache.cpp
+        src/udev/tfattributewriter.cpp
+        src/udev/tfcontextpool.cpp
+        src/udev/tfdeviceinventory.cpp
+        src/udev/tfdevicenumbercache.cpp
+        src/udev/tfdevicetree.cpp
+        src/udev/tfeventrecorder.cpp
+        src/udev/tfeventsource.cpp
+        src/udev/tflatencyhistogram.cpp
+        src/udev/tfmonitorcoalescer.cpp
+        src/udev/tfmonitorepolladaptor.cpp
+        src/udev/tfmonitorfilter.cpp
+        src/udev/tfparallelquery.cpp
+        src/udev/tfstringpool.cpp
+        src/udev/tfsysfsattributeloader.cpp
         src/udev/tfudev.cpp)
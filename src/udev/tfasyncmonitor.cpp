@@ -0,0 +1,262 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cerrno>
+#include <limits>
+#include <system_error>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "tfasyncmonitor.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    Reactor::Reactor() : m_epoll_fd{-1}, m_stop_fd{-1}, m_stopping{false}
+    {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_create1 failed"};
+        }
+
+        m_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_stop_fd < 0)
+        {
+            auto error = errno;
+            (void)close(m_epoll_fd);
+            throw std::system_error{error, std::system_category(), "eventfd failed"};
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = m_stop_fd;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &event) < 0)
+        {
+            auto error = errno;
+            (void)close(m_stop_fd);
+            (void)close(m_epoll_fd);
+            throw std::system_error{error, std::system_category(), "epoll_ctl failed"};
+        }
+    }
+
+    Reactor::~Reactor()
+    {
+        (void)close(m_stop_fd);
+        (void)close(m_epoll_fd);
+    }
+
+    void Reactor::add(int fd, callback_type callback)
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        auto operation = m_callbacks.contains(fd) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (epoll_ctl(m_epoll_fd, operation, fd, &event) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+        m_callbacks[fd] = std::make_shared<callback_type>(std::move(callback));
+    }
+
+    void Reactor::remove(int fd)
+    {
+        if (m_callbacks.erase(fd) > 0 && epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+    }
+
+    size_t Reactor::run_once(std::chrono::milliseconds timeout)
+    {
+        constexpr int max_events = 64;
+        epoll_event events[max_events];
+        auto timeout_count = std::min<std::chrono::milliseconds::rep>(timeout.count(), std::numeric_limits<int>::max());
+        auto event_count = epoll_wait(m_epoll_fd, events, max_events, static_cast<int>(timeout_count));
+        if (event_count < 0)
+        {
+            if (errno == EINTR)
+            {
+                return 0;
+            }
+            throw std::system_error{errno, std::system_category(), "epoll_wait failed"};
+        }
+
+        size_t called{0};
+        for (int i = 0; i < event_count; i++)
+        {
+            auto fd = events[i].data.fd;
+            if (fd == m_stop_fd)
+            {
+                eventfd_t value{0};
+                (void)eventfd_read(m_stop_fd, &value);
+                m_stopping = true;
+                continue;
+            }
+
+            // An earlier callback may have removed this watch.
+            auto iterator = m_callbacks.find(fd);
+            if (iterator != m_callbacks.end())
+            {
+                auto callback = iterator->second;
+                (*callback)();
+                called++;
+            }
+        }
+        return called;
+    }
+
+    void Reactor::run()
+    {
+        m_stopping = false;
+        while (! m_stopping)
+        {
+            (void)run_once();
+        }
+    }
+
+    void Reactor::stop()
+    {
+        (void)eventfd_write(m_stop_fd, 1);
+    }
+
+    size_t Reactor::get_watch_count() const
+    {
+        return m_callbacks.size();
+    }
+
+    AsyncMonitor::AsyncMonitor(monitor_type & monitor, reactor_type & reactor) :
+        m_monitor{monitor}, m_reactor{reactor}, m_watching{false}, m_cancelled{false}
+    {}
+
+    AsyncMonitor::~AsyncMonitor()
+    {
+        if (m_watching)
+        {
+            m_reactor.remove(m_monitor.get_file_descriptor());
+        }
+    }
+
+    AsyncMonitor::NextEventAwaiter AsyncMonitor::next_event()
+    {
+        return NextEventAwaiter{*this};
+    }
+
+    AsyncGenerator<AsyncMonitor::device_type> AsyncMonitor::devices()
+    {
+        while (true)
+        {
+            auto device = co_await next_event();
+            if (! device)
+            {
+                co_return;
+            }
+            co_yield std::move(*device);
+        }
+    }
+
+    void AsyncMonitor::cancel()
+    {
+        m_cancelled = true;
+        auto waiters = std::move(m_waiters);
+        m_waiters.clear();
+        update_watch();
+        for (auto & waiter : waiters)
+        {
+            waiter.handle.resume();
+        }
+    }
+
+    bool AsyncMonitor::is_cancelled() const
+    {
+        return m_cancelled;
+    }
+
+    size_t AsyncMonitor::get_waiting_count() const
+    {
+        return m_waiters.size();
+    }
+
+    bool AsyncMonitor::suspend(NextEventAwaiter * awaiter, std::coroutine_handle<> handle)
+    {
+        if (m_cancelled)
+        {
+            return false;
+        }
+
+        // Only take a queued device directly if that does not jump ahead of a waiting coroutine.
+        if (m_waiters.empty())
+        {
+            awaiter->m_device = m_monitor.try_get_device();
+            if (awaiter->m_device)
+            {
+                return false;
+            }
+        }
+
+        // Watch the monitor before queueing the waiter.  If add throws, the coroutine resumes
+        // with the exception and must not be left in the queue for dispatch to resume again.
+        if (! m_watching)
+        {
+            m_reactor.add(m_monitor.get_file_descriptor(), [this]() {
+                dispatch();
+            });
+            m_watching = true;
+        }
+        m_waiters.push_back(Waiter{awaiter, handle});
+        return true;
+    }
+
+    void AsyncMonitor::dispatch()
+    {
+        while (! m_waiters.empty())
+        {
+            auto device = m_monitor.try_get_device();
+            if (! device)
+            {
+                break;
+            }
+            auto waiter = m_waiters.front();
+            m_waiters.pop_front();
+            waiter.awaiter->m_device = std::move(device);
+            // The coroutine may wait again before resume returns, which adds it to the back of the queue.
+            waiter.handle.resume();
+        }
+        update_watch();
+    }
+
+    void AsyncMonitor::update_watch()
+    {
+        if (m_watching && m_waiters.empty())
+        {
+            m_reactor.remove(m_monitor.get_file_descriptor());
+            m_watching = false;
+        }
+    }
+
+} // namespace TF::Linux::Udev
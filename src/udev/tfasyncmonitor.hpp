@@ -0,0 +1,421 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFASYNCMONITOR_HPP
+#define TFASYNCMONITOR_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include "tfudev.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The Reactor class is a single threaded epoll event loop that calls a function when a file
+     * descriptor becomes readable.  It drives the coroutines waiting on an AsyncMonitor.
+     *
+     * Watches are level-triggered, so a callback is called on every iteration of the loop
+     * until it has consumed what is readable or removed its watch.  Callbacks may add and remove
+     * watches, including their own.  All methods must be called on the thread running the loop,
+     * except stop, which may be called from any thread.
+     */
+    class Reactor
+    {
+    public:
+        using callback_type = std::function<void()>;
+
+        /** @brief default constructor */
+        Reactor();
+
+        Reactor(const Reactor &) = delete;
+        Reactor & operator=(const Reactor &) = delete;
+
+        /** @brief destructor */
+        ~Reactor();
+
+        /**
+         * @brief method to call a function whenever a file descriptor is readable.
+         * @param fd the file descriptor
+         * @param callback the function
+         */
+        void add(int fd, callback_type callback);
+
+        /**
+         * @brief method to stop watching a file descriptor.
+         * @param fd the file descriptor
+         */
+        void remove(int fd);
+
+        /**
+         * @brief method to wait for file descriptors to become readable once and call their callbacks.
+         * @param timeout the longest time to wait, negative to wait until a file descriptor is
+         * readable or stop is called.
+         * @return the number of callbacks called.
+         */
+        size_t run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+
+        /**
+         * @brief method to run the loop until stop is called.
+         */
+        void run();
+
+        /**
+         * @brief method to make run return.  Safe to call from any thread.
+         */
+        void stop();
+
+        /**
+         * @brief method to get the number of watched file descriptors.
+         * @return the number of watches.
+         */
+        [[nodiscard]] size_t get_watch_count() const;
+
+    private:
+        int m_epoll_fd;
+        int m_stop_fd;
+        bool m_stopping;
+        // Callbacks are shared so that one can remove its own watch while it is running.
+        std::unordered_map<int, std::shared_ptr<callback_type>> m_callbacks;
+    };
+
+    /**
+     * The DetachedTask class is the return type of a coroutine that starts immediately, runs
+     * on its own and destroys itself when it finishes, for example a handler started for each
+     * monitor.  An exception escaping the coroutine terminates the program.
+     */
+    class DetachedTask
+    {
+    public:
+        struct promise_type
+        {
+            DetachedTask get_return_object() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            std::suspend_never final_suspend() noexcept
+            {
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept
+            {
+                std::terminate();
+            }
+        };
+    };
+
+    /**
+     * The AsyncGenerator class template is the return type of a coroutine that produces a
+     * sequence of values with co_yield while itself awaiting other operations with co_await.
+     *
+     * The consumer asks for each value with co_await generator.next(), which runs the generator
+     * until it yields, and receives an empty optional once the generator returns.  An exception
+     * thrown by the generator is rethrown by next.  The generator does not start before the first
+     * call to next and is destroyed with the AsyncGenerator object.
+     */
+    template<typename T>
+    class AsyncGenerator
+    {
+    public:
+        struct promise_type;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        /** Suspends the generator and resumes the consumer waiting in next. */
+        struct ResumeConsumer
+        {
+            bool await_ready() noexcept
+            {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(handle_type handle) noexcept
+            {
+                return handle.promise().consumer;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        struct promise_type
+        {
+            std::optional<T> value;
+            std::coroutine_handle<> consumer;
+            std::exception_ptr error;
+
+            AsyncGenerator get_return_object() noexcept
+            {
+                return AsyncGenerator{handle_type::from_promise(*this)};
+            }
+
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            ResumeConsumer final_suspend() noexcept
+            {
+                return {};
+            }
+
+            ResumeConsumer yield_value(T v)
+            {
+                value.emplace(std::move(v));
+                return {};
+            }
+
+            void return_void() noexcept {}
+
+            void unhandled_exception() noexcept
+            {
+                error = std::current_exception();
+            }
+        };
+
+        /** The awaitable returned by next. */
+        class NextAwaiter
+        {
+        public:
+            explicit NextAwaiter(handle_type handle) : m_handle{handle} {}
+
+            bool await_ready() const noexcept
+            {
+                return ! m_handle || m_handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept
+            {
+                m_handle.promise().consumer = consumer;
+                m_handle.promise().value.reset();
+                return m_handle;
+            }
+
+            std::optional<T> await_resume()
+            {
+                if (! m_handle)
+                {
+                    return {};
+                }
+                auto & promise = m_handle.promise();
+                if (promise.error)
+                {
+                    std::rethrow_exception(std::exchange(promise.error, nullptr));
+                }
+                auto value = std::move(promise.value);
+                promise.value.reset();
+                return value;
+            }
+
+        private:
+            handle_type m_handle;
+        };
+
+        AsyncGenerator(const AsyncGenerator &) = delete;
+        AsyncGenerator & operator=(const AsyncGenerator &) = delete;
+
+        AsyncGenerator(AsyncGenerator && g) noexcept : m_handle{std::exchange(g.m_handle, nullptr)} {}
+
+        AsyncGenerator & operator=(AsyncGenerator && g) noexcept
+        {
+            if (this != &g)
+            {
+                if (m_handle)
+                {
+                    m_handle.destroy();
+                }
+                m_handle = std::exchange(g.m_handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~AsyncGenerator()
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+        }
+
+        /**
+         * @brief method to get the next value.
+         * @return an awaitable producing the value, or an empty optional once the generator has returned.
+         */
+        [[nodiscard]] NextAwaiter next()
+        {
+            return NextAwaiter{m_handle};
+        }
+
+    private:
+        explicit AsyncGenerator(handle_type handle) : m_handle{handle} {}
+
+        handle_type m_handle;
+    };
+
+    /**
+     * The AsyncMonitor class lets coroutines wait for devices from a Monitor without blocking a
+     * thread, using a Reactor to learn when the monitor has devices queued.
+     *
+     * Any number of coroutines may wait on one AsyncMonitor; each device received goes to the
+     * coroutine that has waited longest, so the waiting coroutines share the stream of devices
+     * like a work queue.  A coroutine that asks for a device while devices are queued and no
+     * other coroutine is waiting gets one without suspending.  The monitor is only watched by
+     * the reactor while a coroutine is waiting.
+     *
+     * The AsyncMonitor object must be used on the reactor's thread, and must outlive the
+     * coroutines waiting on it; call cancel to wake them up first.
+     */
+    class AsyncMonitor
+    {
+    public:
+        using monitor_type = Monitor;
+        using device_type = Device;
+        using reactor_type = Reactor;
+
+        /** The awaitable returned by next_event. */
+        class NextEventAwaiter
+        {
+        public:
+            explicit NextEventAwaiter(AsyncMonitor & monitor) : m_monitor{monitor} {}
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle)
+            {
+                return m_monitor.suspend(this, handle);
+            }
+
+            std::optional<device_type> await_resume()
+            {
+                return std::move(m_device);
+            }
+
+        private:
+            AsyncMonitor & m_monitor;
+            std::optional<device_type> m_device;
+
+            friend class AsyncMonitor;
+        };
+
+        /**
+         * @brief constructor with monitor and reactor
+         * @param monitor the monitor, already receiving, which must outlive the object.
+         * @param reactor the reactor, which must outlive the object.
+         */
+        AsyncMonitor(monitor_type & monitor, reactor_type & reactor);
+
+        AsyncMonitor(const AsyncMonitor &) = delete;
+        AsyncMonitor & operator=(const AsyncMonitor &) = delete;
+
+        /**
+         * @brief destructor, stops watching the monitor.
+         */
+        ~AsyncMonitor();
+
+        /**
+         * @brief method to wait for the next device.
+         * @return an awaitable producing the device, or an empty optional if cancel was called.
+         */
+        [[nodiscard]] NextEventAwaiter next_event();
+
+        /**
+         * @brief method to get the devices as an asynchronous sequence.
+         * @return a generator yielding each device received, which returns when cancel is called.
+         */
+        [[nodiscard]] AsyncGenerator<device_type> devices();
+
+        /**
+         * @brief method to wake every waiting coroutine with an empty optional and make later waits
+         * return an empty optional immediately.
+         */
+        void cancel();
+
+        /**
+         * @brief method to check whether cancel has been called.
+         * @return true if the monitor was cancelled.
+         */
+        [[nodiscard]] bool is_cancelled() const;
+
+        /**
+         * @brief method to get the number of coroutines waiting for a device.
+         * @return the number of waiting coroutines.
+         */
+        [[nodiscard]] size_t get_waiting_count() const;
+
+    private:
+        struct Waiter
+        {
+            NextEventAwaiter * awaiter;
+            std::coroutine_handle<> handle;
+        };
+
+        /**
+         * @brief helper method to suspend a coroutine until a device is received.
+         * @param awaiter the awaiter of the coroutine, which receives the device.
+         * @param handle the coroutine
+         * @return false if a device or the cancellation was delivered without suspending.
+         */
+        bool suspend(NextEventAwaiter * awaiter, std::coroutine_handle<> handle);
+
+        /**
+         * @brief helper method called by the reactor when the monitor is readable.
+         */
+        void dispatch();
+
+        /**
+         * @brief helper method to stop watching the monitor once no coroutine is waiting.
+         */
+        void update_watch();
+
+        monitor_type & m_monitor;
+        reactor_type & m_reactor;
+        std::deque<Waiter> m_waiters;
+        bool m_watching;
+        bool m_cancelled;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFASYNCMONITOR_HPP
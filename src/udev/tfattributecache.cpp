@@ -0,0 +1,120 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include "tfattributecache.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    AttributeCache::map_pointer AttributeCache::get(const string_type & syspath) const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto iterator = m_maps.find(syspath);
+        if (iterator == m_maps.end())
+        {
+            return nullptr;
+        }
+        return iterator->second;
+    }
+
+    AttributeCache::generation_type AttributeCache::get_generation() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_generation;
+    }
+
+    AttributeCache::map_pointer AttributeCache::insert(const string_type & syspath, string_map_type && map,
+                                                       generation_type generation)
+    {
+        auto map_to_insert = std::make_shared<const string_map_type>(std::move(map));
+        std::lock_guard<std::mutex> lock{m_mutex};
+        if (generation != m_generation)
+        {
+            // An invalidation raced with the load, so the map may already be stale.
+            return map_to_insert;
+        }
+        auto [iterator, inserted] = m_maps.emplace(syspath, map_to_insert);
+        return iterator->second;
+    }
+
+    void AttributeCache::invalidate(const string_type & syspath)
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_maps.erase(syspath);
+        m_generation++;
+    }
+
+    void AttributeCache::clear()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        m_maps.clear();
+        m_generation++;
+    }
+
+    AttributeCache::size_type AttributeCache::size() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_maps.size();
+    }
+
+    AttributeMapChain::AttributeMapChain(map_list_type && maps) : m_maps{std::move(maps)} {}
+
+    bool AttributeMapChain::contains(const string_type & key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    const AttributeMapChain::string_type * AttributeMapChain::find(const string_type & key) const
+    {
+        for (auto & map : m_maps)
+        {
+            auto iterator = map->find(key);
+            if (iterator != map->end())
+            {
+                return &iterator->second;
+            }
+        }
+        return nullptr;
+    }
+
+    AttributeMapChain::string_map_type AttributeMapChain::flatten() const
+    {
+        string_map_type attribute_map;
+        for (auto & map : m_maps)
+        {
+            // insert does not replace existing keys, so earlier maps take precedence.
+            attribute_map.insert(map->begin(), map->end());
+        }
+        return attribute_map;
+    }
+
+    const AttributeMapChain::map_list_type & AttributeMapChain::get_maps() const
+    {
+        return m_maps;
+    }
+
+} // namespace TF::Linux::Udev
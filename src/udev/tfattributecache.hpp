@@ -0,0 +1,175 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFATTRIBUTECACHE_HPP
+#define TFATTRIBUTECACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "TFFoundation.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The AttributeCache class holds the attribute maps loaded from /sys for individual
+     * device directories, keyed by the syspath of the device.
+     *
+     * Each map contains only the attributes of one device directory, not those of its parents,
+     * so a parent shared by many children is loaded once and referenced by all of them.  The
+     * maps are immutable once cached and are handed out as shared pointers, which keeps a map
+     * alive for readers even after it has been invalidated.  All methods are safe to call from
+     * multiple threads.
+     *
+     * A loader that reads a device directory while another thread invalidates it must not cache
+     * what it read, because the map may already be stale.  Loaders therefore take the cache
+     * generation before reading /sys and pass it to insert, which refuses the map if any
+     * invalidation happened in between.
+     */
+    class AttributeCache
+    {
+    public:
+        using string_type = String;
+        using string_map_type = std::unordered_map<String, String>;
+        using map_pointer = std::shared_ptr<const string_map_type>;
+        using size_type = size_t;
+        using generation_type = uint64_t;
+
+        /**
+         * @brief method to look up the attribute map for a syspath.
+         * @param syspath the syspath of the device
+         * @return the cached map or nullptr if the syspath is not cached.
+         */
+        [[nodiscard]] map_pointer get(const string_type & syspath) const;
+
+        /**
+         * @brief method to get the current generation of the cache.
+         * @return the generation.  It changes every time a map is invalidated or the cache is cleared.
+         */
+        [[nodiscard]] generation_type get_generation() const;
+
+        /**
+         * @brief method to add the attribute map for a syspath to the cache.
+         * @param syspath the syspath of the device
+         * @param map the attribute map of the device directory
+         * @param generation the generation returned by get_generation before @e map was read from /sys
+         * @return the cached map.  If another thread cached a map for @e syspath first, that
+         * map is returned and @e map is discarded.  If the cache was invalidated since
+         * @e generation, @e map is returned without being cached.
+         */
+        map_pointer insert(const string_type & syspath, string_map_type && map, generation_type generation);
+
+        /**
+         * @brief method to remove the attribute map for a syspath from the cache.
+         * @param syspath the syspath of the device
+         *
+         * Call this method when a device reports a change so that the next load reads the
+         * device directory again.  Monitor objects call it for every device they receive.
+         */
+        void invalidate(const string_type & syspath);
+
+        /**
+         * @brief method to remove every map from the cache.
+         */
+        void clear();
+
+        /**
+         * @brief method to get the number of syspaths in the cache.
+         * @return the number of cached maps.
+         */
+        [[nodiscard]] size_type size() const;
+
+    private:
+        mutable std::mutex m_mutex;
+        std::unordered_map<String, map_pointer> m_maps;
+        generation_type m_generation{0};
+    };
+
+    /**
+     * The AttributeMapChain class presents the attribute maps of a device and its parents as
+     * one map without copying them.
+     *
+     * The first map in the chain belongs to the device itself and the following maps belong to
+     * its parents in order, so lookups find the device's own attribute before a parent attribute
+     * with the same name, matching the precedence of Device::load_attributes_from_device_path.
+     */
+    class AttributeMapChain
+    {
+    public:
+        using string_type = String;
+        using string_map_type = std::unordered_map<String, String>;
+        using map_pointer = std::shared_ptr<const string_map_type>;
+        using map_list_type = std::vector<map_pointer>;
+
+        /** @brief default constructor */
+        AttributeMapChain() = default;
+
+        /**
+         * @brief constructor with a list of maps
+         * @param maps the maps, the device's map first followed by its parents' maps.
+         */
+        explicit AttributeMapChain(map_list_type && maps);
+
+        /**
+         * @brief method to check if any map in the chain contains an attribute.
+         * @param key the attribute name
+         * @return true if the attribute exists and false otherwise.
+         */
+        [[nodiscard]] bool contains(const string_type & key) const;
+
+        /**
+         * @brief method to get the value of an attribute.
+         * @param key the attribute name
+         * @return a pointer to the value owned by the chain, or nullptr if no map contains @e key.
+         */
+        [[nodiscard]] const string_type * find(const string_type & key) const;
+
+        /**
+         * @brief method to copy the chain into a single map.
+         * @return the merged map, identical to the result of Device::load_attributes_from_device_path.
+         */
+        [[nodiscard]] string_map_type flatten() const;
+
+        /**
+         * @brief method to get the maps that make up the chain.
+         * @return the list of maps.
+         */
+        [[nodiscard]] const map_list_type & get_maps() const;
+
+    private:
+        map_list_type m_maps;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFATTRIBUTECACHE_HPP
@@ -0,0 +1,227 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include "tfattributewriter.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        std::string_view trim(std::string_view s)
+        {
+            auto first = s.find_first_not_of(" \t\n");
+            if (first == std::string_view::npos)
+            {
+                return {};
+            }
+            auto last = s.find_last_not_of(" \t\n");
+            return s.substr(first, last - first + 1);
+        }
+    } // namespace
+
+    AttributeWriter::AttributeWriter(const context_type & ctx, size_t thread_count) :
+        m_thread_count{thread_count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : thread_count},
+        m_skip_unchanged{true}, m_context_pool{ctx, m_thread_count}
+    {}
+
+    AttributeWriter::Report AttributeWriter::apply(const request_list_type & requests) const
+    {
+        auto start = clock_type::now();
+
+        // Group the requests by device, keeping the order of the first request for each device.
+        std::vector<std::vector<size_t>> groups;
+        std::unordered_map<String, size_t> group_indexes;
+        for (size_t i = 0; i < requests.size(); i++)
+        {
+            auto [iterator, inserted] = group_indexes.try_emplace(requests[i].syspath, groups.size());
+            if (inserted)
+            {
+                groups.emplace_back();
+            }
+            groups[iterator->second].push_back(i);
+        }
+
+        result_list_type results(requests.size());
+        std::atomic<size_t> next_group{0};
+        auto worker = [&](const context_type & context) {
+            for (auto group = next_group++; group < groups.size(); group = next_group++)
+            {
+                apply_device(context, requests, groups[group], results);
+            }
+        };
+
+        // Wait for one context and take as many more as are free, so that concurrent calls
+        // share the pool instead of waiting on each other's contexts.
+        std::vector<ContextPool::Handle> contexts;
+        auto worker_count = std::min(m_thread_count, groups.size());
+        contexts.reserve(worker_count);
+        contexts.push_back(m_context_pool.acquire());
+        while (contexts.size() < worker_count)
+        {
+            auto context = m_context_pool.try_acquire();
+            if (! context)
+            {
+                break;
+            }
+            contexts.push_back(std::move(*context));
+        }
+
+        if (contexts.size() == 1)
+        {
+            worker(*contexts.front());
+        }
+        else
+        {
+            std::vector<std::thread> workers;
+            workers.reserve(contexts.size());
+            for (auto & context : contexts)
+            {
+                workers.emplace_back(worker, std::cref(context.get()));
+            }
+            for (auto & thread : workers)
+            {
+                thread.join();
+            }
+        }
+
+        Report report{std::move(results), 0, 0, 0, {}};
+        for (auto & result : report.results)
+        {
+            switch (result.status)
+            {
+                case Status::WRITTEN:
+                    report.written++;
+                    break;
+                case Status::UNCHANGED:
+                    report.unchanged++;
+                    break;
+                case Status::FAILED:
+                    report.failed++;
+                    break;
+            }
+        }
+        report.elapsed = clock_type::now() - start;
+        return report;
+    }
+
+    void AttributeWriter::set_skip_unchanged(bool skip_unchanged)
+    {
+        m_skip_unchanged = skip_unchanged;
+    }
+
+    bool AttributeWriter::get_skip_unchanged() const
+    {
+        return m_skip_unchanged;
+    }
+
+    size_t AttributeWriter::get_thread_count() const
+    {
+        return m_thread_count;
+    }
+
+    bool AttributeWriter::value_matches(std::string_view current, std::string_view value)
+    {
+        current = trim(current);
+        value = trim(value);
+        if (current == value)
+        {
+            return true;
+        }
+
+        // A list with the selected entry in brackets, for example "mq-deadline [none] kyber".
+        auto open = current.find('[');
+        if (open == std::string_view::npos)
+        {
+            return false;
+        }
+        auto close = current.find(']', open);
+        return close != std::string_view::npos && current.substr(open + 1, close - open - 1) == value;
+    }
+
+    void AttributeWriter::apply_device(const context_type & ctx, const request_list_type & requests,
+                                       const std::vector<size_t> & indexes, result_list_type & results) const
+    {
+        auto start = clock_type::now();
+        std::optional<Device> device;
+        std::exception_ptr device_error;
+        try
+        {
+            device.emplace(ctx, requests[indexes.front()].syspath);
+        }
+        catch (...)
+        {
+            device_error = std::current_exception();
+        }
+
+        for (auto index : indexes)
+        {
+            auto & request = requests[index];
+            auto & result = results[index];
+            result.request = request;
+
+            if (! device)
+            {
+                result.status = Status::FAILED;
+                result.error = device_error;
+                result.elapsed = clock_type::now() - start;
+                continue;
+            }
+
+            auto request_start = clock_type::now();
+            try
+            {
+                if (m_skip_unchanged)
+                {
+                    auto attribute = request.attribute.cStr();
+                    auto current = device->get_system_attribute_view(attribute.get());
+                    result.previous_value = String{current.data(), current.length()};
+                    if (! current.empty() && value_matches(current, request.value.stlString()))
+                    {
+                        result.status = Status::UNCHANGED;
+                        result.elapsed = clock_type::now() - request_start;
+                        continue;
+                    }
+                }
+                device->set_system_attribute_value(request.attribute, request.value);
+                result.status = Status::WRITTEN;
+            }
+            catch (...)
+            {
+                result.status = Status::FAILED;
+                result.error = std::current_exception();
+            }
+            result.elapsed = clock_type::now() - request_start;
+        }
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,170 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFATTRIBUTEWRITER_HPP
+#define TFATTRIBUTEWRITER_HPP
+
+#include <chrono>
+#include <exception>
+#include <string_view>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfcontextpool.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The AttributeWriter class writes a batch of system attributes, such as the queue settings
+     * of every disk, on a pool of worker threads and reports the outcome of each write.
+     *
+     * Requests are grouped by device.  The requests for one device are written in the order
+     * given, on one thread, using one Device object, while different devices are written in
+     * parallel.  A failed write does not stop the others: its exception is stored in its result
+     * and the remaining requests, including later ones for the same device, are still applied.
+     * Each worker borrows a context of its own from a ContextPool that shares the caches of the
+     * context given to the constructor, and destroys each device it creates before returning
+     * the context, so no udev object is used by two threads at once.
+     *
+     * When skipping unchanged values is enabled (the default), the current value is read first
+     * and the write is skipped if it already matches.  A value matches if it is equal after
+     * trimming white space, or if it is the selected entry of a list such as
+     * "mq-deadline [none] kyber", the format sysfs uses for queue/scheduler.
+     */
+    class AttributeWriter
+    {
+    public:
+        using context_type = Context;
+        using string_type = String;
+        using clock_type = std::chrono::steady_clock;
+
+        /** One attribute to write. */
+        struct Request
+        {
+            string_type syspath;
+            string_type attribute;
+            string_type value;
+        };
+
+        enum class Status
+        {
+            WRITTEN,
+            UNCHANGED,
+            FAILED
+        };
+
+        /** The outcome of one request. */
+        struct Result
+        {
+            Request request;
+            Status status;
+            /** The value read before writing, empty if skipping unchanged values is disabled. */
+            string_type previous_value;
+            /** The exception thrown while creating the device or writing the value, if the write failed. */
+            std::exception_ptr error;
+            /** The time taken to check and write the value. */
+            clock_type::duration elapsed;
+        };
+
+        using request_list_type = std::vector<Request>;
+        using result_list_type = std::vector<Result>;
+
+        /** The outcome of a batch. */
+        struct Report
+        {
+            /** The results in the same order as the requests. */
+            result_list_type results;
+            size_t written;
+            size_t unchanged;
+            size_t failed;
+            /** The time taken to apply the whole batch. */
+            clock_type::duration elapsed;
+        };
+
+        /**
+         * @brief constructor with context and thread count
+         * @param ctx the context whose caches the workers' contexts share.
+         * @param thread_count the largest number of worker threads, 0 means one per hardware thread.
+         */
+        explicit AttributeWriter(const context_type & ctx, size_t thread_count = 0);
+
+        /**
+         * @brief method to write a batch of attributes.
+         * @param requests the attributes to write.
+         * @return the result of each request and the totals.
+         */
+        [[nodiscard]] Report apply(const request_list_type & requests) const;
+
+        /**
+         * @brief method to choose whether writes of values that already match are skipped.
+         * @param skip_unchanged true to read each value first and skip the write if it matches.
+         */
+        void set_skip_unchanged(bool skip_unchanged);
+
+        /**
+         * @brief method to check whether writes of values that already match are skipped.
+         * @return true if unchanged values are skipped and false otherwise.
+         */
+        [[nodiscard]] bool get_skip_unchanged() const;
+
+        /**
+         * @brief method to get the largest number of worker threads.
+         * @return the number of worker threads.
+         */
+        [[nodiscard]] size_t get_thread_count() const;
+
+        /**
+         * @brief function to check whether a value read from sysfs matches a value to write.
+         * @param current the value read from sysfs
+         * @param value the value to write
+         * @return true if writing @e value would not change the attribute.
+         */
+        [[nodiscard]] static bool value_matches(std::string_view current, std::string_view value);
+
+    private:
+        /**
+         * @brief helper method to write the requests for one device.
+         * @param ctx the context of the worker thread
+         * @param requests every request in the batch
+         * @param indexes the indexes of the requests for the device, in order.
+         * @param results the results of the batch, the entries at @e indexes are filled in.
+         */
+        void apply_device(const context_type & ctx, const request_list_type & requests,
+                          const std::vector<size_t> & indexes, result_list_type & results) const;
+
+        size_t m_thread_count;
+        bool m_skip_unchanged;
+        // The pool is thread-safe, so the const apply method may borrow from it.
+        mutable ContextPool m_context_pool;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFATTRIBUTEWRITER_HPP
@@ -0,0 +1,176 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <thread>
+#include "tfcontextpool.hpp"
+#include "tfexceptions.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    ContextPool::Handle::Handle(ContextPool * pool, std::unique_ptr<context_type> && context) :
+        m_pool{pool}, m_context{std::move(context)}
+    {}
+
+    ContextPool::Handle::Handle(Handle && h) noexcept : m_pool{h.m_pool}, m_context{std::move(h.m_context)}
+    {
+        h.m_pool = nullptr;
+    }
+
+    ContextPool::Handle & ContextPool::Handle::operator=(Handle && h) noexcept
+    {
+        if (this != &h)
+        {
+            release();
+            m_pool = h.m_pool;
+            m_context = std::move(h.m_context);
+            h.m_pool = nullptr;
+        }
+        return *this;
+    }
+
+    ContextPool::Handle::~Handle()
+    {
+        release();
+    }
+
+    ContextPool::context_type & ContextPool::Handle::get() const
+    {
+        return *m_context;
+    }
+
+    void ContextPool::Handle::release()
+    {
+        if (m_pool != nullptr && m_context)
+        {
+            m_pool->return_context(std::move(m_context));
+        }
+        m_pool = nullptr;
+    }
+
+    ContextPool::ContextPool(size_t max_contexts) :
+        m_max_contexts{max_contexts}, m_context_count{0}, m_attribute_cache{std::make_shared<AttributeCache>()},
+        m_string_pool{std::make_shared<StringPool>()}
+    {
+        if (m_max_contexts == 0)
+        {
+            m_max_contexts = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+    }
+
+    ContextPool::ContextPool(const context_type & ctx, size_t max_contexts) :
+        m_max_contexts{max_contexts}, m_context_count{0}, m_attribute_cache{ctx.m_attribute_cache},
+        m_string_pool{ctx.m_string_pool}
+    {
+        if (m_max_contexts == 0)
+        {
+            m_max_contexts = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+    }
+
+    ContextPool::Handle ContextPool::acquire()
+    {
+        std::unique_lock<std::mutex> lock{m_mutex};
+        std::unique_ptr<context_type> context;
+        m_context_returned.wait(lock, [this, &context]() {
+            context = take_context();
+            return context != nullptr;
+        });
+        return Handle{this, std::move(context)};
+    }
+
+    std::optional<ContextPool::Handle> ContextPool::try_acquire()
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        auto context = take_context();
+        if (! context)
+        {
+            return {};
+        }
+        return Handle{this, std::move(context)};
+    }
+
+    size_t ContextPool::get_max_contexts() const
+    {
+        return m_max_contexts;
+    }
+
+    size_t ContextPool::get_context_count() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_context_count;
+    }
+
+    size_t ContextPool::get_idle_count() const
+    {
+        std::lock_guard<std::mutex> lock{m_mutex};
+        return m_idle_contexts.size();
+    }
+
+    AttributeCache & ContextPool::get_attribute_cache() const
+    {
+        return *m_attribute_cache;
+    }
+
+    StringPool & ContextPool::get_string_pool() const
+    {
+        return *m_string_pool;
+    }
+
+    std::unique_ptr<ContextPool::context_type> ContextPool::take_context()
+    {
+        if (! m_idle_contexts.empty())
+        {
+            auto context = std::move(m_idle_contexts.back());
+            m_idle_contexts.pop_back();
+            return context;
+        }
+        if (m_context_count >= m_max_contexts)
+        {
+            return nullptr;
+        }
+
+        auto udev_context = udev_new();
+        if (udev_context == nullptr)
+        {
+            throw system_no_code_error{"Udev_new failed"};
+        }
+        m_context_count++;
+        return std::unique_ptr<context_type>{new Context{udev_context, m_attribute_cache, m_string_pool}};
+    }
+
+    void ContextPool::return_context(std::unique_ptr<context_type> && context)
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_mutex};
+            m_idle_contexts.push_back(std::move(context));
+        }
+        m_context_returned.notify_one();
+    }
+
+} // namespace TF::Linux::Udev
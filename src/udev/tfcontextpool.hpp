@@ -0,0 +1,202 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFCONTEXTPOOL_HPP
+#define TFCONTEXTPOOL_HPP
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "tfudev.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The ContextPool class hands out Context objects so that several threads can use libudev
+     * at the same time, each with a udev object of its own.
+     *
+     * A thread calls acquire to borrow a context for as long as it holds the returned Handle;
+     * the context goes back to the pool when the handle is destroyed and is reused by the next
+     * thread that asks for one.  Contexts are created on demand, up to the maximum given to the
+     * constructor, after which acquire waits for another thread to return one.  All contexts
+     * from one pool share one attribute cache and one string pool, which are thread-safe.
+     *
+     * The pool itself is safe to use from multiple threads and must outlive its handles.  A
+     * borrowed context follows the rule given for Context, and once its handle is destroyed
+     * another thread may borrow it, so the objects created with it must be destroyed first.
+     */
+    class ContextPool
+    {
+    public:
+        using context_type = Context;
+
+        /**
+         * The Handle class gives a thread sole use of a context until it is destroyed.
+         */
+        class Handle
+        {
+        public:
+            Handle(const Handle &) = delete;
+            Handle & operator=(const Handle &) = delete;
+
+            /**
+             * @brief move constructor
+             * @param h the other handle, which no longer holds a context.
+             */
+            Handle(Handle && h) noexcept;
+
+            /**
+             * @brief move assignment operator, returns the context held by this handle first.
+             * @param h the other handle, which no longer holds a context.
+             * @return this handle.
+             */
+            Handle & operator=(Handle && h) noexcept;
+
+            /**
+             * @brief destructor, returns the context to the pool.
+             */
+            ~Handle();
+
+            /**
+             * @brief method to get the borrowed context.
+             * @return the context.
+             */
+            [[nodiscard]] context_type & get() const;
+
+            context_type & operator*() const
+            {
+                return get();
+            }
+
+            context_type * operator->() const
+            {
+                return &get();
+            }
+
+        private:
+            Handle(ContextPool * pool, std::unique_ptr<context_type> && context);
+
+            /**
+             * @brief helper method to return the context to the pool.
+             */
+            void release();
+
+            ContextPool * m_pool;
+            std::unique_ptr<context_type> m_context;
+
+            friend class ContextPool;
+        };
+
+        /**
+         * @brief constructor with the largest number of contexts
+         * @param max_contexts the largest number of contexts, 0 means one per hardware thread.
+         */
+        explicit ContextPool(size_t max_contexts = 0);
+
+        /**
+         * @brief constructor with a context to share caches with and the largest number of contexts
+         * @param ctx the context whose attribute cache and string pool the contexts of the pool share.
+         * @param max_contexts the largest number of contexts, 0 means one per hardware thread.
+         *
+         * The pool creates udev objects of its own; it never hands out @e ctx itself.
+         */
+        ContextPool(const context_type & ctx, size_t max_contexts);
+
+        ContextPool(const ContextPool &) = delete;
+        ContextPool & operator=(const ContextPool &) = delete;
+
+        /**
+         * @brief method to borrow a context, waiting for one to be returned if all are in use.
+         * @return the handle holding the context.
+         */
+        [[nodiscard]] Handle acquire();
+
+        /**
+         * @brief method to borrow a context without waiting.
+         * @return the handle, or an empty optional if every context is in use.
+         */
+        [[nodiscard]] std::optional<Handle> try_acquire();
+
+        /**
+         * @brief method to get the largest number of contexts.
+         * @return the largest number of contexts.
+         */
+        [[nodiscard]] size_t get_max_contexts() const;
+
+        /**
+         * @brief method to get the number of contexts created so far.
+         * @return the number of contexts.
+         */
+        [[nodiscard]] size_t get_context_count() const;
+
+        /**
+         * @brief method to get the number of contexts not currently borrowed.
+         * @return the number of idle contexts.
+         */
+        [[nodiscard]] size_t get_idle_count() const;
+
+        /**
+         * @brief method to get the attribute cache shared by the contexts of the pool.
+         * @return the attribute cache.
+         */
+        [[nodiscard]] AttributeCache & get_attribute_cache() const;
+
+        /**
+         * @brief method to get the string pool shared by the contexts of the pool.
+         * @return the string pool.
+         */
+        [[nodiscard]] StringPool & get_string_pool() const;
+
+    private:
+        /**
+         * @brief helper method to take an idle context or create a new one.
+         * @return the context, or nullptr if every context is in use.
+         * The caller must hold m_mutex.
+         */
+        std::unique_ptr<context_type> take_context();
+
+        /**
+         * @brief helper method to put a returned context back in the pool.
+         * @param context the context
+         */
+        void return_context(std::unique_ptr<context_type> && context);
+
+        size_t m_max_contexts;
+        size_t m_context_count;
+        std::vector<std::unique_ptr<context_type>> m_idle_contexts;
+        std::shared_ptr<AttributeCache> m_attribute_cache;
+        std::shared_ptr<StringPool> m_string_pool;
+        mutable std::mutex m_mutex;
+        std::condition_variable m_context_returned;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFCONTEXTPOOL_HPP
@@ -0,0 +1,874 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#include "tfdeviceinventory.hpp"
+#include "tfautofiledescriptor.hpp"
+#include "tffileio.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        constexpr uint32_t SNAPSHOT_MAGIC = 0x56444654; // "TFDV"
+        constexpr uint32_t SNAPSHOT_VERSION = 1;
+        constexpr size_t BOOT_ID_SIZE = 40;
+        constexpr const char * BOOT_ID_PATH = "/proc/sys/kernel/random/boot_id";
+        constexpr const char * UDEV_DATABASE_PATH = "/run/udev/data/";
+
+        // All offsets in the header are from the start of the file, all string references are offsets
+        // into the string table.  Offset 0 of the string table is always the empty string.
+        struct SnapshotHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            char boot_id[BOOT_ID_SIZE];
+            uint64_t file_size;
+            uint64_t strings_offset;
+            uint64_t strings_size;
+            uint64_t records_offset;
+            uint64_t record_count;
+            uint64_t pairs_offset;
+            uint64_t pair_count;
+            uint64_t keys_offset;
+            uint64_t key_count;
+        };
+
+        struct SnapshotRecord
+        {
+            uint32_t syspath;
+            uint32_t sysname;
+            uint32_t subsystem;
+            uint32_t devtype;
+            uint32_t devnode;
+            uint32_t driver;
+            uint32_t parent_syspath;
+            uint32_t first_property;
+            uint32_t property_count;
+            uint32_t first_tag;
+            uint32_t tag_count;
+            uint32_t first_attribute;
+            uint32_t attribute_count;
+            uint32_t reserved;
+            uint64_t devnum;
+            int64_t database_timestamp;
+        };
+
+        // Tags use only the name of a pair.
+        struct SnapshotPair
+        {
+            uint32_t name;
+            uint32_t value;
+        };
+
+        std::string read_boot_id()
+        {
+            std::string boot_id{};
+            auto fd = open(BOOT_ID_PATH, O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                return boot_id;
+            }
+            AutoFileDescriptor auto_fd{fd};
+            char buffer[BOOT_ID_SIZE]{};
+            auto count = read(*auto_fd, buffer, sizeof(buffer) - 1);
+            if (count > 0)
+            {
+                boot_id.assign(buffer, static_cast<size_t>(count));
+                while (! boot_id.empty() && boot_id.back() == '\n')
+                {
+                    boot_id.pop_back();
+                }
+            }
+            return boot_id;
+        }
+
+        class SnapshotWriter
+        {
+        public:
+            SnapshotWriter() : m_strings(1, '\0')
+            {
+                m_string_offsets.emplace(std::string{}, 0);
+            }
+
+            uint32_t add_string(const String & s)
+            {
+                auto value = s.stlString();
+                auto [iterator, inserted] = m_string_offsets.try_emplace(value, static_cast<uint32_t>(m_strings.size()));
+                if (inserted)
+                {
+                    m_strings.insert(m_strings.end(), value.begin(), value.end());
+                    m_strings.push_back('\0');
+                }
+                return iterator->second;
+            }
+
+            uint32_t add_pairs(const DeviceRecord::string_map_type & map)
+            {
+                auto first = static_cast<uint32_t>(m_pairs.size());
+                for (auto & [name, value] : map)
+                {
+                    m_pairs.push_back(SnapshotPair{add_string(name), add_string(value)});
+                }
+                return first;
+            }
+
+            uint32_t add_tags(const DeviceRecord::string_list_type & tags)
+            {
+                auto first = static_cast<uint32_t>(m_pairs.size());
+                for (auto & tag : tags)
+                {
+                    m_pairs.push_back(SnapshotPair{add_string(tag), 0});
+                }
+                return first;
+            }
+
+            void add_record(const DeviceRecord & record)
+            {
+                SnapshotRecord snapshot_record{};
+                snapshot_record.syspath = add_string(record.syspath);
+                snapshot_record.sysname = add_string(record.sysname);
+                snapshot_record.subsystem = add_string(record.subsystem);
+                snapshot_record.devtype = add_string(record.devtype);
+                snapshot_record.devnode = add_string(record.devnode);
+                snapshot_record.driver = add_string(record.driver);
+                snapshot_record.parent_syspath = add_string(record.parent_syspath);
+                snapshot_record.first_property = add_pairs(record.properties);
+                snapshot_record.property_count = static_cast<uint32_t>(record.properties.size());
+                snapshot_record.first_tag = add_tags(record.tags);
+                snapshot_record.tag_count = static_cast<uint32_t>(record.tags.size());
+                snapshot_record.first_attribute = add_pairs(record.attributes);
+                snapshot_record.attribute_count = static_cast<uint32_t>(record.attributes.size());
+                snapshot_record.devnum = static_cast<uint64_t>(record.devnum);
+                snapshot_record.database_timestamp = record.database_timestamp;
+                m_records.push_back(snapshot_record);
+            }
+
+            void add_key(const String & key)
+            {
+                m_keys.push_back(add_string(key));
+            }
+
+            std::vector<char> finish(const std::string & boot_id) const
+            {
+                SnapshotHeader header{};
+                header.magic = SNAPSHOT_MAGIC;
+                header.version = SNAPSHOT_VERSION;
+                std::memcpy(header.boot_id, boot_id.data(), std::min(boot_id.size(), BOOT_ID_SIZE - 1));
+                header.records_offset = sizeof(SnapshotHeader);
+                header.record_count = m_records.size();
+                header.pairs_offset = header.records_offset + m_records.size() * sizeof(SnapshotRecord);
+                header.pair_count = m_pairs.size();
+                header.keys_offset = header.pairs_offset + m_pairs.size() * sizeof(SnapshotPair);
+                header.key_count = m_keys.size();
+                header.strings_offset = header.keys_offset + m_keys.size() * sizeof(uint32_t);
+                header.strings_size = m_strings.size();
+                header.file_size = header.strings_offset + header.strings_size;
+
+                std::vector<char> contents(header.file_size);
+                std::memcpy(contents.data(), &header, sizeof(header));
+                std::memcpy(contents.data() + header.records_offset, m_records.data(),
+                            m_records.size() * sizeof(SnapshotRecord));
+                std::memcpy(contents.data() + header.pairs_offset, m_pairs.data(), m_pairs.size() * sizeof(SnapshotPair));
+                std::memcpy(contents.data() + header.keys_offset, m_keys.data(), m_keys.size() * sizeof(uint32_t));
+                std::memcpy(contents.data() + header.strings_offset, m_strings.data(), m_strings.size());
+                return contents;
+            }
+
+        private:
+            std::vector<char> m_strings;
+            std::unordered_map<std::string, uint32_t> m_string_offsets;
+            std::vector<SnapshotRecord> m_records;
+            std::vector<SnapshotPair> m_pairs;
+            std::vector<uint32_t> m_keys;
+        };
+
+        class SnapshotReader
+        {
+        public:
+            SnapshotReader(const char * data, size_t size) : m_data{data}, m_size{size}, m_header{} {}
+
+            bool validate(const std::string & boot_id)
+            {
+                if (m_size < sizeof(SnapshotHeader))
+                {
+                    return false;
+                }
+                std::memcpy(&m_header, m_data, sizeof(SnapshotHeader));
+                if (m_header.magic != SNAPSHOT_MAGIC || m_header.version != SNAPSHOT_VERSION ||
+                    m_header.file_size != m_size)
+                {
+                    return false;
+                }
+                if (boot_id.empty() || std::string_view{m_header.boot_id, strnlen(m_header.boot_id, BOOT_ID_SIZE)} !=
+                                           boot_id)
+                {
+                    return false;
+                }
+                if (! in_bounds(m_header.records_offset, m_header.record_count, sizeof(SnapshotRecord)) ||
+                    ! in_bounds(m_header.pairs_offset, m_header.pair_count, sizeof(SnapshotPair)) ||
+                    ! in_bounds(m_header.keys_offset, m_header.key_count, sizeof(uint32_t)) ||
+                    ! in_bounds(m_header.strings_offset, m_header.strings_size, 1))
+                {
+                    return false;
+                }
+                // Every string must be terminated inside the string table.
+                return m_header.strings_size > 0 && m_data[m_header.strings_offset + m_header.strings_size - 1] == '\0';
+            }
+
+            [[nodiscard]] size_t record_count() const
+            {
+                return m_header.record_count;
+            }
+
+            [[nodiscard]] size_t key_count() const
+            {
+                return m_header.key_count;
+            }
+
+            bool get_key(size_t index, String & key) const
+            {
+                uint32_t offset{0};
+                std::memcpy(&offset, m_data + m_header.keys_offset + index * sizeof(uint32_t), sizeof(offset));
+                return get_string(offset, key);
+            }
+
+            bool get_record(size_t index, DeviceRecord & record) const
+            {
+                SnapshotRecord snapshot_record{};
+                std::memcpy(&snapshot_record, m_data + m_header.records_offset + index * sizeof(SnapshotRecord),
+                            sizeof(SnapshotRecord));
+                if (! get_string(snapshot_record.syspath, record.syspath) ||
+                    ! get_string(snapshot_record.sysname, record.sysname) ||
+                    ! get_string(snapshot_record.subsystem, record.subsystem) ||
+                    ! get_string(snapshot_record.devtype, record.devtype) ||
+                    ! get_string(snapshot_record.devnode, record.devnode) ||
+                    ! get_string(snapshot_record.driver, record.driver) ||
+                    ! get_string(snapshot_record.parent_syspath, record.parent_syspath) ||
+                    ! get_pairs(snapshot_record.first_property, snapshot_record.property_count, record.properties) ||
+                    ! get_pairs(snapshot_record.first_attribute, snapshot_record.attribute_count, record.attributes))
+                {
+                    return false;
+                }
+                if (! pairs_in_bounds(snapshot_record.first_tag, snapshot_record.tag_count))
+                {
+                    return false;
+                }
+                record.tags.reserve(snapshot_record.tag_count);
+                for (uint32_t i = 0; i < snapshot_record.tag_count; i++)
+                {
+                    String tag{};
+                    if (! get_string(get_pair(snapshot_record.first_tag + i).name, tag))
+                    {
+                        return false;
+                    }
+                    record.tags.push_back(tag);
+                }
+                record.devnum = static_cast<dev_t>(snapshot_record.devnum);
+                record.database_timestamp = snapshot_record.database_timestamp;
+                return ! record.syspath.empty();
+            }
+
+        private:
+            [[nodiscard]] bool in_bounds(uint64_t offset, uint64_t count, uint64_t element_size) const
+            {
+                return offset <= m_size && count <= (m_size - offset) / element_size;
+            }
+
+            [[nodiscard]] bool pairs_in_bounds(uint64_t first, uint64_t count) const
+            {
+                return first <= m_header.pair_count && count <= m_header.pair_count - first;
+            }
+
+            [[nodiscard]] SnapshotPair get_pair(uint64_t index) const
+            {
+                SnapshotPair pair{};
+                std::memcpy(&pair, m_data + m_header.pairs_offset + index * sizeof(SnapshotPair), sizeof(pair));
+                return pair;
+            }
+
+            bool get_string(uint32_t offset, String & s) const
+            {
+                if (offset >= m_header.strings_size)
+                {
+                    return false;
+                }
+                auto start = m_data + m_header.strings_offset + offset;
+                s = String{start, std::strlen(start)};
+                return true;
+            }
+
+            bool get_pairs(uint32_t first, uint32_t count, DeviceRecord::string_map_type & map) const
+            {
+                if (! pairs_in_bounds(first, count))
+                {
+                    return false;
+                }
+                map.reserve(count);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    auto pair = get_pair(first + i);
+                    String name{};
+                    String value{};
+                    if (! get_string(pair.name, name) || ! get_string(pair.value, value))
+                    {
+                        return false;
+                    }
+                    map.emplace(std::move(name), std::move(value));
+                }
+                return true;
+            }
+
+            const char * m_data;
+            size_t m_size;
+            SnapshotHeader m_header;
+        };
+
+        class MappedFile
+        {
+        public:
+            MappedFile(void * data, size_t size) : m_data{data}, m_size{size} {}
+
+            MappedFile(const MappedFile &) = delete;
+            MappedFile & operator=(const MappedFile &) = delete;
+
+            ~MappedFile()
+            {
+                (void)munmap(m_data, m_size);
+            }
+
+        private:
+            void * m_data;
+            size_t m_size;
+        };
+    } // namespace
+
+    void DeviceInventory::set_attribute_keys(const string_set_type & keys)
+    {
+        m_attribute_keys = keys;
+    }
+
+    const DeviceInventory::string_set_type & DeviceInventory::get_attribute_keys() const
+    {
+        return m_attribute_keys;
+    }
+
+    void DeviceInventory::build(const context_type & ctx)
+    {
+        clear();
+        Query query{ctx};
+        for (Device & device : query.devices())
+        {
+            insert(make_record(device));
+        }
+    }
+
+    bool DeviceInventory::load(const string_type & path)
+    {
+        clear();
+
+        auto path_cstring_value = path.cStr();
+        auto fd = open(path_cstring_value.get(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+        AutoFileDescriptor auto_fd{fd};
+
+        struct stat file_status{};
+        if (fstat(*auto_fd, &file_status) < 0 || file_status.st_size <= 0)
+        {
+            return false;
+        }
+        auto size = static_cast<size_t>(file_status.st_size);
+        auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, *auto_fd, 0);
+        if (data == MAP_FAILED)
+        {
+            return false;
+        }
+        MappedFile mapped_file{data, size};
+
+        SnapshotReader reader{static_cast<const char *>(data), size};
+        if (! reader.validate(read_boot_id()))
+        {
+            return false;
+        }
+
+        string_set_type keys{};
+        for (size_t i = 0; i < reader.key_count(); i++)
+        {
+            String key{};
+            if (! reader.get_key(i, key))
+            {
+                return false;
+            }
+            keys.insert(key);
+        }
+        if (keys != m_attribute_keys)
+        {
+            return false;
+        }
+
+        m_records.reserve(reader.record_count());
+        for (size_t i = 0; i < reader.record_count(); i++)
+        {
+            record_type record{};
+            if (! reader.get_record(i, record))
+            {
+                clear();
+                return false;
+            }
+            insert(std::move(record));
+        }
+        return true;
+    }
+
+    void DeviceInventory::save(const string_type & path) const
+    {
+        SnapshotWriter writer{};
+        for (auto & key : m_attribute_keys)
+        {
+            writer.add_key(key);
+        }
+        for (auto record : get_records())
+        {
+            writer.add_record(*record);
+        }
+        auto contents = writer.finish(read_boot_id());
+
+        auto path_cstring_value = path.cStr();
+        std::string temporary_path{path_cstring_value.get()};
+        temporary_path += ".XXXXXX";
+        auto fd = mkostemp(temporary_path.data(), O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "mkostemp failed"};
+        }
+
+        try
+        {
+            AutoFileDescriptor auto_fd{fd};
+            write_all(*auto_fd, contents.data(), contents.size());
+            if (fchmod(*auto_fd, 0644) < 0)
+            {
+                throw std::system_error{errno, std::system_category(), "fchmod failed"};
+            }
+        }
+        catch (...)
+        {
+            (void)unlink(temporary_path.c_str());
+            throw;
+        }
+
+        if (rename(temporary_path.c_str(), path_cstring_value.get()) < 0)
+        {
+            auto error = errno;
+            (void)unlink(temporary_path.c_str());
+            throw std::system_error{error, std::system_category(), "rename failed"};
+        }
+    }
+
+    DeviceInventory::RefreshStatistics DeviceInventory::refresh(const context_type & ctx)
+    {
+        RefreshStatistics statistics{0, 0, 0, 0};
+
+        Query query{ctx};
+        auto syspaths = query.run();
+        syspath_set_type present{};
+        present.reserve(syspaths.size());
+
+        for (auto & syspath : syspaths)
+        {
+            present.insert(syspath);
+            auto record_iterator = m_records.find(syspath);
+            if (record_iterator != m_records.end())
+            {
+                // A device without a database entry can only be checked for presence.
+                auto timestamp = read_database_timestamp(record_iterator->second);
+                if (timestamp == record_iterator->second.database_timestamp)
+                {
+                    statistics.unchanged++;
+                    continue;
+                }
+            }
+
+            try
+            {
+                Device device{ctx, syspath};
+                auto is_update = record_iterator != m_records.end();
+                insert(make_record(device));
+                if (is_update)
+                {
+                    statistics.updated++;
+                }
+                else
+                {
+                    statistics.added++;
+                }
+            }
+            catch (const std::exception &)
+            {
+                // The device was removed after the query ran.
+                present.erase(syspath);
+            }
+        }
+
+        std::vector<String> removed{};
+        for (auto & [syspath, record] : m_records)
+        {
+            if (! present.contains(syspath))
+            {
+                removed.push_back(syspath);
+            }
+        }
+        for (auto & syspath : removed)
+        {
+            erase(syspath);
+        }
+        statistics.removed = removed.size();
+
+        return statistics;
+    }
+
+    void DeviceInventory::update(device_type & device)
+    {
+        auto action = device.get_action_view();
+        if (action == "remove")
+        {
+            erase(device.get_syspath());
+            return;
+        }
+
+        if (action == "move")
+        {
+            // The syspath is the sysfs mount point followed by the devpath, so the old syspath
+            // is the same mount point followed by the old devpath.
+            auto old_devpath = device.get_property_value_view("DEVPATH_OLD");
+            auto syspath = device.get_syspath_view();
+            auto devpath = device.get_devpath_view();
+            if (! old_devpath.empty() && syspath.ends_with(devpath))
+            {
+                std::string old_syspath{syspath.substr(0, syspath.size() - devpath.size())};
+                old_syspath.append(old_devpath);
+                erase(String{old_syspath.data(), old_syspath.length()});
+            }
+        }
+        insert(make_record(device));
+    }
+
+    void DeviceInventory::update(device_list_type & devices)
+    {
+        for (auto & device : devices)
+        {
+            update(device);
+        }
+    }
+
+    size_t DeviceInventory::update(monitor_type & monitor)
+    {
+        auto devices = monitor.drain_devices();
+        update(devices);
+        return devices.size();
+    }
+
+    const DeviceInventory::record_type * DeviceInventory::find(const string_type & syspath) const
+    {
+        auto record_iterator = m_records.find(syspath);
+        return record_iterator != m_records.end() ? &record_iterator->second : nullptr;
+    }
+
+    const DeviceInventory::record_type * DeviceInventory::find_by_devnum(char type, dev_t devnum) const
+    {
+        auto devnum_iterator = m_devnum_index.find(Device::make_devnum_key(type, devnum));
+        return devnum_iterator != m_devnum_index.end() ? find(devnum_iterator->second) : nullptr;
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::find_by_subsystem(const string_type & subsystem) const
+    {
+        return lookup(m_subsystem_index, subsystem);
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::find_by_subsystem_and_devtype(const string_type & subsystem,
+                                                                                       const string_type & devtype) const
+    {
+        return lookup(m_devtype_index, subsystem + "/" + devtype);
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::find_by_property(const string_type & property,
+                                                                        const string_type & value) const
+    {
+        return lookup(m_property_index, property + "=" + value);
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::find_by_tag(const string_type & tag) const
+    {
+        return lookup(m_tag_index, tag);
+    }
+
+    const DeviceInventory::record_type * DeviceInventory::find_parent(const string_type & syspath) const
+    {
+        return find_ancestor_matching(syspath, [](const record_type &) {
+            return true;
+        });
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::find_children(const string_type & syspath) const
+    {
+        return lookup(m_children_index, syspath);
+    }
+
+    const DeviceInventory::record_type * DeviceInventory::find_ancestor(const string_type & syspath,
+                                                                        const string_type & subsystem) const
+    {
+        return find_ancestor_matching(syspath, [&subsystem](const record_type & record) {
+            return record.subsystem == subsystem;
+        });
+    }
+
+    const DeviceInventory::record_type * DeviceInventory::find_ancestor(const string_type & syspath,
+                                                                        const string_type & subsystem,
+                                                                        const string_type & devtype) const
+    {
+        return find_ancestor_matching(syspath, [&subsystem, &devtype](const record_type & record) {
+            return record.subsystem == subsystem && record.devtype == devtype;
+        });
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::get_records() const
+    {
+        record_list_type records{};
+        records.reserve(m_records.size());
+        for (auto & [syspath, record] : m_records)
+        {
+            records.push_back(&record);
+        }
+        std::sort(records.begin(), records.end(), [](const record_type * a, const record_type * b) {
+            return a->syspath < b->syspath;
+        });
+        return records;
+    }
+
+    size_t DeviceInventory::size() const
+    {
+        return m_records.size();
+    }
+
+    void DeviceInventory::clear()
+    {
+        m_records.clear();
+        m_subsystem_index.clear();
+        m_devtype_index.clear();
+        m_property_index.clear();
+        m_tag_index.clear();
+        m_children_index.clear();
+        m_devnum_index.clear();
+    }
+
+    DeviceInventory::record_type DeviceInventory::make_record(device_type & device) const
+    {
+        record_type record{};
+        record.syspath = device.get_syspath();
+        record.sysname = device.get_sysname();
+        record.subsystem = device.get_subsystem();
+        record.devtype = device.get_devtype();
+        record.devnode = device.get_devnode();
+        record.driver = device.get_driver();
+        record.devnum = device.get_devnum();
+        record.properties = device.get_properties();
+        for (auto & [tag, value] : device.get_tags())
+        {
+            record.tags.push_back(tag);
+        }
+        if (! m_attribute_keys.empty())
+        {
+            record.attributes = device.load_attributes_for_keys(m_attribute_keys);
+        }
+        auto parent = device.get_parent();
+        if (parent)
+        {
+            record.parent_syspath = parent->get_syspath();
+        }
+        record.database_timestamp = read_database_timestamp(record);
+        return record;
+    }
+
+    void DeviceInventory::insert(record_type && record)
+    {
+        auto record_iterator = m_records.find(record.syspath);
+        if (record_iterator != m_records.end())
+        {
+            update_indexes(record_iterator->second, false);
+            record_iterator->second = std::move(record);
+        }
+        else
+        {
+            auto syspath = record.syspath;
+            record_iterator = m_records.emplace(std::move(syspath), std::move(record)).first;
+        }
+        update_indexes(record_iterator->second, true);
+    }
+
+    void DeviceInventory::erase(const string_type & syspath)
+    {
+        auto record_iterator = m_records.find(syspath);
+        if (record_iterator != m_records.end())
+        {
+            update_indexes(record_iterator->second, false);
+            m_records.erase(record_iterator);
+        }
+    }
+
+    void DeviceInventory::update_indexes(const record_type & record, bool add)
+    {
+        auto update_index = [&record, add](index_type & index, const String & key) {
+            if (add)
+            {
+                index[key].insert(record.syspath);
+                return;
+            }
+            auto index_iterator = index.find(key);
+            if (index_iterator != index.end())
+            {
+                index_iterator->second.erase(record.syspath);
+                if (index_iterator->second.empty())
+                {
+                    index.erase(index_iterator);
+                }
+            }
+        };
+
+        update_index(m_subsystem_index, record.subsystem);
+        update_index(m_devtype_index, record.subsystem + "/" + record.devtype);
+        for (auto & [name, value] : record.properties)
+        {
+            update_index(m_property_index, name + "=" + value);
+        }
+        for (auto & tag : record.tags)
+        {
+            update_index(m_tag_index, tag);
+        }
+        if (! record.parent_syspath.empty())
+        {
+            update_index(m_children_index, record.parent_syspath);
+        }
+
+        if (major(record.devnum) > 0)
+        {
+            auto key = Device::make_devnum_key(record.subsystem == "block" ? 'b' : 'c', record.devnum);
+            if (add)
+            {
+                m_devnum_index[key] = record.syspath;
+            }
+            else
+            {
+                auto devnum_iterator = m_devnum_index.find(key);
+                if (devnum_iterator != m_devnum_index.end() && devnum_iterator->second == record.syspath)
+                {
+                    m_devnum_index.erase(devnum_iterator);
+                }
+            }
+        }
+    }
+
+    DeviceInventory::record_list_type DeviceInventory::lookup(const index_type & index, const string_type & key) const
+    {
+        record_list_type records{};
+        auto index_iterator = index.find(key);
+        if (index_iterator == index.end())
+        {
+            return records;
+        }
+        records.reserve(index_iterator->second.size());
+        for (auto & syspath : index_iterator->second)
+        {
+            records.push_back(&m_records.at(syspath));
+        }
+        std::sort(records.begin(), records.end(), [](const record_type * a, const record_type * b) {
+            return a->syspath < b->syspath;
+        });
+        return records;
+    }
+
+    const DeviceInventory::record_type *
+        DeviceInventory::find_ancestor_matching(const string_type & syspath,
+                                                const std::function<bool(const record_type &)> & predicate) const
+    {
+        auto path = syspath.stlString();
+        for (auto separator = path.rfind('/'); separator != std::string::npos && separator > 0;
+             separator = path.rfind('/'))
+        {
+            path.resize(separator);
+            auto record = find(String{path.data(), path.length()});
+            if (record && predicate(*record))
+            {
+                return record;
+            }
+        }
+        return nullptr;
+    }
+
+    int64_t DeviceInventory::read_database_timestamp(const record_type & record)
+    {
+        // udevd names database entries the same way libudev does: by device number, then by
+        // interface index for network devices, then by subsystem and system name.
+        std::string path{UDEV_DATABASE_PATH};
+        if (major(record.devnum) > 0)
+        {
+            path += record.subsystem == "block" ? 'b' : 'c';
+            path += std::to_string(major(record.devnum)) + ":" + std::to_string(minor(record.devnum));
+        }
+        else if (auto ifindex = record.properties.find("IFINDEX"); ifindex != record.properties.end())
+        {
+            path += "n" + ifindex->second.stlString();
+        }
+        else
+        {
+            auto sysname = record.sysname.stlString();
+            std::replace(sysname.begin(), sysname.end(), '/', '!');
+            path += "+" + record.subsystem.stlString() + ":" + sysname;
+        }
+
+        struct stat file_status{};
+        if (stat(path.c_str(), &file_status) < 0)
+        {
+            return -1;
+        }
+        return static_cast<int64_t>(file_status.st_mtim.tv_sec) * 1000000000 + file_status.st_mtim.tv_nsec;
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,363 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFDEVICEINVENTORY_HPP
+#define TFDEVICEINVENTORY_HPP
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <sys/types.h>
+#include "TFFoundation.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The DeviceRecord struct holds what a DeviceInventory knows about one device.  Unlike a
+     * Device it is a plain value that does not reference libudev.
+     */
+    struct DeviceRecord
+    {
+        using string_type = String;
+        using string_list_type = std::vector<String>;
+        using string_map_type = std::unordered_map<String, String>;
+
+        string_type syspath;
+        string_type sysname;
+        string_type subsystem;
+        string_type devtype;
+        string_type devnode;
+        string_type driver;
+        /** The syspath of the parent device, empty for a device without a parent. */
+        string_type parent_syspath;
+        dev_t devnum{0};
+        string_map_type properties;
+        string_list_type tags;
+        /** The attributes named by the inventory's attribute keys. */
+        string_map_type attributes;
+        /** The modification time in nanoseconds of the device's udev database entry, or -1 if it has none. */
+        int64_t database_timestamp{-1};
+    };
+
+    /**
+     * The DeviceInventory class keeps records of every device on the system, indexed by syspath,
+     * subsystem, device type, device number, property, tag and parent, so that questions such as
+     * which block device has ID_SERIAL=X, or which controller a disk belongs to, are answered by
+     * hash lookups instead of a new Query, which scans sysfs each time it runs.
+     *
+     * An inventory is built once with build, which creates a Device for every device on the
+     * system, and can then be saved to a snapshot file.  The snapshot is a single binary file laid
+     * out for mmap: fixed size records refer to a table of de-duplicated strings by offset, so
+     * load reads it without tokenizing any text and without touching sysfs or libudev.  Load
+     * still copies every string of every record into the inventory and rebuilds all of the
+     * indexes, so its cost grows with the size of the snapshot; the file is unmapped before load
+     * returns.  A snapshot is only accepted by load when it was written during the current boot
+     * with the same attribute keys.
+     *
+     * After loading a snapshot, refresh brings it up to date by comparing it with one scan of the
+     * device list and the modification times of udevd's database entries, and only creates
+     * Device objects for devices that were added or changed.  From then on, passing each device
+     * received from a Monitor to update keeps the inventory current.  Start the monitor before
+     * calling refresh so that no event between the two is lost.
+     *
+     * Record pointers returned by the find methods stay valid until the record is updated or
+     * removed.  A DeviceInventory object is not safe to use from more than one thread at a time.
+     */
+    class DeviceInventory
+    {
+    public:
+        using context_type = Context;
+        using device_type = Device;
+        using device_list_type = std::vector<Device>;
+        using monitor_type = Monitor;
+        using record_type = DeviceRecord;
+        using string_type = String;
+        using string_set_type = std::unordered_set<String>;
+        using record_list_type = std::vector<const DeviceRecord *>;
+
+        /** The number of records in each state after a refresh. */
+        struct RefreshStatistics
+        {
+            size_t unchanged;
+            size_t updated;
+            size_t added;
+            size_t removed;
+        };
+
+        /** @brief default constructor, creates an empty inventory. */
+        DeviceInventory() = default;
+
+        /**
+         * @brief method to set the attributes stored in each record.
+         * @param keys the attribute names, for example "size" or "queue/rotational".
+         *
+         * Attributes are not stored by default.  Set the keys before calling build or load.
+         */
+        void set_attribute_keys(const string_set_type & keys);
+
+        /**
+         * @brief method to get the attributes stored in each record.
+         * @return the attribute names.
+         */
+        [[nodiscard]] const string_set_type & get_attribute_keys() const;
+
+        /**
+         * @brief method to replace the contents of the inventory with every device on the system.
+         * @param ctx the context
+         */
+        void build(const context_type & ctx);
+
+        /**
+         * @brief method to replace the contents of the inventory with a snapshot.
+         * @param path the path of the snapshot file
+         * @return true if the snapshot was loaded, false if the file does not exist, is not a
+         * valid snapshot, was written during another boot or with other attribute keys.  The
+         * inventory is left empty when false is returned.
+         */
+        bool load(const string_type & path);
+
+        /**
+         * @brief method to write the inventory to a snapshot file.
+         * @param path the path of the snapshot file
+         *
+         * The snapshot is written to a temporary file which is then renamed over @e path, so a
+         * reader never sees a partly written snapshot.
+         */
+        void save(const string_type & path) const;
+
+        /**
+         * @brief method to bring the inventory up to date with the devices on the system.
+         * @param ctx the context
+         * @return the number of records that were unchanged, updated, added and removed.
+         */
+        RefreshStatistics refresh(const context_type & ctx);
+
+        /**
+         * @brief method to update the inventory with a device received from a Monitor.
+         * @param device the device
+         *
+         * A device with the remove action is removed from the inventory, any other device is
+         * added or replaces its existing record.  A device with the move action, such as a
+         * renamed network interface, also removes the record of its old path, DEVPATH_OLD.
+         */
+        void update(device_type & device);
+
+        /**
+         * @brief method to update the inventory with a batch of devices received from a Monitor.
+         * @param devices the devices in the order they were received.
+         *
+         * The method has the signature of a Monitor::run callback, so an inventory can be kept
+         * current with monitor.run([&inventory](auto & devices) { inventory.update(devices); }).
+         */
+        void update(device_list_type & devices);
+
+        /**
+         * @brief method to update the inventory with every device queued on a Monitor.
+         * @param monitor the monitor
+         * @return the number of devices received.
+         *
+         * The method does not block, it returns 0 when no device is queued.
+         */
+        size_t update(monitor_type & monitor);
+
+        /**
+         * @brief method to find the record of a device by syspath.
+         * @param syspath the syspath
+         * @return the record or nullptr if the inventory has no such device.
+         */
+        [[nodiscard]] const record_type * find(const string_type & syspath) const;
+
+        /**
+         * @brief method to find the record of a device by device number.
+         * @param type 'b' for a block device or 'c' for a character device.
+         * @param devnum the device number
+         * @return the record or nullptr if the inventory has no such device.
+         */
+        [[nodiscard]] const record_type * find_by_devnum(char type, dev_t devnum) const;
+
+        /**
+         * @brief method to find the records of the devices in a subsystem.
+         * @param subsystem the subsystem
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type find_by_subsystem(const string_type & subsystem) const;
+
+        /**
+         * @brief method to find the records of the devices with a subsystem and device type.
+         * @param subsystem the subsystem
+         * @param devtype the device type
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type find_by_subsystem_and_devtype(const string_type & subsystem,
+                                                                     const string_type & devtype) const;
+
+        /**
+         * @brief method to find the records of the devices with a property value.
+         * @param property the property name
+         * @param value the value
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type find_by_property(const string_type & property, const string_type & value) const;
+
+        /**
+         * @brief method to find the records of the devices with a tag.
+         * @param tag the tag
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type find_by_tag(const string_type & tag) const;
+
+        /**
+         * @brief method to find the record of the parent of a device.
+         * @param syspath the syspath of the device
+         * @return the record of the closest ancestor in the inventory, or nullptr if there is none.
+         */
+        [[nodiscard]] const record_type * find_parent(const string_type & syspath) const;
+
+        /**
+         * @brief method to find the records of the children of a device.
+         * @param syspath the syspath of the device
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type find_children(const string_type & syspath) const;
+
+        /**
+         * @brief method to find the closest ancestor of a device in a subsystem.
+         * @param syspath the syspath of the device
+         * @param subsystem the subsystem of the ancestor
+         * @return the record or nullptr if the device has no such ancestor in the inventory.
+         *
+         * For example, the ancestor of nvme3n1 in the nvme subsystem is its controller, nvme3.
+         */
+        [[nodiscard]] const record_type * find_ancestor(const string_type & syspath,
+                                                        const string_type & subsystem) const;
+
+        /**
+         * @brief method to find the closest ancestor of a device with a subsystem and device type.
+         * @param syspath the syspath of the device
+         * @param subsystem the subsystem of the ancestor
+         * @param devtype the device type of the ancestor
+         * @return the record or nullptr if the device has no such ancestor in the inventory.
+         */
+        [[nodiscard]] const record_type * find_ancestor(const string_type & syspath, const string_type & subsystem,
+                                                        const string_type & devtype) const;
+
+        /**
+         * @brief method to get every record in the inventory.
+         * @return the records sorted by syspath.
+         */
+        [[nodiscard]] record_list_type get_records() const;
+
+        /**
+         * @brief method to get the number of devices in the inventory.
+         * @return the number of devices.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @brief method to remove every record from the inventory.
+         */
+        void clear();
+
+    private:
+        using syspath_set_type = std::unordered_set<String>;
+        using index_type = std::unordered_map<String, syspath_set_type>;
+
+        /**
+         * @brief helper method to create the record for a device.
+         * @param device the device
+         * @return the record
+         */
+        [[nodiscard]] record_type make_record(device_type & device) const;
+
+        /**
+         * @brief helper method to add a record, replacing any record with the same syspath.
+         * @param record the record
+         */
+        void insert(record_type && record);
+
+        /**
+         * @brief helper method to remove a record.
+         * @param syspath the syspath of the record
+         */
+        void erase(const string_type & syspath);
+
+        /**
+         * @brief helper method to add or remove the index entries for a record.
+         * @param record the record
+         * @param add true to add the entries and false to remove them.
+         */
+        void update_indexes(const record_type & record, bool add);
+
+        /**
+         * @brief helper method to turn a set of syspaths from an index into a sorted record list.
+         * @param index the index
+         * @param key the key in the index
+         * @return the records
+         */
+        [[nodiscard]] record_list_type lookup(const index_type & index, const string_type & key) const;
+
+        /**
+         * @brief helper method to walk up the ancestors of a device.
+         * @param syspath the syspath of the device
+         * @param predicate the function deciding if an ancestor is the one looked for.
+         * @return the record of the closest ancestor in the inventory for which @e predicate
+         * returns true, or nullptr if there is none.
+         *
+         * The walk follows the syspath directories rather than the stored parent syspaths, so it
+         * skips parents that are not in the inventory, such as devices without a subsystem.
+         */
+        [[nodiscard]] const record_type *
+            find_ancestor_matching(const string_type & syspath,
+                                   const std::function<bool(const record_type &)> & predicate) const;
+
+        /**
+         * @brief helper function to get the modification time of the udev database entry for a record.
+         * @param record the record
+         * @return the modification time in nanoseconds, or -1 if the device has no database entry.
+         */
+        static int64_t read_database_timestamp(const record_type & record);
+
+        std::unordered_map<String, record_type> m_records;
+        index_type m_subsystem_index;
+        index_type m_devtype_index;
+        index_type m_property_index;
+        index_type m_tag_index;
+        /** The syspaths of the children of each device, keyed by the parent syspath. */
+        index_type m_children_index;
+        std::unordered_map<uint64_t, String> m_devnum_index;
+        string_set_type m_attribute_keys;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFDEVICEINVENTORY_HPP
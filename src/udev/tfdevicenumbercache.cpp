@@ -0,0 +1,162 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <stdexcept>
+#include "tfdevicenumbercache.hpp"
+#include "tfexceptions.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    DeviceNumberCache::DeviceNumberCache(const context_type & ctx, size_type capacity) :
+        m_context{ctx}, m_capacity{0}
+    {
+        set_capacity(capacity);
+    }
+
+    DeviceNumberCache::device_pointer DeviceNumberCache::get_device(char type, dev_t devnum)
+    {
+        return lookup(type, devnum).device;
+    }
+
+    DeviceNumberCache::map_pointer DeviceNumberCache::get_attributes(char type, dev_t devnum)
+    {
+        auto & entry = lookup(type, devnum);
+        if (entry.device && ! entry.attributes)
+        {
+            auto chain = entry.device->load_attributes_from_sysfs(m_context.get_attribute_cache());
+            entry.attributes = std::make_shared<const string_map_type>(chain.flatten());
+        }
+        return entry.attributes;
+    }
+
+    void DeviceNumberCache::invalidate(char type, dev_t devnum)
+    {
+        auto index_iterator = m_index.find(Device::make_devnum_key(type, devnum));
+        if (index_iterator == m_index.end())
+        {
+            return;
+        }
+
+        m_entries.erase(index_iterator->second);
+        m_index.erase(index_iterator);
+        m_statistics.invalidations++;
+    }
+
+    void DeviceNumberCache::update(const device_type & device)
+    {
+        auto devnum = device.get_devnum();
+        if (devnum == 0)
+        {
+            return;
+        }
+        invalidate(device.get_subsystem_view() == "block" ? 'b' : 'c', devnum);
+    }
+
+    void DeviceNumberCache::update(device_list_type & devices)
+    {
+        for (auto & device : devices)
+        {
+            update(device);
+        }
+    }
+
+    void DeviceNumberCache::clear()
+    {
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    DeviceNumberCache::size_type DeviceNumberCache::size() const
+    {
+        return m_entries.size();
+    }
+
+    DeviceNumberCache::size_type DeviceNumberCache::get_capacity() const
+    {
+        return m_capacity;
+    }
+
+    void DeviceNumberCache::set_capacity(size_type capacity)
+    {
+        if (capacity == 0)
+        {
+            throw std::invalid_argument{"capacity must be greater than 0"};
+        }
+        m_capacity = capacity;
+        evict();
+    }
+
+    DeviceNumberCache::Statistics DeviceNumberCache::get_statistics() const
+    {
+        return m_statistics;
+    }
+
+    void DeviceNumberCache::reset_statistics()
+    {
+        m_statistics = Statistics{};
+    }
+
+    DeviceNumberCache::Entry & DeviceNumberCache::lookup(char type, dev_t devnum)
+    {
+        auto key = Device::make_devnum_key(type, devnum);
+        auto index_iterator = m_index.find(key);
+        if (index_iterator != m_index.end())
+        {
+            m_statistics.hits++;
+            m_entries.splice(m_entries.begin(), m_entries, index_iterator->second);
+            return m_entries.front();
+        }
+
+        m_statistics.misses++;
+        device_pointer device{};
+        try
+        {
+            device = std::make_shared<Device>(m_context, type, devnum);
+        }
+        catch (const system_no_code_error &)
+        {
+            // No device has this number, remember that as well.
+        }
+
+        m_entries.emplace_front(Entry{key, std::move(device), nullptr});
+        m_index.emplace(key, m_entries.begin());
+        evict();
+        return m_entries.front();
+    }
+
+    void DeviceNumberCache::evict()
+    {
+        while (m_entries.size() > m_capacity)
+        {
+            m_index.erase(m_entries.back().key);
+            m_entries.pop_back();
+            m_statistics.evictions++;
+        }
+    }
+
+} // namespace TF::Linux::Udev
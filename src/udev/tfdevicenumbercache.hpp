@@ -0,0 +1,207 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFDEVICENUMBERCACHE_HPP
+#define TFDEVICENUMBERCACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include "TFFoundation.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The DeviceNumberCache class maps device numbers, such as the st_dev and st_rdev fields
+     * returned by stat or reported with fanotify events, to devices without going to /sys for
+     * every lookup.
+     *
+     * Devices are keyed by type, 'b' for block and 'c' for character, and device number, and
+     * the least recently used entry is dropped once the cache is full.  A device number with no
+     * device is cached too, so repeated lookups of numbers such as those of anonymous file
+     * systems are also answered from the cache.  Pass each device received from a Monitor to
+     * update to drop the entries events make stale.
+     *
+     * Devices are handed out as shared pointers, so a device stays usable by the caller after
+     * its entry is dropped, and attribute maps are loaded on first request through the
+     * context's attribute cache.  Like the Context it uses, a DeviceNumberCache and the devices
+     * it returns must only be used by one thread at a time; the attribute maps are immutable
+     * and may be shared freely.
+     */
+    class DeviceNumberCache
+    {
+    public:
+        using context_type = Context;
+        using device_type = Device;
+        using device_list_type = std::vector<Device>;
+        using device_pointer = std::shared_ptr<Device>;
+        using string_map_type = AttributeCache::string_map_type;
+        using map_pointer = AttributeCache::map_pointer;
+        using size_type = size_t;
+
+        /** The number of lookups answered with and without the cache. */
+        struct Statistics
+        {
+            size_t hits{0};
+            size_t misses{0};
+            size_t evictions{0};
+            size_t invalidations{0};
+        };
+
+        constexpr static size_type DEFAULT_CAPACITY = 1024;
+
+        /**
+         * @brief constructor with context and capacity
+         * @param ctx the udev context used to create the devices.
+         * @param capacity the largest number of entries to keep, must be greater than 0.
+         */
+        explicit DeviceNumberCache(const context_type & ctx, size_type capacity = DEFAULT_CAPACITY);
+
+        /**
+         * @brief method to get the device with a device number.
+         * @param type the device type, 'b' or 'c'
+         * @param devnum the device number
+         * @return the device, or nullptr if there is no such device.
+         */
+        [[nodiscard]] device_pointer get_device(char type, dev_t devnum);
+
+        /**
+         * @brief method to get the attributes of the device with a device number.
+         * @param type the device type, 'b' or 'c'
+         * @param devnum the device number
+         * @return the attributes of the device and its parents, as returned by
+         * Device::load_attributes_from_sysfs, or nullptr if there is no such device.
+         */
+        [[nodiscard]] map_pointer get_attributes(char type, dev_t devnum);
+
+        /**
+         * @brief method to drop the entry for a device number.
+         * @param type the device type, 'b' or 'c'
+         * @param devnum the device number
+         */
+        void invalidate(char type, dev_t devnum);
+
+        /**
+         * @brief method to drop the entry made stale by a device received from a Monitor.
+         * @param device the device
+         *
+         * Every action drops the entry for the device's number: remove and change because the
+         * cached device is out of date, and add because the number may have been cached as
+         * having no device.
+         */
+        void update(const device_type & device);
+
+        /**
+         * @brief method to drop the entries made stale by a batch of devices received from a Monitor.
+         * @param devices the devices
+         *
+         * Pass it every batch a monitor delivers, for example from the callback given to
+         * Monitor::run, so that no stale device is returned after the batch was received.
+         */
+        void update(device_list_type & devices);
+
+        /**
+         * @brief method to drop every entry.
+         */
+        void clear();
+
+        /**
+         * @brief method to get the number of entries in the cache.
+         * @return the number of entries.
+         */
+        [[nodiscard]] size_type size() const;
+
+        /**
+         * @brief method to get the largest number of entries the cache keeps.
+         * @return the capacity.
+         */
+        [[nodiscard]] size_type get_capacity() const;
+
+        /**
+         * @brief method to set the largest number of entries the cache keeps.
+         * @param capacity the capacity, must be greater than 0.
+         *
+         * Least recently used entries are dropped until the cache fits.
+         */
+        void set_capacity(size_type capacity);
+
+        /**
+         * @brief method to get the hit, miss, eviction and invalidation counts.
+         * @return the statistics.
+         */
+        [[nodiscard]] Statistics get_statistics() const;
+
+        /**
+         * @brief method to set the counts back to zero.
+         */
+        void reset_statistics();
+
+    private:
+        using key_type = uint64_t;
+
+        struct Entry
+        {
+            key_type key;
+            device_pointer device;
+            map_pointer attributes;
+        };
+
+        using entry_list_type = std::list<Entry>;
+
+        /**
+         * @brief helper method to find or create the entry for a device number.
+         * @param type the device type, 'b' or 'c'
+         * @param devnum the device number
+         * @return the entry, which is the most recently used entry.
+         */
+        Entry & lookup(char type, dev_t devnum);
+
+        /**
+         * @brief helper method to drop least recently used entries until the cache fits.
+         */
+        void evict();
+
+        context_type m_context;
+        size_type m_capacity;
+
+        // Entries in order of use, most recent first, and an index into the list.
+        entry_list_type m_entries;
+        std::unordered_map<key_type, entry_list_type::iterator> m_index;
+
+        Statistics m_statistics;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFDEVICENUMBERCACHE_HPP
@@ -0,0 +1,236 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <deque>
+#include "tfdevicetree.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    DeviceTree::DeviceTree(const context_type & ctx)
+    {
+        Query query{ctx};
+        build(query);
+    }
+
+    DeviceTree::DeviceTree(query_type & query)
+    {
+        build(query);
+    }
+
+    const DeviceTree::node_type * DeviceTree::find(const string_type & syspath) const
+    {
+        auto iterator = m_nodes.find(syspath);
+        return iterator != m_nodes.end() ? iterator->second.get() : nullptr;
+    }
+
+    const DeviceTree::node_list_type & DeviceTree::get_roots() const
+    {
+        return m_roots;
+    }
+
+    size_t DeviceTree::size() const
+    {
+        return m_nodes.size();
+    }
+
+    void DeviceTree::visit_depth_first(const node_type & start, const visitor_type & visitor) const
+    {
+        std::vector<const node_type *> stack{&start};
+        while (! stack.empty())
+        {
+            auto node = stack.back();
+            stack.pop_back();
+            if (visitor(*node))
+            {
+                // Push in reverse so the children are visited in syspath order.
+                stack.insert(stack.end(), node->children.rbegin(), node->children.rend());
+            }
+        }
+    }
+
+    void DeviceTree::visit_breadth_first(const node_type & start, const visitor_type & visitor) const
+    {
+        std::deque<const node_type *> queue{&start};
+        while (! queue.empty())
+        {
+            auto node = queue.front();
+            queue.pop_front();
+            if (visitor(*node))
+            {
+                queue.insert(queue.end(), node->children.begin(), node->children.end());
+            }
+        }
+    }
+
+    void DeviceTree::visit_depth_first(const visitor_type & visitor) const
+    {
+        for (auto root : m_roots)
+        {
+            visit_depth_first(*root, visitor);
+        }
+    }
+
+    DeviceTree::node_list_type DeviceTree::find_descendants(const node_type & start,
+                                                            const string_type & subsystem) const
+    {
+        return collect_descendants(start, [&subsystem](const node_type & node) {
+            return node.subsystem == subsystem;
+        });
+    }
+
+    DeviceTree::node_list_type DeviceTree::find_descendants(const node_type & start, const string_type & subsystem,
+                                                            const string_type & devtype) const
+    {
+        return collect_descendants(start, [&subsystem, &devtype](const node_type & node) {
+            return node.subsystem == subsystem && node.devtype == devtype;
+        });
+    }
+
+    const DeviceTree::node_type * DeviceTree::find_ancestor(const node_type & start, const string_type & subsystem)
+    {
+        for (auto node = start.parent; node != nullptr; node = node->parent)
+        {
+            if (node->subsystem == subsystem)
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    const DeviceTree::node_type * DeviceTree::find_ancestor(const node_type & start, const string_type & subsystem,
+                                                            const string_type & devtype)
+    {
+        for (auto node = start.parent; node != nullptr; node = node->parent)
+        {
+            if (node->subsystem == subsystem && node->devtype == devtype)
+            {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    void DeviceTree::build(query_type & query)
+    {
+        for (Device & device : query.devices())
+        {
+            add(std::move(device));
+        }
+        finish();
+    }
+
+    void DeviceTree::add(Device && device)
+    {
+        auto syspath = device.get_syspath();
+        if (m_nodes.contains(syspath))
+        {
+            return;
+        }
+
+        auto node = std::make_unique<node_type>();
+        node->device = std::move(device);
+        node->syspath = syspath;
+        copy_identity(*node);
+        auto current = node.get();
+        m_nodes.emplace(syspath, std::move(node));
+
+        // Walk up until reaching an ancestor that is already in the tree, so every ancestor is
+        // created once no matter how many devices share it.
+        while (auto parent = current->device.get_parent())
+        {
+            auto parent_syspath = parent->get_syspath();
+            auto iterator = m_nodes.find(parent_syspath);
+            if (iterator != m_nodes.end())
+            {
+                current->parent = iterator->second.get();
+                iterator->second->children.push_back(current);
+                return;
+            }
+
+            auto parent_node = std::make_unique<node_type>();
+            parent_node->device = std::move(*parent);
+            parent_node->syspath = parent_syspath;
+            copy_identity(*parent_node);
+            parent_node->children.push_back(current);
+            current->parent = parent_node.get();
+            current = parent_node.get();
+            m_nodes.emplace(parent_syspath, std::move(parent_node));
+        }
+    }
+
+    void DeviceTree::copy_identity(node_type & node)
+    {
+        auto subsystem = node.device.get_subsystem_view();
+        auto devtype = node.device.get_devtype_view();
+        node.subsystem = String{subsystem.data(), subsystem.length()};
+        node.devtype = String{devtype.data(), devtype.length()};
+    }
+
+    void DeviceTree::finish()
+    {
+        auto by_syspath = [](const node_type * a, const node_type * b) {
+            return a->syspath < b->syspath;
+        };
+
+        for (auto & [syspath, node] : m_nodes)
+        {
+            std::sort(node->children.begin(), node->children.end(), by_syspath);
+            if (node->parent == nullptr)
+            {
+                m_roots.push_back(node.get());
+            }
+        }
+        std::sort(m_roots.begin(), m_roots.end(), by_syspath);
+
+        for (auto & [syspath, node] : m_nodes)
+        {
+            for (auto ancestor = node->parent; ancestor != nullptr; ancestor = ancestor->parent)
+            {
+                node->depth++;
+            }
+        }
+    }
+
+    DeviceTree::node_list_type
+        DeviceTree::collect_descendants(const node_type & start,
+                                        const std::function<bool(const node_type &)> & predicate) const
+    {
+        node_list_type nodes{};
+        visit_depth_first(start, [&start, &nodes, &predicate](const node_type & node) {
+            if (&node != &start && predicate(node))
+            {
+                nodes.push_back(&node);
+            }
+            return true;
+        });
+        return nodes;
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,222 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFDEVICETREE_HPP
+#define TFDEVICETREE_HPP
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The DeviceTreeNode struct is one device in a DeviceTree.
+     */
+    struct DeviceTreeNode
+    {
+        using node_list_type = std::vector<const DeviceTreeNode *>;
+
+        Device device;
+        String syspath;
+        /** The subsystem of the device, empty if it has none. */
+        String subsystem;
+        /** The device type of the device, empty if it has none. */
+        String devtype;
+        /** The parent node, nullptr for a root of the tree. */
+        const DeviceTreeNode * parent{nullptr};
+        /** The child nodes sorted by syspath. */
+        node_list_type children;
+        /** The number of ancestors of the node, 0 for a root. */
+        size_t depth{0};
+    };
+
+    /**
+     * The DeviceTree class holds the sysfs device hierarchy of a set of devices, built from a
+     * single enumeration.
+     *
+     * Every device appears once and its node is shared by all of its children, so answering
+     * a topology question, such as finding the partitions under a controller or the network
+     * interfaces on a PCI bus, walks the tree in memory instead of calling
+     * Device::get_parent for each device.  The tree also contains the ancestors of the
+     * enumerated devices that are not matched by any query, such as PCI host bridges, which
+     * have no subsystem.
+     *
+     * The tree does not change after it is built.  Nodes stay valid for the lifetime of the
+     * tree.  The syspath, subsystem and device type of each node are copied when the tree is
+     * built and the queries only compare those copies, so the methods of a DeviceTree may be
+     * called from several threads at once.  The Device of a node still belongs to the context
+     * it was created from and follows the rule given for Context.
+     */
+    class DeviceTree
+    {
+    public:
+        using context_type = Context;
+        using query_type = Query;
+        using node_type = DeviceTreeNode;
+        using node_list_type = DeviceTreeNode::node_list_type;
+        using string_type = String;
+        /** A visitor returns false to skip the children of the node it was given. */
+        using visitor_type = std::function<bool(const node_type &)>;
+
+        /**
+         * @brief constructor that builds the tree of every device on the system.
+         * @param ctx the context
+         */
+        explicit DeviceTree(const context_type & ctx);
+
+        /**
+         * @brief constructor that builds the tree of the devices matched by a query and their ancestors.
+         * @param query the query
+         */
+        explicit DeviceTree(query_type & query);
+
+        DeviceTree(const DeviceTree &) = delete;
+        DeviceTree & operator=(const DeviceTree &) = delete;
+
+        /**
+         * @brief method to find the node of a device.
+         * @param syspath the syspath of the device
+         * @return the node or nullptr if the tree does not contain the device.
+         */
+        [[nodiscard]] const node_type * find(const string_type & syspath) const;
+
+        /**
+         * @brief method to get the devices without a parent.
+         * @return the root nodes sorted by syspath.
+         */
+        [[nodiscard]] const node_list_type & get_roots() const;
+
+        /**
+         * @brief method to get the number of devices in the tree.
+         * @return the number of nodes.
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * @brief method to visit a subtree depth first.
+         * @param start the node at the top of the subtree
+         * @param visitor the function called for each node, parents before their children.
+         */
+        void visit_depth_first(const node_type & start, const visitor_type & visitor) const;
+
+        /**
+         * @brief method to visit a subtree breadth first.
+         * @param start the node at the top of the subtree
+         * @param visitor the function called for each node, in order of depth.
+         */
+        void visit_breadth_first(const node_type & start, const visitor_type & visitor) const;
+
+        /**
+         * @brief method to visit every node of the tree depth first.
+         * @param visitor the function called for each node, parents before their children.
+         */
+        void visit_depth_first(const visitor_type & visitor) const;
+
+        /**
+         * @brief method to find the devices in a subsystem below a node.
+         * @param start the node at the top of the subtree, which is not included in the result.
+         * @param subsystem the subsystem
+         * @return the nodes in depth first order.
+         */
+        [[nodiscard]] node_list_type find_descendants(const node_type & start, const string_type & subsystem) const;
+
+        /**
+         * @brief method to find the devices with a subsystem and device type below a node.
+         * @param start the node at the top of the subtree, which is not included in the result.
+         * @param subsystem the subsystem
+         * @param devtype the device type
+         * @return the nodes in depth first order.
+         */
+        [[nodiscard]] node_list_type find_descendants(const node_type & start, const string_type & subsystem,
+                                                      const string_type & devtype) const;
+
+        /**
+         * @brief method to find the closest ancestor of a node in a subsystem.
+         * @param start the node
+         * @param subsystem the subsystem
+         * @return the ancestor or nullptr if there is none.
+         */
+        [[nodiscard]] static const node_type * find_ancestor(const node_type & start, const string_type & subsystem);
+
+        /**
+         * @brief method to find the closest ancestor of a node with a subsystem and device type.
+         * @param start the node
+         * @param subsystem the subsystem
+         * @param devtype the device type
+         * @return the ancestor or nullptr if there is none.
+         */
+        [[nodiscard]] static const node_type * find_ancestor(const node_type & start, const string_type & subsystem,
+                                                             const string_type & devtype);
+
+    private:
+        /**
+         * @brief helper method to add the devices of a query and their ancestors to the tree.
+         * @param query the query
+         */
+        void build(query_type & query);
+
+        /**
+         * @brief helper method to add a device and any of its ancestors not yet in the tree.
+         * @param device the device
+         */
+        void add(Device && device);
+
+        /**
+         * @brief helper method to copy the subsystem and device type of a node's device into the node.
+         * @param node the node
+         */
+        static void copy_identity(node_type & node);
+
+        /**
+         * @brief helper method to sort the children, set the depths and collect the roots.
+         */
+        void finish();
+
+        /**
+         * @brief helper method to collect the descendants of a node accepted by a predicate.
+         * @param start the node at the top of the subtree
+         * @param predicate the function deciding which nodes are collected.
+         * @return the nodes in depth first order.
+         */
+        [[nodiscard]] node_list_type
+            collect_descendants(const node_type & start,
+                                const std::function<bool(const node_type &)> & predicate) const;
+
+        std::unordered_map<String, std::unique_ptr<node_type>> m_nodes;
+        node_list_type m_roots;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFDEVICETREE_HPP
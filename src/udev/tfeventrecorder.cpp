@@ -0,0 +1,290 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "tfeventrecorder.hpp"
+#include "tfautofiledescriptor.hpp"
+#include "tffileio.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        constexpr char RECORDING_MAGIC[8] = {'T', 'F', 'U', 'E', 'V', 'R', 'E', 'C'};
+        constexpr uint32_t RECORDING_VERSION = 1;
+        constexpr size_t MAX_MESSAGE_SIZE = 64 * 1024;
+
+        // Returns false at the end of the file, throws if the file ends in the middle of @e size bytes.
+        bool read_all(int fd, void * data, size_t size)
+        {
+            auto bytes = static_cast<char *>(data);
+            size_t total{0};
+            while (total < size)
+            {
+                auto count = read(fd, bytes + total, size - total);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::system_category(), "read failed"};
+                }
+                if (count == 0)
+                {
+                    if (total == 0)
+                    {
+                        return false;
+                    }
+                    throw std::invalid_argument{"event recording is truncated"};
+                }
+                total += static_cast<size_t>(count);
+            }
+            return true;
+        }
+
+        int64_t to_nanoseconds(DeviceEvent::clock_type::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+    } // namespace
+
+    EventRecorder::EventRecorder(const string_type & path) : m_event_count{0}
+    {
+        auto path_cstring_value = path.cStr();
+        m_fd.reset(open(path_cstring_value.get(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644));
+        if (! m_fd.is_valid())
+        {
+            throw std::system_error{errno, std::system_category(), "open failed"};
+        }
+
+        write_all(*m_fd, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+        write_all(*m_fd, &RECORDING_VERSION, sizeof(RECORDING_VERSION));
+    }
+
+    EventRecorder::~EventRecorder() = default;
+
+    void EventRecorder::record(const event_type & event)
+    {
+        if (! m_start)
+        {
+            m_start = event.received;
+        }
+
+        int64_t offset = std::chrono::duration_cast<std::chrono::nanoseconds>(event.received - *m_start).count();
+        auto message = event.to_message();
+        auto length = static_cast<uint32_t>(message.size());
+
+        // Write the entry in one call so a partly written entry can only be the last one.
+        std::string entry(sizeof(offset) + sizeof(length), '\0');
+        std::memcpy(entry.data(), &offset, sizeof(offset));
+        std::memcpy(entry.data() + sizeof(offset), &length, sizeof(length));
+        entry += message;
+        write_all(*m_fd, entry.data(), entry.size());
+        m_event_count++;
+    }
+
+    size_t EventRecorder::record(EventSource & source, duration_type duration)
+    {
+        size_t count{0};
+        auto deadline = event_type::clock_type::now() + duration;
+        for (auto now = event_type::clock_type::now(); now < deadline; now = event_type::clock_type::now())
+        {
+            auto event =
+                source.get_event(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                                 std::chrono::milliseconds{1});
+            if (event)
+            {
+                record(*event);
+                count++;
+            }
+        }
+        return count;
+    }
+
+    size_t EventRecorder::get_event_count() const
+    {
+        return m_event_count;
+    }
+
+    EventReplayer::EventReplayer(const string_type & path) : m_stopping{false}
+    {
+        auto path_cstring_value = path.cStr();
+        auto fd = open(path_cstring_value.get(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "open failed"};
+        }
+        AutoFileDescriptor auto_fd{fd};
+
+        char magic[sizeof(RECORDING_MAGIC)]{};
+        uint32_t version{0};
+        if (! read_all(*auto_fd, magic, sizeof(magic)) || std::memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 ||
+            ! read_all(*auto_fd, &version, sizeof(version)) || version != RECORDING_VERSION)
+        {
+            throw std::invalid_argument{"not an event recording"};
+        }
+
+        int64_t offset{0};
+        while (read_all(*auto_fd, &offset, sizeof(offset)))
+        {
+            uint32_t length{0};
+            if (! read_all(*auto_fd, &length, sizeof(length)) || length > MAX_MESSAGE_SIZE)
+            {
+                throw std::invalid_argument{"event recording is corrupt"};
+            }
+            std::string message(length, '\0');
+            if (length > 0 && ! read_all(*auto_fd, message.data(), length))
+            {
+                throw std::invalid_argument{"event recording is truncated"};
+            }
+            m_events.push_back(RecordedEvent{std::chrono::nanoseconds{offset}, std::move(message)});
+        }
+    }
+
+    EventReplayer::EventReplayer(event_list_type && events) : m_events{std::move(events)}, m_stopping{false} {}
+
+    size_t EventReplayer::replay(int fd, const Options & options)
+    {
+        using clock_type = DeviceEvent::clock_type;
+
+        if (options.mode == Mode::RECORDED && options.speed <= 0.0)
+        {
+            throw std::invalid_argument{"speed must be greater than 0"};
+        }
+        if (options.mode == Mode::FIXED_RATE && options.events_per_second <= 0.0)
+        {
+            throw std::invalid_argument{"events per second must be greater than 0"};
+        }
+
+        size_t sent{0};
+        // Only the fixed rate mode uses, and validates, events_per_second.
+        clock_type::duration interval{};
+        if (options.mode == Mode::FIXED_RATE)
+        {
+            interval = std::chrono::duration_cast<clock_type::duration>(
+                std::chrono::duration<double>{1.0 / options.events_per_second});
+        }
+        std::string stamped_message;
+
+        // The stop flag is only cleared once the replay is over, so a stop issued before the
+        // loop starts is not lost.
+        try
+        {
+            for (size_t pass = 0; pass < options.repeat && ! m_stopping; pass++)
+            {
+                auto start = clock_type::now();
+                for (size_t i = 0; i < m_events.size() && ! m_stopping; i++)
+                {
+                    switch (options.mode)
+                    {
+                        case Mode::RECORDED:
+                            std::this_thread::sleep_until(
+                                start + std::chrono::duration_cast<clock_type::duration>(
+                                            std::chrono::duration<double, std::nano>{
+                                                static_cast<double>(m_events[i].offset.count()) / options.speed}));
+                            break;
+                        case Mode::FIXED_RATE:
+                            std::this_thread::sleep_until(start + interval * static_cast<int64_t>(i));
+                            break;
+                        case Mode::BURST:
+                            if (options.burst_size > 0 && i > 0 && i % options.burst_size == 0)
+                            {
+                                std::this_thread::sleep_for(options.burst_interval);
+                            }
+                            break;
+                    }
+
+                    const std::string * message = &m_events[i].message;
+                    if (options.stamp_send_time)
+                    {
+                        stamped_message = *message;
+                        stamped_message += SEND_TIME_PROPERTY;
+                        stamped_message += '=';
+                        stamped_message += std::to_string(to_nanoseconds(clock_type::now()));
+                        stamped_message += '\0';
+                        message = &stamped_message;
+                    }
+
+                    while (send(fd, message->data(), message->size(), MSG_NOSIGNAL) < 0)
+                    {
+                        if (errno != EINTR)
+                        {
+                            throw std::system_error{errno, std::system_category(), "send failed"};
+                        }
+                    }
+                    sent++;
+                }
+            }
+        }
+        catch (...)
+        {
+            m_stopping = false;
+            throw;
+        }
+        m_stopping = false;
+        return sent;
+    }
+
+    void EventReplayer::stop()
+    {
+        m_stopping = true;
+    }
+
+    const EventReplayer::event_list_type & EventReplayer::get_events() const
+    {
+        return m_events;
+    }
+
+    std::optional<DeviceEvent::clock_type::time_point> EventReplayer::get_send_time(const DeviceEvent & event)
+    {
+        auto iterator = event.properties.find(SEND_TIME_PROPERTY);
+        if (iterator == event.properties.end())
+        {
+            return {};
+        }
+        auto value = iterator->second.stlString();
+        int64_t nanoseconds{0};
+        auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), nanoseconds);
+        if (error != std::errc{})
+        {
+            return {};
+        }
+        return DeviceEvent::clock_type::time_point{
+            std::chrono::duration_cast<DeviceEvent::clock_type::duration>(std::chrono::nanoseconds{nanoseconds})};
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,207 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFEVENTRECORDER_HPP
+#define TFEVENTRECORDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfautofiledescriptor.hpp"
+#include "tfeventsource.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The RecordedEvent struct is one event of a recording: its uevent message and when it
+     * arrived relative to the first event of the recording.
+     */
+    struct RecordedEvent
+    {
+        std::chrono::nanoseconds offset;
+        std::string message;
+    };
+
+    /**
+     * The EventRecorder class writes events to a recording file that EventReplayer can play back.
+     *
+     * The file starts with a magic number and version, followed by one entry per event holding
+     * the time since the first event in nanoseconds, the message length and the uevent message.
+     * Entries are written as they are recorded, so a recording interrupted by a crash keeps
+     * every complete entry.
+     */
+    class EventRecorder
+    {
+    public:
+        using string_type = String;
+        using event_type = DeviceEvent;
+        using duration_type = std::chrono::steady_clock::duration;
+
+        /**
+         * @brief constructor with path, creates or truncates the recording file.
+         * @param path the path of the recording file
+         */
+        explicit EventRecorder(const string_type & path);
+
+        EventRecorder(const EventRecorder &) = delete;
+        EventRecorder & operator=(const EventRecorder &) = delete;
+
+        /**
+         * @brief destructor, closes the recording file.
+         */
+        ~EventRecorder();
+
+        /**
+         * @brief method to add an event to the recording.
+         * @param event the event, whose received time gives its place in the recording.
+         */
+        void record(const event_type & event);
+
+        /**
+         * @brief method to record the events of a source for a length of time.
+         * @param source the event source
+         * @param duration how long to record for
+         * @return the number of events recorded.
+         */
+        size_t record(EventSource & source, duration_type duration);
+
+        /**
+         * @brief method to get the number of events recorded.
+         * @return the number of events.
+         */
+        [[nodiscard]] size_t get_event_count() const;
+
+    private:
+        AutoFileDescriptor m_fd;
+        std::optional<event_type::clock_type::time_point> m_start;
+        size_t m_event_count;
+    };
+
+    /**
+     * The EventReplayer class sends the events of a recording, or a synthetic stream, to a socket
+     * at a chosen pace, for example to one end of a socketpair read by a SocketEventSource.
+     *
+     * Each event is sent as one uevent message, so the socket should be a sequenced packet or
+     * datagram socket.  Sending blocks when the socket buffer is full, which slows the replay to
+     * the pace of the reader instead of losing events.
+     */
+    class EventReplayer
+    {
+    public:
+        using string_type = String;
+        using event_list_type = std::vector<RecordedEvent>;
+        using duration_type = std::chrono::steady_clock::duration;
+
+        enum class Mode
+        {
+            /** Keep the recorded gaps between events, scaled by the speed. */
+            RECORDED,
+            /** Send events evenly spaced at a fixed rate. */
+            FIXED_RATE,
+            /** Send bursts of events back to back, with a pause between bursts. */
+            BURST
+        };
+
+        /** The pace of a replay. */
+        struct Options
+        {
+            Mode mode{Mode::RECORDED};
+            /** For RECORDED, 2.0 replays twice as fast as recorded. */
+            double speed{1.0};
+            /** For FIXED_RATE, the number of events sent per second. */
+            double events_per_second{1000.0};
+            /** For BURST, the number of events in each burst, 0 sends every event in one burst. */
+            size_t burst_size{0};
+            /** For BURST, the pause after each burst. */
+            duration_type burst_interval{};
+            /** The number of times to send the whole stream. */
+            size_t repeat{1};
+            /** Add the send time as the SEND_TIME_PROPERTY property of each message. */
+            bool stamp_send_time{false};
+        };
+
+        /**
+         * The property holding the steady clock time, in nanoseconds, at which a message was
+         * sent, when Options::stamp_send_time is set.
+         */
+        constexpr static const char * SEND_TIME_PROPERTY = "TF_REPLAY_SEND_TIME_NS";
+
+        /**
+         * @brief constructor with a recording file
+         * @param path the path of a file written by EventRecorder.
+         */
+        explicit EventReplayer(const string_type & path);
+
+        /**
+         * @brief constructor with a list of events, for synthetic streams.
+         * @param events the events in the order to send them.
+         */
+        explicit EventReplayer(event_list_type && events);
+
+        /**
+         * @brief method to send the events to a socket.
+         * @param fd the socket
+         * @param options the pace of the replay
+         * @return the number of messages sent, which is less than expected if stop was called.
+         */
+        size_t replay(int fd, const Options & options);
+
+        /**
+         * @brief method to make a replay running on another thread return early.
+         *
+         * A stop issued before replay starts makes that replay return without sending anything.
+         */
+        void stop();
+
+        /**
+         * @brief method to get the events that are replayed.
+         * @return the events.
+         */
+        [[nodiscard]] const event_list_type & get_events() const;
+
+        /**
+         * @brief function to get the send time stamped in an event.
+         * @param event the event received from the socket
+         * @return the send time, or an empty optional if the event was not stamped.
+         */
+        [[nodiscard]] static std::optional<DeviceEvent::clock_type::time_point> get_send_time(
+            const DeviceEvent & event);
+
+    private:
+        event_list_type m_events;
+        std::atomic<bool> m_stopping;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFEVENTRECORDER_HPP
@@ -0,0 +1,264 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <cerrno>
+#include <charconv>
+#include <system_error>
+#include <poll.h>
+#include <sys/socket.h>
+#include "tfeventsource.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        String to_string(std::string_view s)
+        {
+            return String{s.data(), s.length()};
+        }
+
+        String find_value(const DeviceEvent::string_map_type & properties, const char * key)
+        {
+            auto iterator = properties.find(key);
+            return iterator != properties.end() ? iterator->second : String{};
+        }
+    } // namespace
+
+    DeviceEvent::string_type DeviceEvent::get_syspath() const
+    {
+        return String{"/sys"} + devpath;
+    }
+
+    std::string DeviceEvent::to_message() const
+    {
+        std::string message{action.stlString()};
+        message += '@';
+        message += devpath.stlString();
+        message += '\0';
+
+        auto append_property = [&message](const std::string & key, const std::string & value) {
+            message += key;
+            message += '=';
+            message += value;
+            message += '\0';
+        };
+
+        // The fields come first so that a message can be decoded without the property map.
+        append_property("ACTION", action.stlString());
+        append_property("DEVPATH", devpath.stlString());
+        append_property("SUBSYSTEM", subsystem.stlString());
+        if (! devtype.empty())
+        {
+            append_property("DEVTYPE", devtype.stlString());
+        }
+        append_property("SEQNUM", std::to_string(seqnum));
+        for (auto & [key, value] : properties)
+        {
+            auto key_string = key.stlString();
+            if (key_string != "ACTION" && key_string != "DEVPATH" && key_string != "SUBSYSTEM" &&
+                key_string != "DEVTYPE" && key_string != "SEQNUM")
+            {
+                append_property(key_string, value.stlString());
+            }
+        }
+        return message;
+    }
+
+    std::optional<DeviceEvent> DeviceEvent::parse(std::string_view message)
+    {
+        auto end_of_summary = message.find('\0');
+        if (end_of_summary == std::string_view::npos || message.substr(0, end_of_summary).find('@') ==
+                                                            std::string_view::npos)
+        {
+            return {};
+        }
+
+        DeviceEvent event{};
+        for (auto position = end_of_summary + 1; position < message.size();)
+        {
+            auto end_of_entry = message.find('\0', position);
+            if (end_of_entry == std::string_view::npos)
+            {
+                end_of_entry = message.size();
+            }
+            auto entry = message.substr(position, end_of_entry - position);
+            auto separator = entry.find('=');
+            if (separator != std::string_view::npos && separator > 0)
+            {
+                event.properties.insert_or_assign(to_string(entry.substr(0, separator)),
+                                                  to_string(entry.substr(separator + 1)));
+            }
+            position = end_of_entry + 1;
+        }
+
+        event.action = find_value(event.properties, "ACTION");
+        event.devpath = find_value(event.properties, "DEVPATH");
+        if (event.action.empty() || event.devpath.empty())
+        {
+            return {};
+        }
+        event.subsystem = find_value(event.properties, "SUBSYSTEM");
+        event.devtype = find_value(event.properties, "DEVTYPE");
+        auto seqnum = find_value(event.properties, "SEQNUM").stlString();
+        (void)std::from_chars(seqnum.data(), seqnum.data() + seqnum.size(), event.seqnum);
+        return event;
+    }
+
+    DeviceEvent DeviceEvent::from_device(Device & device)
+    {
+        DeviceEvent event{};
+        event.action = device.get_action();
+        event.devpath = device.get_devpath();
+        event.subsystem = device.get_subsystem();
+        event.devtype = device.get_devtype();
+        event.properties = device.get_properties();
+        auto seqnum = device.get_property_value_view("SEQNUM");
+        (void)std::from_chars(seqnum.data(), seqnum.data() + seqnum.size(), event.seqnum);
+        event.received = clock_type::now();
+        return event;
+    }
+
+    std::optional<EventSource::event_type> EventSource::get_event(std::chrono::milliseconds timeout)
+    {
+        auto deadline = DeviceEvent::clock_type::now() + timeout;
+        while (true)
+        {
+            auto event = try_get_event();
+            if (event)
+            {
+                return event;
+            }
+
+            int poll_timeout{-1};
+            if (timeout.count() >= 0)
+            {
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - DeviceEvent::clock_type::now());
+                if (remaining.count() <= 0)
+                {
+                    return {};
+                }
+                poll_timeout = static_cast<int>(remaining.count());
+            }
+
+            pollfd poll_fd{get_file_descriptor(), POLLIN, 0};
+            if (poll(&poll_fd, 1, poll_timeout) < 0 && errno != EINTR)
+            {
+                throw std::system_error{errno, std::system_category(), "poll failed"};
+            }
+            if ((poll_fd.revents & (POLLHUP | POLLERR)) != 0)
+            {
+                // No more events will arrive once the sender has gone.
+                return try_get_event();
+            }
+        }
+    }
+
+    EventSource::event_list_type EventSource::drain_events(size_t max_events)
+    {
+        event_list_type events;
+        while (max_events == 0 || events.size() < max_events)
+        {
+            auto event = try_get_event();
+            if (! event)
+            {
+                break;
+            }
+            events.push_back(std::move(*event));
+        }
+        return events;
+    }
+
+    MonitorEventSource::MonitorEventSource(monitor_type & monitor) : m_monitor{monitor} {}
+
+    int MonitorEventSource::get_file_descriptor() const
+    {
+        return m_monitor.get_file_descriptor();
+    }
+
+    std::optional<EventSource::event_type> MonitorEventSource::try_get_event()
+    {
+        auto device = m_monitor.try_get_device();
+        if (! device)
+        {
+            return {};
+        }
+        return DeviceEvent::from_device(*device);
+    }
+
+    SocketEventSource::SocketEventSource(int fd) : m_fd{fd}, m_buffer(MESSAGE_BUFFER_SIZE), m_dropped_message_count{0}
+    {}
+
+    int SocketEventSource::get_file_descriptor() const
+    {
+        return m_fd;
+    }
+
+    std::optional<EventSource::event_type> SocketEventSource::try_get_event()
+    {
+        while (true)
+        {
+            auto length = recv(m_fd, m_buffer.data(), m_buffer.size(), MSG_DONTWAIT | MSG_TRUNC);
+            if (length < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return {};
+                }
+                throw std::system_error{errno, std::system_category(), "recv failed"};
+            }
+            if (length == 0)
+            {
+                // The other end of a sequenced packet socket was closed.
+                return {};
+            }
+
+            auto received = DeviceEvent::clock_type::now();
+            if (static_cast<size_t>(length) <= m_buffer.size())
+            {
+                auto event = DeviceEvent::parse(std::string_view{m_buffer.data(), static_cast<size_t>(length)});
+                if (event)
+                {
+                    event->received = received;
+                    return event;
+                }
+            }
+            m_dropped_message_count++;
+        }
+    }
+
+    size_t SocketEventSource::get_dropped_message_count() const
+    {
+        return m_dropped_message_count;
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,198 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFEVENTSOURCE_HPP
+#define TFEVENTSOURCE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The DeviceEvent struct is a hotplug event as a plain value, independent of libudev.
+     *
+     * Events convert to and from the message format the kernel sends on the uevent socket,
+     * "action@devpath" followed by NUL terminated KEY=value properties, which is also the
+     * format used by EventRecorder files and EventReplayer sockets.
+     */
+    struct DeviceEvent
+    {
+        using string_type = String;
+        using string_map_type = std::unordered_map<String, String>;
+        using clock_type = std::chrono::steady_clock;
+
+        string_type action;
+        string_type devpath;
+        string_type subsystem;
+        string_type devtype;
+        uint64_t seqnum{0};
+        /** Every property of the event, including ACTION, DEVPATH, SUBSYSTEM and SEQNUM. */
+        string_map_type properties;
+        /** The time the event source received the event. */
+        clock_type::time_point received{};
+
+        /**
+         * @brief method to get the syspath of the device.
+         * @return "/sys" followed by the devpath.
+         */
+        [[nodiscard]] string_type get_syspath() const;
+
+        /**
+         * @brief method to encode the event as a uevent message.
+         * @return the message.
+         */
+        [[nodiscard]] std::string to_message() const;
+
+        /**
+         * @brief function to decode a uevent message.
+         * @param message the message
+         * @return the event, or an empty optional if @e message is not a uevent message.
+         */
+        [[nodiscard]] static std::optional<DeviceEvent> parse(std::string_view message);
+
+        /**
+         * @brief function to create an event from a device received from a Monitor.
+         * @param device the device
+         * @return the event
+         */
+        [[nodiscard]] static DeviceEvent from_device(Device & device);
+    };
+
+    /**
+     * The EventSource class is the interface of anything that delivers hotplug events.
+     *
+     * Code that consumes events through an EventSource can be driven by a live Monitor with
+     * MonitorEventSource, or by a recorded or synthetic stream sent over a socket with
+     * SocketEventSource, which makes it possible to load test it.  The file descriptor becomes
+     * readable when events may be queued, so a source can be added to an epoll set.
+     */
+    class EventSource
+    {
+    public:
+        using event_type = DeviceEvent;
+        using event_list_type = std::vector<DeviceEvent>;
+
+        virtual ~EventSource() = default;
+
+        /**
+         * @brief method to get the file descriptor to wait on for events.
+         * @return the file descriptor
+         */
+        [[nodiscard]] virtual int get_file_descriptor() const = 0;
+
+        /**
+         * @brief method to receive one event without blocking.
+         * @return the event, or an empty optional if no event is queued.
+         */
+        [[nodiscard]] virtual std::optional<event_type> try_get_event() = 0;
+
+        /**
+         * @brief method to wait for and receive one event.
+         * @param timeout the longest time to wait, negative to wait forever.
+         * @return the event, or an empty optional if the timeout expired or the file descriptor
+         * was hung up.
+         */
+        [[nodiscard]] std::optional<event_type>
+            get_event(std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+
+        /**
+         * @brief method to receive every queued event without blocking.
+         * @param max_events the largest number of events to receive, 0 means no limit.
+         * @return the events in the order they were received.
+         */
+        [[nodiscard]] event_list_type drain_events(size_t max_events = 0);
+    };
+
+    /**
+     * The MonitorEventSource class delivers the events received by a Monitor.
+     */
+    class MonitorEventSource : public EventSource
+    {
+    public:
+        using monitor_type = Monitor;
+
+        /**
+         * @brief constructor with monitor
+         * @param monitor the monitor, already receiving, which must outlive the object.
+         */
+        explicit MonitorEventSource(monitor_type & monitor);
+
+        [[nodiscard]] int get_file_descriptor() const override;
+
+        [[nodiscard]] std::optional<event_type> try_get_event() override;
+
+    private:
+        monitor_type & m_monitor;
+    };
+
+    /**
+     * The SocketEventSource class delivers events read as uevent messages from a datagram or
+     * sequenced packet socket, such as one end of a socketpair that an EventReplayer writes to.
+     *
+     * Messages that are truncated or are not uevent messages are counted and dropped.
+     */
+    class SocketEventSource : public EventSource
+    {
+    public:
+        /**
+         * @brief constructor with socket
+         * @param fd the socket, which must stay open for the lifetime of the object.
+         */
+        explicit SocketEventSource(int fd);
+
+        [[nodiscard]] int get_file_descriptor() const override;
+
+        [[nodiscard]] std::optional<event_type> try_get_event() override;
+
+        /**
+         * @brief method to get the number of messages dropped because they could not be decoded.
+         * @return the number of dropped messages.
+         */
+        [[nodiscard]] size_t get_dropped_message_count() const;
+
+        constexpr static size_t MESSAGE_BUFFER_SIZE = 8192;
+
+    private:
+        int m_fd;
+        std::vector<char> m_buffer;
+        size_t m_dropped_message_count;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFEVENTSOURCE_HPP
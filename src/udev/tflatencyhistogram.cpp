@@ -0,0 +1,132 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "tflatencyhistogram.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    void LatencyHistogram::add(duration_type latency)
+    {
+        latency = std::max(latency, duration_type{0});
+        m_buckets[get_bucket(latency)]++;
+        m_count++;
+        m_total += latency;
+        m_max = std::max(m_max, latency);
+    }
+
+    void LatencyHistogram::merge(const LatencyHistogram & histogram)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            m_buckets[i] += histogram.m_buckets[i];
+        }
+        m_count += histogram.m_count;
+        m_total += histogram.m_total;
+        m_max = std::max(m_max, histogram.m_max);
+    }
+
+    void LatencyHistogram::clear()
+    {
+        m_buckets.fill(0);
+        m_count = 0;
+        m_total = duration_type{0};
+        m_max = duration_type{0};
+    }
+
+    LatencyHistogram::count_type LatencyHistogram::get_count() const
+    {
+        return m_count;
+    }
+
+    LatencyHistogram::duration_type LatencyHistogram::get_max() const
+    {
+        return m_max;
+    }
+
+    LatencyHistogram::duration_type LatencyHistogram::get_mean() const
+    {
+        if (m_count == 0)
+        {
+            return duration_type{0};
+        }
+        return m_total / static_cast<duration_type::rep>(m_count);
+    }
+
+    LatencyHistogram::duration_type LatencyHistogram::percentile(double p) const
+    {
+        if (m_count == 0)
+        {
+            return duration_type{0};
+        }
+
+        // The rank of the percentile, counting from 1, so that percentile 0 is the first duration.
+        auto fraction = std::clamp(p, 0.0, 100.0) / 100.0;
+        auto rank = static_cast<count_type>(std::ceil(fraction * static_cast<double>(m_count)));
+        rank = std::max(rank, count_type{1});
+
+        count_type seen{0};
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            seen += m_buckets[i];
+            if (seen >= rank)
+            {
+                return std::min(get_bucket_upper_bound(i), m_max);
+            }
+        }
+        return m_max;
+    }
+
+    const LatencyHistogram::bucket_list_type & LatencyHistogram::get_buckets() const
+    {
+        return m_buckets;
+    }
+
+    LatencyHistogram::duration_type LatencyHistogram::get_bucket_upper_bound(size_t bucket)
+    {
+        if (bucket + 1 >= BUCKET_COUNT)
+        {
+            return duration_type::max();
+        }
+        return std::chrono::microseconds{uint64_t{1} << bucket};
+    }
+
+    size_t LatencyHistogram::get_bucket(duration_type latency)
+    {
+        auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+        if (microseconds <= 0)
+        {
+            return 0;
+        }
+        auto bucket = static_cast<size_t>(std::bit_width(static_cast<uint64_t>(microseconds)));
+        return std::min(bucket, BUCKET_COUNT - 1);
+    }
+
+} // namespace TF::Linux::Udev
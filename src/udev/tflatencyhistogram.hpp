@@ -0,0 +1,132 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFLATENCYHISTOGRAM_HPP
+#define TFLATENCYHISTOGRAM_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The LatencyHistogram class counts durations in buckets whose bounds double from one
+     * bucket to the next.
+     *
+     * Bucket 0 holds durations under one microsecond and bucket @e i holds durations from
+     * 2^(i-1) up to 2^i microseconds, with the last bucket holding everything longer.  Adding
+     * a duration is a few instructions and no allocation, so a histogram can be updated for
+     * every event, and percentiles are reported to within a factor of two.  The class is not
+     * thread safe.
+     */
+    class LatencyHistogram
+    {
+    public:
+        using duration_type = std::chrono::nanoseconds;
+        using count_type = uint64_t;
+
+        constexpr static size_t BUCKET_COUNT = 32;
+
+        using bucket_list_type = std::array<count_type, BUCKET_COUNT>;
+
+        /**
+         * @brief method to count a duration.
+         * @param latency the duration, negative durations are counted as 0.
+         */
+        void add(duration_type latency);
+
+        /**
+         * @brief method to add the counts of another histogram to this one.
+         * @param histogram the other histogram
+         */
+        void merge(const LatencyHistogram & histogram);
+
+        /**
+         * @brief method to remove every count from the histogram.
+         */
+        void clear();
+
+        /**
+         * @brief method to get the number of durations counted.
+         * @return the number of durations counted.
+         */
+        [[nodiscard]] count_type get_count() const;
+
+        /**
+         * @brief method to get the longest duration counted.
+         * @return the longest duration, 0 if the histogram is empty.
+         */
+        [[nodiscard]] duration_type get_max() const;
+
+        /**
+         * @brief method to get the mean of the durations counted.
+         * @return the mean duration, 0 if the histogram is empty.
+         */
+        [[nodiscard]] duration_type get_mean() const;
+
+        /**
+         * @brief method to get a percentile of the durations counted.
+         * @param p the percentile, from 0 to 100
+         * @return the upper bound of the bucket holding the percentile, which is never more than
+         * the longest duration counted, 0 if the histogram is empty.
+         */
+        [[nodiscard]] duration_type percentile(double p) const;
+
+        /**
+         * @brief method to get the count in each bucket.
+         * @return the counts.
+         */
+        [[nodiscard]] const bucket_list_type & get_buckets() const;
+
+        /**
+         * @brief function to get the upper bound of a bucket.
+         * @param bucket the bucket index
+         * @return the shortest duration too long for the bucket, the maximum duration for the
+         * last bucket.
+         */
+        [[nodiscard]] static duration_type get_bucket_upper_bound(size_t bucket);
+
+        /**
+         * @brief function to get the bucket a duration is counted in.
+         * @param latency the duration
+         * @return the bucket index.
+         */
+        [[nodiscard]] static size_t get_bucket(duration_type latency);
+
+    private:
+        bucket_list_type m_buckets{};
+        count_type m_count{0};
+        duration_type m_total{0};
+        duration_type m_max{0};
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFLATENCYHISTOGRAM_HPP
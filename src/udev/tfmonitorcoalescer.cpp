@@ -0,0 +1,352 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include <system_error>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "tfmonitorcoalescer.hpp"
+#include "tfautofiledescriptor.hpp"
+#include "tfmonitorepolladaptor.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    MonitorCoalescer::MonitorCoalescer(duration_type window, Grouping grouping) :
+        m_window{window}, m_maximum_delay{window * 10}, m_grouping{grouping}, m_received_count{0},
+        m_delivered_count{0}, m_cancelled_count{0}, m_stop_fd{-1}
+    {
+        m_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_stop_fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "eventfd failed"};
+        }
+    }
+
+    MonitorCoalescer::~MonitorCoalescer()
+    {
+        close(m_stop_fd);
+    }
+
+    void MonitorCoalescer::add(device_type device, time_point_type now)
+    {
+        m_received_count++;
+
+        std::string syspath{device.get_syspath_view()};
+        auto action = device.get_action_view();
+
+        auto pending = m_events.find(syspath);
+        if (pending == m_events.end())
+        {
+            auto group = find_group(syspath, now);
+            group->syspaths.push_back(syspath);
+            CoalescedEvent event{std::move(device), string_type{action.data(), action.size()}, 1, now, now};
+            m_events.emplace(std::move(syspath), PendingEvent{std::move(event), group->key});
+            return;
+        }
+
+        auto group = m_group_index.find(pending->second.group_key)->second;
+        group->last_added = now;
+
+        auto & event = pending->second.event;
+        auto pending_action = event.action.stlString();
+        auto collapsed_action = collapse_action(pending_action, action);
+        if (! collapsed_action)
+        {
+            // The device came and went within the window; the syspath stays listed in its group
+            // but has nothing to deliver.
+            m_cancelled_count += event.event_count + 1;
+            m_events.erase(pending);
+            return;
+        }
+
+        event.device = std::move(device);
+        event.action = *collapsed_action;
+        event.event_count++;
+        event.last_added = now;
+    }
+
+    MonitorCoalescer::event_list_type MonitorCoalescer::take_ready(time_point_type now)
+    {
+        event_list_type events;
+        auto group = m_groups.begin();
+        while (group != m_groups.end())
+        {
+            if (ready_time(*group) <= now)
+            {
+                group = take_group(group, events);
+            }
+            else
+            {
+                ++group;
+            }
+        }
+        m_delivered_count += events.size();
+        return events;
+    }
+
+    MonitorCoalescer::event_list_type MonitorCoalescer::take_all()
+    {
+        event_list_type events;
+        auto group = m_groups.begin();
+        while (group != m_groups.end())
+        {
+            group = take_group(group, events);
+        }
+        m_delivered_count += events.size();
+        return events;
+    }
+
+    std::optional<MonitorCoalescer::duration_type> MonitorCoalescer::time_until_ready(time_point_type now) const
+    {
+        if (m_groups.empty())
+        {
+            return {};
+        }
+
+        auto next_ready_time = time_point_type::max();
+        for (auto & group : m_groups)
+        {
+            next_ready_time = std::min(next_ready_time, ready_time(group));
+        }
+        return next_ready_time <= now ? duration_type::zero() : next_ready_time - now;
+    }
+
+    void MonitorCoalescer::run(monitor_type & monitor, const batch_callback_type & callback)
+    {
+        constexpr uint32_t monitor_event_id = 0;
+        constexpr uint32_t stop_event_id = 1;
+
+        AutoFileDescriptor epoll_fd{epoll_create1(EPOLL_CLOEXEC)};
+        if (*epoll_fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_create1 failed"};
+        }
+
+        MonitorEpollAdaptor adaptor{monitor};
+        epoll_data_t monitor_data{};
+        monitor_data.u32 = monitor_event_id;
+        adaptor.add_to_epoll(*epoll_fd, monitor_data);
+
+        epoll_event stop_event{};
+        stop_event.events = EPOLLIN;
+        stop_event.data.u32 = stop_event_id;
+        if (epoll_ctl(*epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &stop_event) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+
+        bool keep_monitoring{true};
+        while (keep_monitoring)
+        {
+            int timeout{-1};
+            if (adaptor.has_pending())
+            {
+                timeout = 0;
+            }
+            else if (auto wait_time = time_until_ready())
+            {
+                // Round up so that the groups are ready when epoll_wait returns.
+                auto milliseconds = std::chrono::ceil<std::chrono::milliseconds>(*wait_time).count();
+                timeout = static_cast<int>(std::min<decltype(milliseconds)>(milliseconds, std::numeric_limits<int>::max()));
+            }
+
+            epoll_event events[2];
+            auto event_count = epoll_wait(*epoll_fd, events, 2, timeout);
+            if (event_count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error{errno, std::system_category(), "epoll_wait failed"};
+            }
+
+            bool monitor_ready = adaptor.has_pending();
+            for (int i = 0; i < event_count; i++)
+            {
+                if (events[i].data.u32 == stop_event_id)
+                {
+                    keep_monitoring = false;
+                }
+                else
+                {
+                    monitor_ready = true;
+                }
+            }
+
+            if (! keep_monitoring)
+            {
+                break;
+            }
+
+            if (monitor_ready)
+            {
+                auto now = clock_type::now();
+                for (auto & device : adaptor.handle_ready())
+                {
+                    add(std::move(device), now);
+                }
+            }
+
+            auto ready_events = take_ready();
+            if (! ready_events.empty())
+            {
+                callback(ready_events);
+            }
+        }
+
+        // Clear the stop signal so that the loop can be run again.
+        uint64_t stop_value;
+        (void)!read(m_stop_fd, &stop_value, sizeof(stop_value));
+    }
+
+    void MonitorCoalescer::stop()
+    {
+        uint64_t stop_value{1};
+        (void)!write(m_stop_fd, &stop_value, sizeof(stop_value));
+    }
+
+    MonitorCoalescer::duration_type MonitorCoalescer::get_window() const
+    {
+        return m_window;
+    }
+
+    void MonitorCoalescer::set_window(duration_type window)
+    {
+        m_window = window;
+    }
+
+    MonitorCoalescer::duration_type MonitorCoalescer::get_maximum_delay() const
+    {
+        return m_maximum_delay;
+    }
+
+    void MonitorCoalescer::set_maximum_delay(duration_type delay)
+    {
+        m_maximum_delay = delay;
+    }
+
+    size_t MonitorCoalescer::get_received_count() const
+    {
+        return m_received_count;
+    }
+
+    size_t MonitorCoalescer::get_delivered_count() const
+    {
+        return m_delivered_count;
+    }
+
+    size_t MonitorCoalescer::get_cancelled_count() const
+    {
+        return m_cancelled_count;
+    }
+
+    size_t MonitorCoalescer::get_pending_count() const
+    {
+        return m_events.size();
+    }
+
+    MonitorCoalescer::group_list_type::iterator MonitorCoalescer::find_group(const std::string & syspath,
+                                                                             time_point_type now)
+    {
+        if (m_grouping == Grouping::PARENT)
+        {
+            // Walk up the syspath looking for an ancestor that already has a pending group.
+            auto separator = syspath.rfind('/');
+            while (separator != std::string::npos && separator > 0)
+            {
+                auto ancestor = m_group_index.find(syspath.substr(0, separator));
+                if (ancestor != m_group_index.end())
+                {
+                    ancestor->second->last_added = now;
+                    return ancestor->second;
+                }
+                separator = syspath.rfind('/', separator - 1);
+            }
+        }
+
+        auto group = m_group_index.find(syspath);
+        if (group != m_group_index.end())
+        {
+            // The syspath had an event that was cancelled, reuse its group.
+            group->second->last_added = now;
+            return group->second;
+        }
+
+        m_groups.push_back(Group{syspath, now, now, {}});
+        auto new_group = std::prev(m_groups.end());
+        m_group_index.emplace(syspath, new_group);
+        return new_group;
+    }
+
+    MonitorCoalescer::group_list_type::iterator MonitorCoalescer::take_group(group_list_type::iterator group,
+                                                                             event_list_type & events)
+    {
+        for (auto & syspath : group->syspaths)
+        {
+            auto pending = m_events.find(syspath);
+            if (pending != m_events.end() && pending->second.group_key == group->key)
+            {
+                events.emplace_back(std::move(pending->second.event));
+                m_events.erase(pending);
+            }
+        }
+
+        m_group_index.erase(group->key);
+        return m_groups.erase(group);
+    }
+
+    MonitorCoalescer::time_point_type MonitorCoalescer::ready_time(const Group & group) const
+    {
+        return std::min(group.last_added + m_window, group.first_added + m_maximum_delay);
+    }
+
+    std::optional<MonitorCoalescer::string_type> MonitorCoalescer::collapse_action(std::string_view pending,
+                                                                                  std::string_view next)
+    {
+        if (next == "remove")
+        {
+            if (pending == "add")
+            {
+                return {};
+            }
+            return string_type{"remove"};
+        }
+
+        if (pending == "add" && next != "add")
+        {
+            return string_type{"add"};
+        }
+
+        return string_type{next.data(), next.size()};
+    }
+
+} // namespace TF::Linux::Udev
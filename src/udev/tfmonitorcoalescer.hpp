@@ -0,0 +1,275 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFMONITORCOALESCER_HPP
+#define TFMONITORCOALESCER_HPP
+
+#include <chrono>
+#include <functional>
+#include <list>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The MonitorCoalescer class collapses bursts of monitor events into fewer logical events.
+     *
+     * Plugging in a disk produces add and change events for the disk, for each partition and
+     * for several parents within a few milliseconds.  The coalescer keeps one pending event per
+     * syspath and collapses the actions of the events for that syspath:
+     *
+     * - add followed by change (or any action other than remove) stays add,
+     * - add followed by remove cancels out and nothing is delivered,
+     * - any other sequence ending in remove becomes remove,
+     * - otherwise the last action is kept.
+     *
+     * Pending events are gathered into groups, either one group per syspath or, with
+     * Grouping::PARENT, one group per device together with the devices below it (a device joins
+     * the pending group of its nearest ancestor).  A group is delivered once no event has been
+     * added to it for the coalescing window, or once it has been pending for the maximum delay,
+     * so a steady stream of events cannot hold a group back forever.
+     *
+     * A MonitorCoalescer object is not safe to use from more than one thread at a time, except
+     * that stop may be called from any thread.
+     */
+    class MonitorCoalescer
+    {
+    public:
+        enum class Grouping
+        {
+            SYSPATH,
+            PARENT
+        };
+
+        using device_type = Device;
+        using monitor_type = Monitor;
+        using string_type = String;
+        using clock_type = std::chrono::steady_clock;
+        using duration_type = clock_type::duration;
+        using time_point_type = clock_type::time_point;
+
+        /** A logical event made from one or more events for the same syspath. */
+        struct CoalescedEvent
+        {
+            /** The device from the last event. */
+            device_type device;
+            /** The collapsed action. */
+            string_type action;
+            /** The number of events collapsed into this one. */
+            size_t event_count;
+            /** The time the first event was added. */
+            time_point_type first_added;
+            /** The time the last event was added. */
+            time_point_type last_added;
+        };
+
+        using event_list_type = std::vector<CoalescedEvent>;
+        using batch_callback_type = std::function<void(event_list_type &)>;
+
+        /**
+         * @brief constructor with window and grouping
+         * @param window the time a group must be quiet before it is delivered.
+         * @param grouping how pending events are grouped.
+         *
+         * The maximum delay starts out as ten times the window.
+         */
+        explicit MonitorCoalescer(duration_type window, Grouping grouping = Grouping::SYSPATH);
+
+        /** destructor */
+        ~MonitorCoalescer();
+
+        MonitorCoalescer(const MonitorCoalescer &) = delete;
+        MonitorCoalescer & operator=(const MonitorCoalescer &) = delete;
+
+        /**
+         * @brief method to add an event from a monitor.
+         * @param device the device received from the monitor
+         * @param now the time the event was received
+         */
+        void add(device_type device, time_point_type now = clock_type::now());
+
+        /**
+         * @brief method to take the events of the groups that are ready to be delivered.
+         * @param now the current time
+         * @return the events, group by group in the order the groups were started.
+         */
+        [[nodiscard]] event_list_type take_ready(time_point_type now = clock_type::now());
+
+        /**
+         * @brief method to take every pending event whether its group is ready or not.
+         * @return the events, group by group in the order the groups were started.
+         */
+        [[nodiscard]] event_list_type take_all();
+
+        /**
+         * @brief method to get the time until the next group is ready.
+         * @param now the current time
+         * @return the time, zero if a group is already ready, or an empty optional if nothing is pending.
+         */
+        [[nodiscard]] std::optional<duration_type> time_until_ready(time_point_type now = clock_type::now()) const;
+
+        /**
+         * @brief method to run an event loop that coalesces the events of a monitor.
+         * @param monitor the monitor, on which monitor() has already been called.
+         * @param callback the function to call with each batch of coalesced events.
+         *
+         * The method blocks until another thread calls stop.  Events still pending when the
+         * loop stops are kept and can be collected with take_all.
+         */
+        void run(monitor_type & monitor, const batch_callback_type & callback);
+
+        /**
+         * @brief method to make a running event loop return.
+         */
+        void stop();
+
+        /**
+         * @brief method to get the coalescing window.
+         * @return the window.
+         */
+        [[nodiscard]] duration_type get_window() const;
+
+        /**
+         * @brief method to set the coalescing window.
+         * @param window the new window.
+         */
+        void set_window(duration_type window);
+
+        /**
+         * @brief method to get the maximum delay.
+         * @return the maximum time a group stays pending.
+         */
+        [[nodiscard]] duration_type get_maximum_delay() const;
+
+        /**
+         * @brief method to set the maximum delay.
+         * @param delay the maximum time a group stays pending.
+         */
+        void set_maximum_delay(duration_type delay);
+
+        /**
+         * @brief method to get the number of events added.
+         * @return the number of events added.
+         */
+        [[nodiscard]] size_t get_received_count() const;
+
+        /**
+         * @brief method to get the number of coalesced events delivered.
+         * @return the number of coalesced events returned by take_ready, take_all or passed
+         * to the run callback.
+         */
+        [[nodiscard]] size_t get_delivered_count() const;
+
+        /**
+         * @brief method to get the number of add events cancelled by a later remove event.
+         * @return the number of cancelled events.
+         */
+        [[nodiscard]] size_t get_cancelled_count() const;
+
+        /**
+         * @brief method to get the number of coalesced events waiting to be delivered.
+         * @return the number of pending events.
+         */
+        [[nodiscard]] size_t get_pending_count() const;
+
+    private:
+        /** The pending event for a syspath and the group it belongs to. */
+        struct PendingEvent
+        {
+            CoalescedEvent event;
+            std::string group_key;
+        };
+
+        /** A group of syspaths delivered together. */
+        struct Group
+        {
+            std::string key;
+            time_point_type first_added;
+            time_point_type last_added;
+            std::vector<std::string> syspaths;
+        };
+
+        using group_list_type = std::list<Group>;
+
+        /**
+         * @brief helper method to find or start the group a new pending syspath belongs to.
+         * @param syspath the syspath
+         * @param now the time of the event, recorded as the last event of the group.
+         * @return the group
+         */
+        group_list_type::iterator find_group(const std::string & syspath, time_point_type now);
+
+        /**
+         * @brief helper method to move the events of a group to a list and remove the group.
+         * @param group the group
+         * @param events the list to store the events
+         * @return the group after the removed group.
+         */
+        group_list_type::iterator take_group(group_list_type::iterator group, event_list_type & events);
+
+        /**
+         * @brief helper method to get the time a group is ready to be delivered.
+         * @param group the group
+         * @return the time the group becomes ready.
+         */
+        [[nodiscard]] time_point_type ready_time(const Group & group) const;
+
+        /**
+         * @brief helper function to collapse the action of a pending event with a new action.
+         * @param pending the action of the pending event
+         * @param next the action of the new event
+         * @return the collapsed action, or an empty optional if the two actions cancel out.
+         */
+        static std::optional<string_type> collapse_action(std::string_view pending, std::string_view next);
+
+        duration_type m_window;
+        duration_type m_maximum_delay;
+        Grouping m_grouping;
+
+        group_list_type m_groups;
+        std::unordered_map<std::string, group_list_type::iterator> m_group_index;
+        std::unordered_map<std::string, PendingEvent> m_events;
+
+        size_t m_received_count;
+        size_t m_delivered_count;
+        size_t m_cancelled_count;
+
+        // eventfd used by stop to wake up run.
+        int m_stop_fd;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFMONITORCOALESCER_HPP
@@ -0,0 +1,92 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <system_error>
+#include <cerrno>
+#include <stdexcept>
+#include "tfmonitorepolladaptor.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    MonitorEpollAdaptor::MonitorEpollAdaptor(monitor_type & monitor, size_t batch_size) :
+        m_monitor{monitor}, m_batch_size{0}, m_pending{false}
+    {
+        set_batch_size(batch_size);
+    }
+
+    void MonitorEpollAdaptor::add_to_epoll(int epoll_fd, epoll_data_t data) const
+    {
+        epoll_event event{};
+        event.events = get_epoll_events();
+        event.data = data;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, m_monitor.get_file_descriptor(), &event) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+    }
+
+    void MonitorEpollAdaptor::remove_from_epoll(int epoll_fd) const
+    {
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, m_monitor.get_file_descriptor(), nullptr) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+    }
+
+    uint32_t MonitorEpollAdaptor::get_epoll_events() const
+    {
+        return EPOLLIN | EPOLLET;
+    }
+
+    MonitorEpollAdaptor::device_list_type MonitorEpollAdaptor::handle_ready()
+    {
+        auto devices = m_monitor.drain_devices(m_batch_size);
+        m_pending = devices.size() == m_batch_size;
+        return devices;
+    }
+
+    bool MonitorEpollAdaptor::has_pending() const
+    {
+        return m_pending;
+    }
+
+    size_t MonitorEpollAdaptor::get_batch_size() const
+    {
+        return m_batch_size;
+    }
+
+    void MonitorEpollAdaptor::set_batch_size(size_t batch_size)
+    {
+        if (batch_size == 0)
+        {
+            throw std::invalid_argument{"batch size must be greater than 0"};
+        }
+        m_batch_size = batch_size;
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,111 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFMONITOREPOLLADAPTOR_HPP
+#define TFMONITOREPOLLADAPTOR_HPP
+
+#include <cstdint>
+#include <sys/epoll.h>
+#include "tfudev.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The MonitorEpollAdaptor class lets a Monitor take part in an epoll event loop owned by
+     * the caller.
+     *
+     * The adaptor registers the monitor file descriptor edge-triggered, and each call to
+     * handle_ready receives up to the batch size of queued devices.  Because an edge-triggered
+     * descriptor is not reported again until new data arrives, a caller must keep calling
+     * handle_ready (for example by using a zero epoll timeout) while has_pending returns true.
+     */
+    class MonitorEpollAdaptor
+    {
+    public:
+        using monitor_type = Monitor;
+        using device_list_type = Monitor::device_list_type;
+
+        /**
+         * @brief constructor with monitor and batch size
+         * @param monitor the monitor, which must outlive the adaptor.
+         * @param batch_size the largest number of devices returned by one call to handle_ready.
+         */
+        explicit MonitorEpollAdaptor(monitor_type & monitor, size_t batch_size = Monitor::DEFAULT_BATCH_SIZE);
+
+        /**
+         * @brief method to register the monitor file descriptor with an epoll set.
+         * @param epoll_fd the epoll file descriptor
+         * @param data the data epoll_wait returns for events on the monitor.
+         */
+        void add_to_epoll(int epoll_fd, epoll_data_t data) const;
+
+        /**
+         * @brief method to remove the monitor file descriptor from an epoll set.
+         * @param epoll_fd the epoll file descriptor
+         */
+        void remove_from_epoll(int epoll_fd) const;
+
+        /**
+         * @brief method to get the epoll events used to register the monitor.
+         * @return EPOLLIN | EPOLLET
+         */
+        [[nodiscard]] uint32_t get_epoll_events() const;
+
+        /**
+         * @brief method to receive a batch of devices after epoll reports the monitor ready.
+         * @return up to the batch size of devices, in the order they were received.
+         */
+        [[nodiscard]] device_list_type handle_ready();
+
+        /**
+         * @brief method to check if the last call to handle_ready stopped at the batch size.
+         * @return true if devices may still be queued on the monitor and false otherwise.
+         */
+        [[nodiscard]] bool has_pending() const;
+
+        /**
+         * @brief method to get the batch size.
+         * @return the batch size.
+         */
+        [[nodiscard]] size_t get_batch_size() const;
+
+        /**
+         * @brief method to set the batch size.
+         * @param batch_size the new batch size, must be greater than 0.
+         */
+        void set_batch_size(size_t batch_size);
+
+    private:
+        monitor_type & m_monitor;
+        size_t m_batch_size;
+        bool m_pending;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFMONITOREPOLLADAPTOR_HPP
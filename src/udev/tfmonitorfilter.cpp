@@ -0,0 +1,588 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <fnmatch.h>
+#include "tfmonitorfilter.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        // The layout of the header udevd puts in front of each message it sends to libudev
+        // listeners.  The magic and the filter hashes are stored in network order; the other
+        // fields are stored in host order.
+        constexpr uint32_t UDEV_MONITOR_MAGIC = 0xfeedcafe;
+        constexpr uint32_t HEADER_MAGIC_OFFSET = 8;
+        constexpr uint32_t HEADER_PROPERTIES_OFFSET_OFFSET = 16;
+        constexpr uint32_t HEADER_PROPERTIES_LENGTH_OFFSET = 20;
+        constexpr uint32_t HEADER_SUBSYSTEM_HASH_OFFSET = 24;
+        constexpr uint32_t HEADER_DEVTYPE_HASH_OFFSET = 28;
+        constexpr uint32_t HEADER_TAG_BLOOM_HI_OFFSET = 32;
+        constexpr uint32_t HEADER_TAG_BLOOM_LO_OFFSET = 36;
+        constexpr uint32_t HEADER_SIZE = 40;
+
+        constexpr uint32_t PASS_PACKET = 0xffffffff;
+        constexpr uint32_t DROP_PACKET = 0;
+
+        /** The MurmurHash2 function udevd uses for the subsystem, devtype and tag hashes. */
+        uint32_t string_hash32(std::string_view s)
+        {
+            constexpr uint32_t m = 0x5bd1e995;
+            constexpr int r = 24;
+
+            auto length = s.size();
+            auto data = reinterpret_cast<const unsigned char *>(s.data());
+            uint32_t h = static_cast<uint32_t>(length);
+
+            while (length >= 4)
+            {
+                uint32_t k;
+                std::memcpy(&k, data, sizeof(k));
+                k *= m;
+                k ^= k >> r;
+                k *= m;
+                h *= m;
+                h ^= k;
+                data += 4;
+                length -= 4;
+            }
+
+            switch (length)
+            {
+                case 3:
+                    h ^= static_cast<uint32_t>(data[2]) << 16;
+                    [[fallthrough]];
+                case 2:
+                    h ^= static_cast<uint32_t>(data[1]) << 8;
+                    [[fallthrough]];
+                case 1:
+                    h ^= data[0];
+                    h *= m;
+                    break;
+                default:
+                    break;
+            }
+
+            h ^= h >> 13;
+            h *= m;
+            h ^= h >> 15;
+            return h;
+        }
+
+        /** The bloom filter bits udevd sets in the message header for a tag. */
+        uint64_t string_bloom64(std::string_view s)
+        {
+            auto hash = string_hash32(s);
+            uint64_t bits{0};
+            bits |= uint64_t{1} << (hash & 63);
+            bits |= uint64_t{1} << ((hash >> 6) & 63);
+            bits |= uint64_t{1} << ((hash >> 12) & 63);
+            bits |= uint64_t{1} << ((hash >> 18) & 63);
+            return bits;
+        }
+
+        /**
+         * Helper class to assemble a classic BPF program.  Jumps name their targets with labels
+         * which are resolved to relative offsets when the program is finished.
+         */
+        class ProgramBuilder
+        {
+        public:
+            using label_type = size_t;
+
+            constexpr static label_type NEXT = std::numeric_limits<label_type>::max();
+
+            label_type new_label()
+            {
+                m_labels.push_back(NEXT);
+                return m_labels.size() - 1;
+            }
+
+            void bind(label_type label)
+            {
+                m_labels[label] = m_program.size();
+            }
+
+            void statement(uint16_t code, uint32_t k)
+            {
+                m_program.push_back(BPF_STMT(code, k));
+            }
+
+            void jump(uint16_t code, uint32_t k, label_type jump_true, label_type jump_false)
+            {
+                m_jumps.push_back({m_program.size(), jump_true, jump_false});
+                m_program.push_back(BPF_JUMP(code, k, 0, 0));
+            }
+
+            void jump_always(label_type target)
+            {
+                m_jumps.push_back({m_program.size(), target, NEXT});
+                m_program.push_back(BPF_JUMP(BPF_JMP | BPF_JA, 0, 0, 0));
+            }
+
+            MonitorFilter::program_type finish()
+            {
+                for (auto & pending : m_jumps)
+                {
+                    auto & instruction = m_program[pending.index];
+                    if (BPF_OP(instruction.code) == BPF_JA)
+                    {
+                        instruction.k = offset_to(pending.index, pending.jump_true);
+                    }
+                    else
+                    {
+                        auto jump_true = offset_to(pending.index, pending.jump_true);
+                        auto jump_false = offset_to(pending.index, pending.jump_false);
+                        if (jump_true > std::numeric_limits<uint8_t>::max() ||
+                            jump_false > std::numeric_limits<uint8_t>::max())
+                        {
+                            throw std::logic_error{"monitor filter jump out of range"};
+                        }
+                        instruction.jt = static_cast<uint8_t>(jump_true);
+                        instruction.jf = static_cast<uint8_t>(jump_false);
+                    }
+                }
+
+                if (m_program.size() > BPF_MAXINSNS)
+                {
+                    throw std::invalid_argument{"monitor filter has too many rules"};
+                }
+
+                return std::move(m_program);
+            }
+
+        private:
+            struct PendingJump
+            {
+                size_t index;
+                label_type jump_true;
+                label_type jump_false;
+            };
+
+            uint32_t offset_to(size_t index, label_type label) const
+            {
+                if (label == NEXT)
+                {
+                    return 0;
+                }
+                return static_cast<uint32_t>(m_labels[label] - index - 1);
+            }
+
+            MonitorFilter::program_type m_program;
+            std::vector<size_t> m_labels;
+            std::vector<PendingJump> m_jumps;
+        };
+
+        /**
+         * Helper function to add instructions that compare the bytes at X + @e offset with
+         * @e bytes, jumping to @e mismatch at the first difference.
+         */
+        void compare_bytes(ProgramBuilder & builder, uint32_t offset, std::string_view bytes,
+                           ProgramBuilder::label_type mismatch)
+        {
+            size_t position{0};
+            while (position < bytes.size())
+            {
+                auto remaining = bytes.size() - position;
+                auto width = remaining >= 4 ? size_t{4} : (remaining >= 2 ? size_t{2} : size_t{1});
+                uint16_t size_code = width == 4 ? BPF_W : (width == 2 ? BPF_H : BPF_B);
+
+                // BPF loads are big endian.
+                uint32_t value{0};
+                for (size_t i = 0; i < width; i++)
+                {
+                    value = (value << 8) | static_cast<unsigned char>(bytes[position + i]);
+                }
+
+                builder.statement(BPF_LD | size_code | BPF_IND, offset + static_cast<uint32_t>(position));
+                builder.jump(BPF_JMP | BPF_JEQ | BPF_K, value, ProgramBuilder::NEXT, mismatch);
+                position += width;
+            }
+        }
+
+        /** Helper function to read a host order header field. */
+        uint32_t read_header_field(std::string_view message, uint32_t offset)
+        {
+            uint32_t value;
+            std::memcpy(&value, message.data() + offset, sizeof(value));
+            return value;
+        }
+
+        /** Helper function to get the block of NUL separated KEY=VALUE strings in a message. */
+        std::optional<std::string_view> get_property_block(std::string_view message)
+        {
+            if (message.size() >= HEADER_SIZE && message.compare(0, 8, std::string_view{"libudev\0", 8}) == 0)
+            {
+                auto magic = read_header_field(message, HEADER_MAGIC_OFFSET);
+                if constexpr (std::endian::native == std::endian::little)
+                {
+                    magic = __builtin_bswap32(magic);
+                }
+                if (magic != UDEV_MONITOR_MAGIC)
+                {
+                    return {};
+                }
+
+                auto offset = read_header_field(message, HEADER_PROPERTIES_OFFSET_OFFSET);
+                auto length = read_header_field(message, HEADER_PROPERTIES_LENGTH_OFFSET);
+                if (offset > message.size() || length > message.size() - offset)
+                {
+                    return {};
+                }
+                return message.substr(offset, length);
+            }
+
+            // A kernel message starts with action@devpath followed by the properties.
+            auto end_of_summary = message.find('\0');
+            if (end_of_summary == std::string_view::npos ||
+                message.substr(0, end_of_summary).find('@') == std::string_view::npos)
+            {
+                return {};
+            }
+            return message.substr(end_of_summary + 1);
+        }
+
+        /** Helper function to find the value of a property in a property block. */
+        std::optional<std::string_view> find_property(std::string_view block, std::string_view key)
+        {
+            while (! block.empty())
+            {
+                auto end_of_entry = block.find('\0');
+                auto entry = block.substr(0, end_of_entry);
+                if (entry.size() > key.size() && entry[key.size()] == '=' && entry.starts_with(key))
+                {
+                    return entry.substr(key.size() + 1);
+                }
+                if (end_of_entry == std::string_view::npos)
+                {
+                    break;
+                }
+                block.remove_prefix(end_of_entry + 1);
+            }
+            return {};
+        }
+
+        /** Helper function to check if a ':' separated tag list contains a tag. */
+        bool tag_list_contains(std::string_view tags, std::string_view tag)
+        {
+            while (! tags.empty())
+            {
+                auto separator = tags.find(':');
+                if (tags.substr(0, separator) == tag)
+                {
+                    return true;
+                }
+                if (separator == std::string_view::npos)
+                {
+                    break;
+                }
+                tags.remove_prefix(separator + 1);
+            }
+            return false;
+        }
+    } // namespace
+
+    void MonitorFilter::match_subsystem(const string_type & subsystem)
+    {
+        m_subsystems.emplace_back(subsystem.stlString(), std::string{});
+    }
+
+    void MonitorFilter::match_subsystem_and_devtype(const string_type & subsystem, const string_type & devtype)
+    {
+        m_subsystems.emplace_back(subsystem.stlString(), devtype.stlString());
+    }
+
+    void MonitorFilter::match_tag(const string_type & tag)
+    {
+        m_tags.emplace_back(tag.stlString());
+    }
+
+    void MonitorFilter::match_action(const string_type & action)
+    {
+        m_actions.emplace_back(action.stlString());
+    }
+
+    void MonitorFilter::match_property(const string_type & property, const string_type & value)
+    {
+        if (property.empty())
+        {
+            throw std::invalid_argument{"property name must not be empty"};
+        }
+        m_properties.emplace_back(property.stlString(), value.stlString());
+    }
+
+    void MonitorFilter::match_system_name(const string_type & pattern)
+    {
+        m_system_names.emplace_back(pattern.stlString());
+    }
+
+    bool MonitorFilter::empty() const
+    {
+        return m_subsystems.empty() && m_tags.empty() && m_actions.empty() && m_properties.empty() &&
+               m_system_names.empty();
+    }
+
+    MonitorFilter::program_type MonitorFilter::compile() const
+    {
+        ProgramBuilder builder;
+        auto pass = builder.new_label();
+        auto drop = builder.new_label();
+
+        // Messages without the libudev magic come from the kernel and are checked in user space.
+        builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_MAGIC_OFFSET);
+        auto udev_message = builder.new_label();
+        builder.jump(BPF_JMP | BPF_JEQ | BPF_K, UDEV_MONITOR_MAGIC, udev_message, ProgramBuilder::NEXT);
+        builder.jump_always(pass);
+        builder.bind(udev_message);
+
+        if (! m_tags.empty())
+        {
+            auto tag_matched = builder.new_label();
+            for (auto & tag : m_tags)
+            {
+                auto next_tag = builder.new_label();
+                auto bloom = string_bloom64(tag);
+                auto bloom_hi = static_cast<uint32_t>(bloom >> 32);
+                auto bloom_lo = static_cast<uint32_t>(bloom & 0xffffffff);
+
+                builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_TAG_BLOOM_HI_OFFSET);
+                builder.statement(BPF_ALU | BPF_AND | BPF_K, bloom_hi);
+                builder.jump(BPF_JMP | BPF_JEQ | BPF_K, bloom_hi, ProgramBuilder::NEXT, next_tag);
+                builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_TAG_BLOOM_LO_OFFSET);
+                builder.statement(BPF_ALU | BPF_AND | BPF_K, bloom_lo);
+                builder.jump(BPF_JMP | BPF_JEQ | BPF_K, bloom_lo, ProgramBuilder::NEXT, next_tag);
+                builder.jump_always(tag_matched);
+                builder.bind(next_tag);
+            }
+            builder.jump_always(drop);
+            builder.bind(tag_matched);
+        }
+
+        if (! m_subsystems.empty())
+        {
+            auto subsystem_matched = builder.new_label();
+            for (auto & [subsystem, devtype] : m_subsystems)
+            {
+                auto next_subsystem = builder.new_label();
+                builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_SUBSYSTEM_HASH_OFFSET);
+                builder.jump(BPF_JMP | BPF_JEQ | BPF_K, string_hash32(subsystem), ProgramBuilder::NEXT,
+                             next_subsystem);
+                if (! devtype.empty())
+                {
+                    builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_DEVTYPE_HASH_OFFSET);
+                    builder.jump(BPF_JMP | BPF_JEQ | BPF_K, string_hash32(devtype), ProgramBuilder::NEXT,
+                                 next_subsystem);
+                }
+                builder.jump_always(subsystem_matched);
+                builder.bind(next_subsystem);
+            }
+            builder.jump_always(drop);
+            builder.bind(subsystem_matched);
+        }
+
+        if (! m_actions.empty())
+        {
+            // udevd writes ACTION as the first property of the message.  The offset of the
+            // property block is stored in host order, so load it into X one byte at a time.  If
+            // the offset or the first property is not what is expected, the action cannot be
+            // decided here and the message is passed on.  The property block of a message from
+            // udevd is always longer than the bytes compared, so the loads stay inside the packet.
+            auto action_decided = builder.new_label();
+            auto action_undecidable = builder.new_label();
+            auto compare_actions = builder.new_label();
+            builder.statement(BPF_LD | BPF_W | BPF_ABS, HEADER_PROPERTIES_OFFSET_OFFSET);
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                builder.statement(BPF_ALU | BPF_AND | BPF_K, 0x00ffffff);
+                builder.jump(BPF_JMP | BPF_JEQ | BPF_K, 0, ProgramBuilder::NEXT, action_undecidable);
+                builder.statement(BPF_LD | BPF_B | BPF_ABS, HEADER_PROPERTIES_OFFSET_OFFSET);
+            }
+            else
+            {
+                builder.jump(BPF_JMP | BPF_JGT | BPF_K, 0xff, action_undecidable, ProgramBuilder::NEXT);
+            }
+            builder.statement(BPF_MISC | BPF_TAX, 0);
+
+            constexpr std::string_view action_key{"ACTION="};
+            compare_bytes(builder, 0, action_key, action_undecidable);
+            builder.jump_always(compare_actions);
+            builder.bind(action_undecidable);
+            builder.jump_always(action_decided);
+            builder.bind(compare_actions);
+
+            for (auto & action : m_actions)
+            {
+                auto next_action = builder.new_label();
+                compare_bytes(builder, static_cast<uint32_t>(action_key.size()),
+                              std::string_view{action.c_str(), action.size() + 1}, next_action);
+                builder.jump_always(action_decided);
+                builder.bind(next_action);
+            }
+            builder.jump_always(drop);
+            builder.bind(action_decided);
+        }
+
+        builder.bind(pass);
+        builder.statement(BPF_RET | BPF_K, PASS_PACKET);
+        builder.bind(drop);
+        builder.statement(BPF_RET | BPF_K, DROP_PACKET);
+
+        return builder.finish();
+    }
+
+    bool MonitorFilter::matches(std::string_view message) const
+    {
+        auto block = get_property_block(message);
+        if (! block)
+        {
+            return false;
+        }
+
+        if (! m_actions.empty())
+        {
+            auto action = find_property(*block, "ACTION");
+            if (! action)
+            {
+                return false;
+            }
+
+            bool matched{false};
+            for (auto & a : m_actions)
+            {
+                if (*action == a)
+                {
+                    matched = true;
+                    break;
+                }
+            }
+            if (! matched)
+            {
+                return false;
+            }
+        }
+
+        if (! m_subsystems.empty())
+        {
+            auto subsystem = find_property(*block, "SUBSYSTEM");
+            if (! subsystem)
+            {
+                return false;
+            }
+
+            std::optional<std::string_view> devtype{};
+            bool matched{false};
+            for (auto & [s, d] : m_subsystems)
+            {
+                if (*subsystem != s)
+                {
+                    continue;
+                }
+                if (d.empty())
+                {
+                    matched = true;
+                    break;
+                }
+                if (! devtype)
+                {
+                    devtype = find_property(*block, "DEVTYPE").value_or(std::string_view{});
+                }
+                if (*devtype == d)
+                {
+                    matched = true;
+                    break;
+                }
+            }
+            if (! matched)
+            {
+                return false;
+            }
+        }
+
+        if (! m_tags.empty())
+        {
+            auto tags = find_property(*block, "TAGS").value_or(std::string_view{});
+            bool matched{false};
+            for (auto & tag : m_tags)
+            {
+                if (tag_list_contains(tags, tag))
+                {
+                    matched = true;
+                    break;
+                }
+            }
+            if (! matched)
+            {
+                return false;
+            }
+        }
+
+        for (auto & [property, value] : m_properties)
+        {
+            auto property_value = find_property(*block, property);
+            if (! property_value || *property_value != value)
+            {
+                return false;
+            }
+        }
+
+        if (! m_system_names.empty())
+        {
+            auto devpath = find_property(*block, "DEVPATH");
+            if (! devpath)
+            {
+                return false;
+            }
+
+            auto separator = devpath->rfind('/');
+            std::string system_name{separator == std::string_view::npos ? *devpath : devpath->substr(separator + 1)};
+            std::replace(system_name.begin(), system_name.end(), '!', '/');
+            bool matched{false};
+            for (auto & pattern : m_system_names)
+            {
+                if (fnmatch(pattern.c_str(), system_name.c_str(), 0) == 0)
+                {
+                    matched = true;
+                    break;
+                }
+            }
+            if (! matched)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+} // namespace TF::Linux::Udev
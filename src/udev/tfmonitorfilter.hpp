@@ -0,0 +1,137 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFMONITORFILTER_HPP
+#define TFMONITORFILTER_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <linux/filter.h>
+#include "TFFoundation.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The MonitorFilter class describes which uevents a Monitor should receive and compiles that
+     * description into a classic BPF program for the monitor's netlink socket.
+     *
+     * libudev's own socket filter only understands subsystem, device type and tag matches.
+     * MonitorFilter replaces that filter with one that also understands actions, property
+     * values and system name globs.  Rules are checked in two places:
+     *
+     * - In the kernel, the BPF program drops messages from udevd whose subsystem, device type,
+     *   tags or action do not match, using the hashes udevd stores in the message header and the
+     *   ACTION property at the start of the property block.  The kernel only drops a message when
+     *   it is certain the message does not match; anything it cannot decide is passed on.
+     * - In user space, Monitor checks the raw message against every rule before libudev builds a
+     *   udev_device from it, so property and system name rules, and anything the kernel passed
+     *   because it could not decide, never cost a device object.
+     *
+     * Rules of the same kind are alternatives (any subsystem rule may match), except property
+     * rules which must all match.  Rules of different kinds must all match.
+     */
+    class MonitorFilter
+    {
+    public:
+        using string_type = String;
+        using program_type = std::vector<sock_filter>;
+
+        /**
+         * @brief method to match a subsystem
+         * @param subsystem the subsystem
+         */
+        void match_subsystem(const string_type & subsystem);
+
+        /**
+         * @brief method to match a subsystem and device type
+         * @param subsystem the subsystem
+         * @param devtype the device type
+         */
+        void match_subsystem_and_devtype(const string_type & subsystem, const string_type & devtype);
+
+        /**
+         * @brief method to match a tag
+         * @param tag the tag
+         */
+        void match_tag(const string_type & tag);
+
+        /**
+         * @brief method to match an action such as 'add', 'remove' or 'change'.
+         * @param action the action
+         */
+        void match_action(const string_type & action);
+
+        /**
+         * @brief method to require a property to have a value.
+         * @param property the property name
+         * @param value the value
+         */
+        void match_property(const string_type & property, const string_type & value);
+
+        /**
+         * @brief method to match the system name of the device with a glob pattern.
+         * @param pattern the fnmatch(3) pattern, for example "sd*" or "nvme*n*".
+         */
+        void match_system_name(const string_type & pattern);
+
+        /**
+         * @brief method to check if the filter has any rules.
+         * @return true if the filter has no rules and false otherwise.
+         */
+        [[nodiscard]] bool empty() const;
+
+        /**
+         * @brief method to compile the kernel side of the filter.
+         * @return the BPF program.
+         */
+        [[nodiscard]] program_type compile() const;
+
+        /**
+         * @brief method to check a raw netlink message against every rule of the filter.
+         * @param message the message as received from the monitor socket, either from udevd
+         * or from the kernel.
+         * @return true if the message matches and false otherwise.
+         */
+        [[nodiscard]] bool matches(std::string_view message) const;
+
+    private:
+        std::vector<std::pair<std::string, std::string>> m_subsystems;
+        std::vector<std::string> m_tags;
+        std::vector<std::string> m_actions;
+        std::vector<std::pair<std::string, std::string>> m_properties;
+        std::vector<std::string> m_system_names;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFMONITORFILTER_HPP
@@ -0,0 +1,209 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "tfparallelquery.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    ParallelQuery::ParallelQuery(const context_type & ctx, size_t thread_count, size_t queue_capacity) :
+        m_thread_count{thread_count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : thread_count},
+        m_queue_capacity{queue_capacity}, m_load_attributes{true}, m_context{ctx},
+        m_context_pool{ctx, m_thread_count}
+    {
+        if (m_queue_capacity == 0)
+        {
+            throw std::invalid_argument{"queue capacity must be greater than 0"};
+        }
+    }
+
+    ParallelQuery::result_list_type ParallelQuery::run(query_type & query)
+    {
+        result_list_type results;
+        for_each(query, [&results](Result & result) {
+            results.emplace_back(std::move(result));
+        });
+        return results;
+    }
+
+    void ParallelQuery::for_each(query_type & query, const result_callback_type & callback)
+    {
+        auto syspaths = query.run();
+        auto result_count = syspaths.size();
+
+        // Result i lives in slot i % capacity.  A worker only takes index i once the result
+        // capacity places before it has been delivered, so a slot is never reused while full.
+        std::vector<std::optional<Result>> slots(std::min(m_queue_capacity, std::max<size_t>(result_count, 1)));
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable result_available;
+        size_t next_to_take{0};
+        size_t next_to_deliver{0};
+        bool stopping{false};
+
+        auto worker = [&](const context_type & context) {
+            while (true)
+            {
+                size_t index;
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    work_available.wait(lock, [&]() {
+                        return stopping || next_to_take >= result_count ||
+                               next_to_take < next_to_deliver + slots.size();
+                    });
+                    if (stopping || next_to_take >= result_count)
+                    {
+                        return;
+                    }
+                    index = next_to_take++;
+                }
+
+                auto result = create_result(context, syspaths[index]);
+
+                std::lock_guard<std::mutex> lock{mutex};
+                slots[index % slots.size()].emplace(std::move(result));
+                if (index == next_to_deliver)
+                {
+                    result_available.notify_one();
+                }
+            }
+        };
+
+        // Each worker gets a context of its own.  The pool holds one per thread, so this never waits.
+        std::vector<ContextPool::Handle> contexts;
+        std::vector<std::thread> workers;
+        auto worker_count = std::min(m_thread_count, result_count);
+        contexts.reserve(worker_count);
+        workers.reserve(worker_count);
+
+        auto stop_workers = [&]() {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stopping = true;
+            }
+            work_available.notify_all();
+            for (auto & thread : workers)
+            {
+                thread.join();
+            }
+        };
+
+        try
+        {
+            for (size_t i = 0; i < worker_count; i++)
+            {
+                contexts.push_back(m_context_pool.acquire());
+                workers.emplace_back(worker, std::cref(contexts.back().get()));
+            }
+
+            while (next_to_deliver < result_count)
+            {
+                std::optional<Result> result;
+                {
+                    std::unique_lock<std::mutex> lock{mutex};
+                    auto & slot = slots[next_to_deliver % slots.size()];
+                    result_available.wait(lock, [&slot]() {
+                        return slot.has_value();
+                    });
+                    result.swap(slot);
+                    next_to_deliver++;
+                }
+                work_available.notify_all();
+
+                create_device(*result);
+                callback(*result);
+            }
+        }
+        catch (...)
+        {
+            stop_workers();
+            throw;
+        }
+
+        stop_workers();
+    }
+
+    size_t ParallelQuery::get_thread_count() const
+    {
+        return m_thread_count;
+    }
+
+    size_t ParallelQuery::get_queue_capacity() const
+    {
+        return m_queue_capacity;
+    }
+
+    void ParallelQuery::set_load_attributes(bool load_attributes)
+    {
+        m_load_attributes = load_attributes;
+    }
+
+    bool ParallelQuery::get_load_attributes() const
+    {
+        return m_load_attributes;
+    }
+
+    ParallelQuery::Result ParallelQuery::create_result(const context_type & ctx, const string_type & syspath) const
+    {
+        Result result{syspath, {}, {}, {}};
+        try
+        {
+            Device device{ctx, syspath};
+            if (m_load_attributes)
+            {
+                result.attributes = device.load_attributes_from_sysfs();
+            }
+        }
+        catch (...)
+        {
+            result.error = std::current_exception();
+        }
+        return result;
+    }
+
+    void ParallelQuery::create_device(Result & result) const
+    {
+        if (result.error)
+        {
+            return;
+        }
+        try
+        {
+            result.device.emplace(m_context, result.syspath);
+        }
+        catch (...)
+        {
+            result.error = std::current_exception();
+        }
+    }
+
+} // namespace TF::Linux::Udev
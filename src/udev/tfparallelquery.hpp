@@ -0,0 +1,160 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFPARALLELQUERY_HPP
+#define TFPARALLELQUERY_HPP
+
+#include <exception>
+#include <functional>
+#include <optional>
+#include <vector>
+#include "TFFoundation.hpp"
+#include "tfcontextpool.hpp"
+#include "tfudev.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The ParallelQuery class runs a Query and creates the Device objects for the results, and
+     * optionally loads their attributes, on a pool of worker threads.
+     *
+     * Results are always delivered in the order Query::run returns the syspaths, whatever order
+     * the workers finish in.  At most the queue capacity of results are in flight (being worked
+     * on or waiting to be delivered) at any time, so for_each uses a bounded amount of memory
+     * however many devices the query matches.
+     *
+     * Each worker borrows a context of its own from a ContextPool that shares the attribute cache
+     * and string pool of the query's context, creates the device on it to load its attributes,
+     * and destroys that device before taking the next syspath.  The device delivered in a result
+     * is then created again on the calling thread with the context given to the constructor, so
+     * a result belongs to that context like any other device created from it and may outlive
+     * the ParallelQuery, and no udev object is ever used by two threads at once.
+     */
+    class ParallelQuery
+    {
+    public:
+        using context_type = Context;
+        using query_type = Query;
+        using device_type = Device;
+        using string_type = String;
+        using string_map_type = Device::string_map_type;
+
+        /** The outcome of creating one device. */
+        struct Result
+        {
+            /** The syspath returned by the query. */
+            string_type syspath;
+            /** The device on the query's context, empty if it could not be created (for example it was removed). */
+            std::optional<device_type> device;
+            /** The attributes of the device and its parents, if attribute loading is enabled. */
+            string_map_type attributes;
+            /** The exception thrown while creating the device or loading its attributes, if any. */
+            std::exception_ptr error;
+        };
+
+        using result_list_type = std::vector<Result>;
+        using result_callback_type = std::function<void(Result &)>;
+
+        /**
+         * @brief constructor with context, thread count and queue capacity
+         * @param ctx the context whose caches the workers' contexts share.
+         * @param thread_count the number of worker threads, 0 means one per hardware thread.
+         * @param queue_capacity the largest number of results in flight, must be greater than 0.
+         */
+        explicit ParallelQuery(const context_type & ctx, size_t thread_count = 0,
+                               size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+
+        /**
+         * @brief method to run a query and collect every result.
+         * @param query the query, already set up with its matches.
+         * @return the results in query order.
+         */
+        [[nodiscard]] result_list_type run(query_type & query);
+
+        /**
+         * @brief method to run a query and pass each result to a callback as it becomes ready.
+         * @param query the query, already set up with its matches.
+         * @param callback the function called on the calling thread with each result, in query order.
+         *
+         * If @e callback throws, the workers are stopped and the exception is rethrown.
+         */
+        void for_each(query_type & query, const result_callback_type & callback);
+
+        /**
+         * @brief method to get the number of worker threads.
+         * @return the number of worker threads.
+         */
+        [[nodiscard]] size_t get_thread_count() const;
+
+        /**
+         * @brief method to get the queue capacity.
+         * @return the queue capacity.
+         */
+        [[nodiscard]] size_t get_queue_capacity() const;
+
+        /**
+         * @brief method to choose whether the workers load device attributes.
+         * @param load_attributes true to fill Result::attributes with load_attributes_from_sysfs.
+         */
+        void set_load_attributes(bool load_attributes);
+
+        /**
+         * @brief method to check whether the workers load device attributes.
+         * @return true if attributes are loaded and false otherwise.
+         */
+        [[nodiscard]] bool get_load_attributes() const;
+
+        constexpr static size_t DEFAULT_QUEUE_CAPACITY = 256;
+
+    private:
+        /**
+         * @brief helper method to check that a syspath has a device and load its attributes.
+         * @param ctx the context of the worker thread
+         * @param syspath the syspath
+         * @return the result, without a device.
+         */
+        Result create_result(const context_type & ctx, const string_type & syspath) const;
+
+        /**
+         * @brief helper method to create the device of a result on the query's context.
+         * @param result the result
+         */
+        void create_device(Result & result) const;
+
+        size_t m_thread_count;
+        size_t m_queue_capacity;
+        bool m_load_attributes;
+        context_type m_context;
+        ContextPool m_context_pool;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFPARALLELQUERY_HPP
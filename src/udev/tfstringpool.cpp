@@ -0,0 +1,234 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include "tfstringpool.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    StringPool::StringPool() : m_block_used{BLOCK_SIZE}, m_allocated_bytes{0}
+    {
+        m_strings.emplace_back();
+        m_ids.emplace(std::string_view{}, 0);
+    }
+
+    StringPool::id_type StringPool::intern(std::string_view s)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock{m_mutex};
+            auto iterator = m_ids.find(s);
+            if (iterator != m_ids.end())
+            {
+                return iterator->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock{m_mutex};
+        // Another thread may have added the string between the two locks.
+        auto iterator = m_ids.find(s);
+        if (iterator != m_ids.end())
+        {
+            return iterator->second;
+        }
+        if (m_strings.size() > std::numeric_limits<id_type>::max())
+        {
+            throw std::length_error{"string pool is full"};
+        }
+        auto id = static_cast<id_type>(m_strings.size());
+        auto stored = store(s);
+        m_strings.push_back(stored);
+        m_ids.emplace(stored, id);
+        return id;
+    }
+
+    std::vector<StringPool::id_type> StringPool::intern(const std::vector<std::string_view> & strings)
+    {
+        std::vector<id_type> ids(strings.size(), 0);
+        std::vector<size_t> missing{};
+        {
+            std::shared_lock<std::shared_mutex> lock{m_mutex};
+            for (size_t i = 0; i < strings.size(); i++)
+            {
+                auto iterator = m_ids.find(strings[i]);
+                if (iterator != m_ids.end())
+                {
+                    ids[i] = iterator->second;
+                }
+                else
+                {
+                    missing.push_back(i);
+                }
+            }
+        }
+
+        for (auto i : missing)
+        {
+            ids[i] = intern(strings[i]);
+        }
+        return ids;
+    }
+
+    std::optional<StringPool::id_type> StringPool::find(std::string_view s) const
+    {
+        std::shared_lock<std::shared_mutex> lock{m_mutex};
+        auto iterator = m_ids.find(s);
+        if (iterator == m_ids.end())
+        {
+            return {};
+        }
+        return iterator->second;
+    }
+
+    std::string_view StringPool::view(id_type id) const
+    {
+        std::shared_lock<std::shared_mutex> lock{m_mutex};
+        return m_strings.at(id);
+    }
+
+    StringPool::size_type StringPool::size() const
+    {
+        std::shared_lock<std::shared_mutex> lock{m_mutex};
+        return m_strings.size();
+    }
+
+    StringPool::size_type StringPool::get_memory_usage() const
+    {
+        std::shared_lock<std::shared_mutex> lock{m_mutex};
+        // Each hash node holds the key, the id and the next pointer, and is allocated separately.
+        constexpr size_type node_size = sizeof(void *) + sizeof(std::pair<const std::string_view, id_type>);
+        return m_allocated_bytes + m_blocks.capacity() * sizeof(std::unique_ptr<char[]>) +
+               m_strings.capacity() * sizeof(std::string_view) + m_ids.bucket_count() * sizeof(void *) +
+               m_ids.size() * node_size;
+    }
+
+    std::string_view StringPool::store(std::string_view s)
+    {
+        if (s.empty())
+        {
+            return {};
+        }
+        if (s.size() > BLOCK_SIZE / 4)
+        {
+            // Large strings get a block of their own so they do not waste the rest of the current block.
+            m_blocks.push_back(std::make_unique<char[]>(s.size()));
+            m_allocated_bytes += s.size();
+            std::memcpy(m_blocks.back().get(), s.data(), s.size());
+            auto stored = std::string_view{m_blocks.back().get(), s.size()};
+            // Keep the current block last so later strings continue filling it.
+            if (m_blocks.size() > 1 && m_block_used < BLOCK_SIZE)
+            {
+                std::swap(m_blocks[m_blocks.size() - 1], m_blocks[m_blocks.size() - 2]);
+            }
+            return stored;
+        }
+        if (m_block_used + s.size() > BLOCK_SIZE)
+        {
+            m_blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+            m_allocated_bytes += BLOCK_SIZE;
+            m_block_used = 0;
+        }
+        auto destination = m_blocks.back().get() + m_block_used;
+        std::memcpy(destination, s.data(), s.size());
+        m_block_used += s.size();
+        return std::string_view{destination, s.size()};
+    }
+
+    bool CompactPropertyMap::contains(std::string_view name) const
+    {
+        return find(name).has_value();
+    }
+
+    std::optional<std::string_view> CompactPropertyMap::find(std::string_view name) const
+    {
+        if (m_pool == nullptr)
+        {
+            return {};
+        }
+        auto name_id = m_pool->find(name);
+        if (! name_id)
+        {
+            return {};
+        }
+        auto iterator = std::lower_bound(m_entries.begin(), m_entries.end(), *name_id,
+                                         [](const std::pair<id_type, id_type> & entry, id_type id) {
+                                             return entry.first < id;
+                                         });
+        if (iterator == m_entries.end() || iterator->first != *name_id)
+        {
+            return {};
+        }
+        return m_pool->view(iterator->second);
+    }
+
+    CompactPropertyMap::string_map_type CompactPropertyMap::to_map() const
+    {
+        string_map_type map{};
+        map.reserve(m_entries.size());
+        for (auto [name, value] : *this)
+        {
+            map.emplace(String{name.data(), name.length()}, String{value.data(), value.length()});
+        }
+        return map;
+    }
+
+    CompactPropertyMap::size_type CompactPropertyMap::size() const
+    {
+        return m_entries.size();
+    }
+
+    bool CompactPropertyMap::empty() const
+    {
+        return m_entries.empty();
+    }
+
+    CompactPropertyMap::size_type CompactPropertyMap::get_memory_usage() const
+    {
+        return m_entries.capacity() * sizeof(std::pair<id_type, id_type>);
+    }
+
+    CompactPropertyMap::iterator CompactPropertyMap::begin() const
+    {
+        return iterator{m_pool, m_entries.data()};
+    }
+
+    CompactPropertyMap::iterator CompactPropertyMap::end() const
+    {
+        return iterator{m_pool, m_entries.data() + m_entries.size()};
+    }
+
+    void CompactPropertyMap::sort_entries()
+    {
+        std::sort(m_entries.begin(), m_entries.end());
+        m_entries.shrink_to_fit();
+    }
+
+} // namespace TF::Linux::Udev
@@ -0,0 +1,276 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFSTRINGPOOL_HPP
+#define TFSTRINGPOOL_HPP
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "TFFoundation.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The StringPool class stores one copy of each distinct string it is given and identifies
+     * it by a small integer id.
+     *
+     * Property names such as SUBSYSTEM or ID_BUS, and many values, are the same for thousands of
+     * devices, so storing them once and referring to them by id uses far less memory than a
+     * String per entry per device.  Strings are packed into large blocks and are never removed,
+     * so views returned by the pool stay valid for the lifetime of the pool.  Id 0 is always
+     * the empty string.  All methods are safe to call from multiple threads.
+     */
+    class StringPool
+    {
+    public:
+        using id_type = uint32_t;
+        using string_type = String;
+        using size_type = size_t;
+
+        /** @brief default constructor, creates a pool holding only the empty string. */
+        StringPool();
+
+        StringPool(const StringPool &) = delete;
+        StringPool & operator=(const StringPool &) = delete;
+
+        /**
+         * @brief method to add a string to the pool.
+         * @param s the string
+         * @return the id of the string, which is the id of the existing copy if the pool
+         * already holds @e s.
+         */
+        id_type intern(std::string_view s);
+
+        /**
+         * @brief method to add several strings to the pool at once.
+         * @param strings the strings
+         * @return the ids of the strings in the same order.
+         *
+         * Strings the pool already holds are looked up under one shared lock, which is cheaper
+         * than calling intern for each string.
+         */
+        std::vector<id_type> intern(const std::vector<std::string_view> & strings);
+
+        /**
+         * @brief method to look up the id of a string without adding it.
+         * @param s the string
+         * @return the id or an empty optional if the pool does not hold @e s.
+         */
+        [[nodiscard]] std::optional<id_type> find(std::string_view s) const;
+
+        /**
+         * @brief method to get the string for an id.
+         * @param id an id returned by intern or find
+         * @return a view of the string owned by the pool.
+         */
+        [[nodiscard]] std::string_view view(id_type id) const;
+
+        /**
+         * @brief method to get the number of distinct strings in the pool.
+         * @return the number of strings, including the empty string.
+         */
+        [[nodiscard]] size_type size() const;
+
+        /**
+         * @brief method to get the number of bytes the pool has allocated.
+         * @return an estimate of the heap memory used by the strings and the lookup tables.
+         */
+        [[nodiscard]] size_type get_memory_usage() const;
+
+    private:
+        static constexpr size_type BLOCK_SIZE = 4096;
+
+        /**
+         * @brief helper method to copy a string into the blocks.
+         * @param s the string
+         * @return a view of the copy.
+         */
+        std::string_view store(std::string_view s);
+
+        mutable std::shared_mutex m_mutex;
+        std::vector<std::unique_ptr<char[]>> m_blocks;
+        size_type m_block_used;
+        size_type m_allocated_bytes;
+        std::vector<std::string_view> m_strings;
+        std::unordered_map<std::string_view, id_type> m_ids;
+    };
+
+    /**
+     * The CompactPropertyMap class is a read-only map of property names to values stored as
+     * StringPool ids.
+     *
+     * Each entry takes eight bytes, against two String objects and a hash node for an entry of
+     * an std::unordered_map<String, String>.  Entries are sorted by name id, so a lookup is one
+     * pool lookup of the name followed by a binary search.  The map refers to its pool, which
+     * must outlive it.
+     */
+    class CompactPropertyMap
+    {
+    public:
+        using string_type = String;
+        using string_map_type = std::unordered_map<String, String>;
+        using id_type = StringPool::id_type;
+        using value_type = std::pair<std::string_view, std::string_view>;
+        using size_type = size_t;
+
+        /**
+         * The iterator class walks the entries of the map in name id order.
+         */
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = CompactPropertyMap::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            iterator() = default;
+
+            iterator(const StringPool * pool, const std::pair<id_type, id_type> * entry) : m_pool{pool}, m_entry{entry}
+            {}
+
+            reference operator*() const
+            {
+                return value_type{m_pool->view(m_entry->first), m_pool->view(m_entry->second)};
+            }
+
+            iterator & operator++()
+            {
+                ++m_entry;
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto previous = *this;
+                ++m_entry;
+                return previous;
+            }
+
+            bool operator==(const iterator & other) const
+            {
+                return m_entry == other.m_entry;
+            }
+
+        private:
+            const StringPool * m_pool{nullptr};
+            const std::pair<id_type, id_type> * m_entry{nullptr};
+        };
+
+        /** @brief default constructor, creates an empty map. */
+        CompactPropertyMap() = default;
+
+        /**
+         * @brief constructor with a list of name/value pairs
+         * @param pool the pool to intern the names and values in.
+         * @param entries the name/value pairs, for example the range returned by Device::view_properties.
+         */
+        template<typename RANGE>
+        CompactPropertyMap(StringPool & pool, const RANGE & entries) : m_pool{&pool}
+        {
+            std::vector<std::string_view> strings{};
+            for (auto [name, value] : entries)
+            {
+                strings.push_back(name);
+                strings.push_back(value);
+            }
+            auto ids = pool.intern(strings);
+            m_entries.reserve(ids.size() / 2);
+            for (size_type i = 0; i + 1 < ids.size(); i += 2)
+            {
+                m_entries.emplace_back(ids[i], ids[i + 1]);
+            }
+            sort_entries();
+        }
+
+        /**
+         * @brief method to check if the map contains a property.
+         * @param name the property name
+         * @return true if the property exists and false otherwise.
+         */
+        [[nodiscard]] bool contains(std::string_view name) const;
+
+        /**
+         * @brief method to get the value of a property.
+         * @param name the property name
+         * @return a view of the value owned by the pool, or an empty optional if the map does not
+         * contain @e name.
+         */
+        [[nodiscard]] std::optional<std::string_view> find(std::string_view name) const;
+
+        /**
+         * @brief method to copy the map into an std::unordered_map.
+         * @return the map, identical to the result of Device::get_properties.
+         */
+        [[nodiscard]] string_map_type to_map() const;
+
+        /**
+         * @brief method to get the number of properties in the map.
+         * @return the number of properties.
+         */
+        [[nodiscard]] size_type size() const;
+
+        /**
+         * @brief method to check if the map is empty.
+         * @return true if the map has no properties.
+         */
+        [[nodiscard]] bool empty() const;
+
+        /**
+         * @brief method to get the number of bytes the map has allocated.
+         * @return the heap memory used by the entries, not counting the shared pool.
+         */
+        [[nodiscard]] size_type get_memory_usage() const;
+
+        [[nodiscard]] iterator begin() const;
+
+        [[nodiscard]] iterator end() const;
+
+    private:
+        /**
+         * @brief helper method to sort the entries by name id and release unused capacity.
+         */
+        void sort_entries();
+
+        const StringPool * m_pool{nullptr};
+        std::vector<std::pair<id_type, id_type>> m_entries;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFSTRINGPOOL_HPP
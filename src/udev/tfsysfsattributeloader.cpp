@@ -0,0 +1,451 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "tfsysfsattributeloader.hpp"
+#include "tfautofiledescriptor.hpp"
+
+namespace TF::Linux::Udev
+{
+
+    namespace
+    {
+        // The record layout returned by the getdents64 system call.
+        struct linux_dirent64
+        {
+            ino64_t d_ino;
+            off64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[];
+        };
+
+        bool name_matches_patterns(const std::vector<std::string> & patterns, const std::string & name)
+        {
+            return std::any_of(patterns.begin(), patterns.end(), [&name](const std::string & pattern) {
+                return fnmatch(pattern.c_str(), name.c_str(), FNM_PATHNAME) == 0;
+            });
+        }
+
+        // A directory is only worth entering if some pattern has more components than the directory
+        // name and the leading components of that pattern match the directory name.
+        bool patterns_match_below_directory(const std::vector<std::string> & patterns, const std::string & name)
+        {
+            auto depth = std::count(name.begin(), name.end(), '/') + 1;
+            for (auto & pattern : patterns)
+            {
+                std::string::size_type separator{0};
+                for (decltype(depth) i = 0; i < depth && separator != std::string::npos; i++)
+                {
+                    separator = pattern.find('/', i == 0 ? 0 : separator + 1);
+                }
+
+                if (separator == std::string::npos)
+                {
+                    continue;
+                }
+
+                auto pattern_prefix = pattern.substr(0, separator);
+                if (fnmatch(pattern_prefix.c_str(), name.c_str(), FNM_PATHNAME) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    } // namespace
+
+    void SysfsAttributeLoader::load(const string_type & path, string_map_type & map)
+    {
+        auto path_cstring_value = path.cStr();
+        AutoFileDescriptor directory{open(path_cstring_value.get(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (*directory < 0)
+        {
+            return;
+        }
+        load_directory(*directory, map, "", false, nullptr);
+    }
+
+    void SysfsAttributeLoader::load_keys(const string_type & path, string_map_type & map, const string_set_type & keys)
+    {
+        auto path_cstring_value = path.cStr();
+        AutoFileDescriptor directory{open(path_cstring_value.get(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (*directory < 0)
+        {
+            return;
+        }
+
+        for (auto & key : keys)
+        {
+            if (map.contains(key))
+            {
+                continue;
+            }
+
+            auto key_value = key.stlString();
+            auto attribute_value = read_relative(*directory, key_value);
+            if (attribute_value)
+            {
+                map.insert(std::make_pair(key, std::move(*attribute_value)));
+            }
+        }
+    }
+
+    void SysfsAttributeLoader::load_matching(const string_type & path, string_map_type & map,
+                                             const string_list_type & patterns)
+    {
+        std::vector<std::string> pattern_values;
+        pattern_values.reserve(patterns.size());
+        for (auto & pattern : patterns)
+        {
+            pattern_values.emplace_back(pattern.stlString());
+        }
+
+        auto path_cstring_value = path.cStr();
+        AutoFileDescriptor directory{open(path_cstring_value.get(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (*directory < 0)
+        {
+            return;
+        }
+        load_directory(*directory, map, "", false, &pattern_values);
+    }
+
+    std::optional<SysfsAttributeLoader::string_type> SysfsAttributeLoader::read(const string_type & path,
+                                                                                const string_type & key)
+    {
+        auto path_cstring_value = path.cStr();
+        AutoFileDescriptor directory{open(path_cstring_value.get(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+        if (*directory < 0)
+        {
+            return {};
+        }
+
+        auto key_value = key.stlString();
+        return read_relative(*directory, key_value);
+    }
+
+    void SysfsAttributeLoader::load_directory(int directory_fd, string_map_type & map, const std::string & prefix,
+                                              bool is_sub_dir, const std::vector<std::string> * patterns)
+    {
+        entry_list_type entries;
+        if (! read_directory_entries(directory_fd, entries))
+        {
+            return;
+        }
+
+        // If we have recursed into a sub-directory and that directory contains an uevent file,
+        // then that directory is a child device.  Skip over it.
+        if (is_sub_dir)
+        {
+            for (auto & entry : entries)
+            {
+                if (entry.name == "uevent")
+                {
+                    return;
+                }
+            }
+        }
+
+        std::string attribute_name;
+        for (auto & entry : entries)
+        {
+            // Symbolic links and other special files are never attributes, and the directory entry
+            // already tells us that without a stat call.
+            if (! (entry.type == DT_REG || entry.type == DT_DIR || entry.type == DT_UNKNOWN))
+            {
+                continue;
+            }
+
+            attribute_name.assign(prefix);
+            if (! prefix.empty())
+            {
+                attribute_name.push_back('/');
+            }
+            attribute_name.append(entry.name);
+
+            // When filtering, skip entries the filter rules out before paying for a stat call.
+            if (patterns != nullptr)
+            {
+                if (entry.type == DT_REG && ! name_matches_patterns(*patterns, attribute_name))
+                {
+                    continue;
+                }
+
+                if (entry.type == DT_DIR && ! patterns_match_below_directory(*patterns, attribute_name))
+                {
+                    continue;
+                }
+            }
+
+            struct stat item_stat
+            {};
+            if (fstatat(directory_fd, entry.name.c_str(), &item_stat, AT_SYMLINK_NOFOLLOW) < 0)
+            {
+                continue;
+            }
+
+            if (! (S_ISREG(item_stat.st_mode) || S_ISDIR(item_stat.st_mode)))
+            {
+                continue;
+            }
+
+            // If the item has the wrong permissions, then skip over it.
+            if ((item_stat.st_mode & (S_IRUSR | S_IWUSR)) == 0)
+            {
+                continue;
+            }
+
+            string_type attribute_key{attribute_name.c_str(), attribute_name.length()};
+            if (map.contains(attribute_key))
+            {
+                continue;
+            }
+
+            if (S_ISDIR(item_stat.st_mode))
+            {
+                if (patterns != nullptr && ! patterns_match_below_directory(*patterns, attribute_name))
+                {
+                    continue;
+                }
+
+                AutoFileDescriptor sub_directory{
+                    openat(directory_fd, entry.name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW)};
+                if (*sub_directory >= 0)
+                {
+                    load_directory(*sub_directory, map, attribute_name, true, patterns);
+                }
+                continue;
+            }
+
+            if (patterns != nullptr && ! name_matches_patterns(*patterns, attribute_name))
+            {
+                continue;
+            }
+
+            auto attribute_value = convert_read_buffer(read_attribute(directory_fd, entry.name.c_str()));
+            if (attribute_value)
+            {
+                map.insert(std::make_pair(std::move(attribute_key), std::move(*attribute_value)));
+            }
+        }
+    }
+
+    std::optional<SysfsAttributeLoader::string_type> SysfsAttributeLoader::read_relative(int directory_fd,
+                                                                                         std::string_view key)
+    {
+        auto separator = key.find('/');
+        std::string component{key.substr(0, separator)};
+        if (component.empty() || component == "." || component == "..")
+        {
+            return {};
+        }
+
+        struct stat item_stat
+        {};
+        if (fstatat(directory_fd, component.c_str(), &item_stat, AT_SYMLINK_NOFOLLOW) < 0)
+        {
+            return {};
+        }
+
+        if ((item_stat.st_mode & (S_IRUSR | S_IWUSR)) == 0)
+        {
+            return {};
+        }
+
+        if (separator == std::string_view::npos)
+        {
+            if (! S_ISREG(item_stat.st_mode))
+            {
+                return {};
+            }
+            return convert_read_buffer(read_attribute(directory_fd, component.c_str()));
+        }
+
+        if (! S_ISDIR(item_stat.st_mode))
+        {
+            return {};
+        }
+
+        AutoFileDescriptor sub_directory{
+            openat(directory_fd, component.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW)};
+        if (*sub_directory < 0)
+        {
+            return {};
+        }
+
+        // A sub-directory with an uevent file is a child device, not part of this device's attributes.
+        if (faccessat(*sub_directory, "uevent", F_OK, AT_SYMLINK_NOFOLLOW) == 0)
+        {
+            return {};
+        }
+
+        return read_relative(*sub_directory, key.substr(separator + 1));
+    }
+
+    bool SysfsAttributeLoader::read_directory_entries(int directory_fd, entry_list_type & entries)
+    {
+        if (m_directory_buffer.empty())
+        {
+            m_directory_buffer.resize(DIRECTORY_BUFFER_SIZE);
+        }
+
+        while (true)
+        {
+            auto bytes_read = syscall(SYS_getdents64, directory_fd, m_directory_buffer.data(), m_directory_buffer.size());
+            if (bytes_read < 0)
+            {
+                return false;
+            }
+
+            if (bytes_read == 0)
+            {
+                break;
+            }
+
+            long offset = 0;
+            while (offset < bytes_read)
+            {
+                auto record = reinterpret_cast<linux_dirent64 *>(m_directory_buffer.data() + offset);
+                offset += record->d_reclen;
+
+                if (std::strcmp(record->d_name, ".") == 0 || std::strcmp(record->d_name, "..") == 0)
+                {
+                    continue;
+                }
+
+                entries.push_back(DirectoryEntry{record->d_name, record->d_type});
+            }
+        }
+        return true;
+    }
+
+    ssize_t SysfsAttributeLoader::read_attribute(int directory_fd, const char * name)
+    {
+        AutoFileDescriptor file{openat(directory_fd, name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)};
+        if (*file < 0)
+        {
+            return -1;
+        }
+
+        if (m_read_buffer.empty())
+        {
+            m_read_buffer.resize(INITIAL_READ_BUFFER_SIZE);
+        }
+
+        size_t total_read = 0;
+        while (true)
+        {
+            if (total_read == m_read_buffer.size())
+            {
+                m_read_buffer.resize(m_read_buffer.size() * 2);
+            }
+
+            auto bytes_read = ::read(*file, m_read_buffer.data() + total_read, m_read_buffer.size() - total_read);
+            if (bytes_read < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                return -1;
+            }
+
+            if (bytes_read == 0)
+            {
+                break;
+            }
+            total_read += static_cast<size_t>(bytes_read);
+        }
+        return static_cast<ssize_t>(total_read);
+    }
+
+    std::optional<SysfsAttributeLoader::string_type> SysfsAttributeLoader::convert_read_buffer(ssize_t length) const
+    {
+        if (length <= 0)
+        {
+            return {};
+        }
+
+        // The buffer holds the file contents, but these are not just arbitrary bytes, they are
+        // string contents.  Remove any trailing newline character before converting.
+        auto length_to_insert = static_cast<size_t>(length);
+        if (m_read_buffer[length_to_insert - 1] == '\n')
+        {
+            length_to_insert--;
+        }
+
+        try
+        {
+            return string_type{m_read_buffer.data(), length_to_insert};
+        }
+        catch (std::runtime_error & e)
+        {
+            return {};
+        }
+    }
+
+    LazyAttributeMap::LazyAttributeMap(string_list_type && paths) : m_paths{std::move(paths)} {}
+
+    const LazyAttributeMap::string_type * LazyAttributeMap::get(const string_type & key)
+    {
+        auto iterator = m_values.find(key);
+        if (iterator == m_values.end())
+        {
+            std::optional<string_type> attribute_value;
+            for (auto & path : m_paths)
+            {
+                attribute_value = m_loader.read(path, key);
+                if (attribute_value)
+                {
+                    break;
+                }
+            }
+            iterator = m_values.emplace(key, std::move(attribute_value)).first;
+        }
+
+        return iterator->second ? &iterator->second.value() : nullptr;
+    }
+
+    bool LazyAttributeMap::contains(const string_type & key)
+    {
+        return get(key) != nullptr;
+    }
+
+    size_t LazyAttributeMap::loaded_count() const
+    {
+        return m_values.size();
+    }
+
+} // namespace TF::Linux::Udev
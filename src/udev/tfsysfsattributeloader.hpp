@@ -0,0 +1,228 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#ifndef TFSYSFSATTRIBUTELOADER_HPP
+#define TFSYSFSATTRIBUTELOADER_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <sys/types.h>
+#include "TFFoundation.hpp"
+
+using namespace TF::Foundation;
+
+namespace TF::Linux::Udev
+{
+
+    /**
+     * The SysfsAttributeLoader class reads the attribute files of a device directory in /sys
+     * into a key/value map.
+     *
+     * The loader works relative to open directory descriptors (openat/fstatat/getdents64) so that
+     * full path strings are never rebuilt for each attribute, uses the directory entry type to
+     * skip symbolic links without a stat call, and reads every attribute through one reusable
+     * buffer.  A single loader object can be used for many devices, but it is not safe to use
+     * the same loader from more than one thread at a time.
+     */
+    class SysfsAttributeLoader
+    {
+    public:
+        using string_type = String;
+        using string_list_type = std::vector<String>;
+        using string_set_type = std::unordered_set<String>;
+        using string_map_type = std::unordered_map<String, String>;
+
+        /** @brief default constructor */
+        SysfsAttributeLoader() = default;
+
+        /**
+         * @brief method to load the attributes found in a device directory into a map.
+         * @param path the path of the device directory in /sys
+         * @param map the map to store the results
+         *
+         * Attributes already present in @e map are not replaced.  Sub-directories are walked
+         * recursively and their attributes are named dir/name, but sub-directories that are
+         * themselves devices (those containing an uevent file) are skipped.  Attribute files
+         * that cannot be opened or read are skipped as well.
+         */
+        void load(const string_type & path, string_map_type & map);
+
+        /**
+         * @brief method to load only the named attributes of a device directory into a map.
+         * @param path the path of the device directory in /sys
+         * @param map the map to store the results
+         * @param keys the attribute names, for example "size" or "queue/physical_block_size".
+         *
+         * Only the files named by @e keys are opened; the directory itself is not listed.  Keys
+         * already present in @e map are not read again, so the same map can be passed for a
+         * device and then for each of its parents.
+         */
+        void load_keys(const string_type & path, string_map_type & map, const string_set_type & keys);
+
+        /**
+         * @brief method to load the attributes of a device directory whose names match a glob pattern.
+         * @param path the path of the device directory in /sys
+         * @param map the map to store the results
+         * @param patterns the fnmatch(3) patterns.  '*' does not match the '/' separating the
+         * components of a sub-directory attribute name, so "queue/rot*" matches "queue/rotational"
+         * but "*" does not.
+         *
+         * Sub-directories are only entered when some pattern can match names inside them, and
+         * only the files whose names match are opened.
+         */
+        void load_matching(const string_type & path, string_map_type & map, const string_list_type & patterns);
+
+        /**
+         * @brief method to read a single attribute of a device directory.
+         * @param path the path of the device directory in /sys
+         * @param key the attribute name
+         * @return the attribute value, or an empty optional if the attribute does not exist,
+         * cannot be read, or is empty.
+         */
+        std::optional<string_type> read(const string_type & path, const string_type & key);
+
+    private:
+        /** The name and type (DT_* value) of an item in a directory. */
+        struct DirectoryEntry
+        {
+            std::string name;
+            unsigned char type;
+        };
+
+        using entry_list_type = std::vector<DirectoryEntry>;
+
+        /**
+         * @brief helper method to load the attributes in an open directory.
+         * @param directory_fd the open directory
+         * @param map the map to store the results
+         * @param prefix the prefix of the attribute names (used for the recursive descent of attribute trees)
+         * @param is_sub_dir true if the directory is a sub-directory of the device directory.
+         * @param patterns if not nullptr, only attributes matching one of the patterns are loaded.
+         */
+        void load_directory(int directory_fd, string_map_type & map, const std::string & prefix, bool is_sub_dir,
+                            const std::vector<std::string> * patterns);
+
+        /**
+         * @brief helper method to read an attribute relative to an open directory.
+         * @param directory_fd the open directory
+         * @param key the attribute name relative to the directory
+         * @return the attribute value or an empty optional.
+         *
+         * Each component of @e key is checked the same way the directory walk in load_directory
+         * checks it, so this method finds exactly the attributes that load would find.
+         */
+        std::optional<string_type> read_relative(int directory_fd, std::string_view key);
+
+        /**
+         * @brief helper method to read the entries of an open directory.
+         * @param directory_fd the open directory
+         * @param entries the list to store the entries, '.' and '..' are not included.
+         * @return true if the directory could be read and false otherwise.
+         */
+        bool read_directory_entries(int directory_fd, entry_list_type & entries);
+
+        /**
+         * @brief helper method to read the contents of an attribute file into the read buffer.
+         * @param directory_fd the directory containing the file
+         * @param name the name of the file
+         * @return the number of bytes read or -1 if the file could not be opened or read.
+         */
+        ssize_t read_attribute(int directory_fd, const char * name);
+
+        /**
+         * @brief helper method to convert the start of the read buffer to an attribute value.
+         * @param length the number of bytes in the buffer
+         * @return the value without any trailing newline, or an empty optional if the buffer is
+         * empty or does not hold valid string contents.
+         */
+        std::optional<string_type> convert_read_buffer(ssize_t length) const;
+
+        std::vector<char> m_directory_buffer;
+        std::vector<char> m_read_buffer;
+
+        constexpr static size_t DIRECTORY_BUFFER_SIZE = 32768;
+        constexpr static size_t INITIAL_READ_BUFFER_SIZE = 4096;
+    };
+
+    /**
+     * The LazyAttributeMap class gives access to the attributes of a device and its parents,
+     * reading each attribute file from /sys the first time the attribute is requested.
+     *
+     * Values, including the fact that an attribute does not exist, are remembered, so each
+     * attribute file is read at most once for the lifetime of the map.  Like the maps returned by
+     * Device::load_attributes_from_device_path, an attribute of the device takes precedence
+     * over an attribute of the same name in a parent.  A LazyAttributeMap object is not safe to
+     * use from more than one thread at a time.
+     */
+    class LazyAttributeMap
+    {
+    public:
+        using string_type = String;
+        using string_list_type = std::vector<String>;
+
+        /** @brief default constructor */
+        LazyAttributeMap() = default;
+
+        /**
+         * @brief constructor with a list of device directories
+         * @param paths the device directories, the device first followed by its parents.
+         */
+        explicit LazyAttributeMap(string_list_type && paths);
+
+        /**
+         * @brief method to get the value of an attribute, reading it if necessary.
+         * @param key the attribute name
+         * @return a pointer to the value owned by the map, or nullptr if the attribute does not exist.
+         */
+        const string_type * get(const string_type & key);
+
+        /**
+         * @brief method to check if an attribute exists, reading it if necessary.
+         * @param key the attribute name
+         * @return true if the attribute exists and false otherwise.
+         */
+        bool contains(const string_type & key);
+
+        /**
+         * @brief method to get the number of attributes read so far.
+         * @return the number of attribute names looked up, including those that did not exist.
+         */
+        [[nodiscard]] size_t loaded_count() const;
+
+    private:
+        string_list_type m_paths;
+        std::unordered_map<String, std::optional<String>> m_values;
+        SysfsAttributeLoader m_loader;
+    };
+
+} // namespace TF::Linux::Udev
+
+#endif // TFSYSFSATTRIBUTELOADER_HPP
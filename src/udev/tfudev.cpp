@@ -25,8 +25,19 @@ SOFTWARE.
 
 ******************************************************************************/
 
+#include <system_error>
+#include <algorithm>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <linux/sock_diag.h>
+#include <unistd.h>
 #include "tfconfigure.hpp"
 #include "tfudev.hpp"
+#include "tfautofiledescriptor.hpp"
+#include "tfmonitorepolladaptor.hpp"
+#include "tfsysfsattributeloader.hpp"
 #include "tfexceptions.hpp"
 
 using namespace TF::Linux;
@@ -34,7 +45,9 @@ using namespace TF::Linux;
 namespace TF::Linux::Udev
 {
 
-    Context::Context() : m_context{nullptr}
+    Context::Context() :
+        m_context{nullptr}, m_attribute_cache{std::make_shared<AttributeCache>()},
+        m_string_pool{std::make_shared<StringPool>()}
     {
         m_context = udev_new();
         if (m_context == nullptr)
@@ -43,11 +56,33 @@ namespace TF::Linux::Udev
         }
     }
 
+    Context::Context(const Context & ctx) :
+        m_context{udev_ref(ctx.m_context)}, m_attribute_cache{ctx.m_attribute_cache}, m_string_pool{ctx.m_string_pool}
+    {}
+
+    Context::Context(struct udev * context, std::shared_ptr<AttributeCache> attribute_cache,
+                     std::shared_ptr<StringPool> string_pool) :
+        m_context{context}, m_attribute_cache{std::move(attribute_cache)}, m_string_pool{std::move(string_pool)}
+    {}
+
     Context::~Context()
     {
         udev_unref(m_context);
     }
 
+    Context & Context::operator=(const Context & ctx)
+    {
+        if (this != &ctx)
+        {
+            udev_ref(ctx.m_context);
+            udev_unref(m_context);
+            m_context = ctx.m_context;
+            m_attribute_cache = ctx.m_attribute_cache;
+            m_string_pool = ctx.m_string_pool;
+        }
+        return *this;
+    }
+
     void Context::retain()
     {
         udev_ref(m_context);
@@ -58,6 +93,16 @@ namespace TF::Linux::Udev
         udev_unref(m_context);
     }
 
+    AttributeCache & Context::get_attribute_cache() const
+    {
+        return *m_attribute_cache;
+    }
+
+    StringPool & Context::get_string_pool() const
+    {
+        return *m_string_pool;
+    }
+
     Device::Device(Device & d) : m_device{}
     {
         d.retain();
@@ -140,6 +185,7 @@ namespace TF::Linux::Udev
             return *this;
         }
 
+        release();
         m_device = d.m_device;
         d.m_device = nullptr;
         return *this;
@@ -157,23 +203,23 @@ namespace TF::Linux::Udev
 
     Device::string_map_type Device::get_devlinks() const
     {
-        return get_values(udev_device_get_devlinks_list_entry);
+        return get_values<udev_device_get_devlinks_list_entry>();
     }
 
     Device::string_map_type Device::get_properties() const
     {
-        return get_values(udev_device_get_properties_list_entry);
+        return get_values<udev_device_get_properties_list_entry>();
     }
 
     Device::string_map_type Device::get_tags() const
     {
-        return get_values(udev_device_get_tags_list_entry);
+        return get_values<udev_device_get_tags_list_entry>();
     }
 
     Device::string_map_type Device::get_current_tags() const
     {
 #if defined(HAVE_UDEV_DEVICE_GET_CURRENT_TAGS_LIST_ENTRY)
-        return get_values(udev_device_get_current_tags_list_entry);
+        return get_values<udev_device_get_current_tags_list_entry>();
 #else
         return {};
 #endif
@@ -181,7 +227,7 @@ namespace TF::Linux::Udev
 
     Device::string_map_type Device::get_system_attributes() const
     {
-        return get_values(udev_device_get_sysattr_list_entry);
+        return get_values<udev_device_get_sysattr_list_entry>();
     }
 
     Device::string_type Device::get_property_value_for_key(const string_type & key)
@@ -191,7 +237,7 @@ namespace TF::Linux::Udev
         {
             throw std::invalid_argument{"key argument not valid"};
         }
-        return get_value(udev_device_get_property_value, key_cstring_value.get());
+        return get_value<udev_device_get_property_value>(key_cstring_value.get());
     }
 
     Device::string_type Device::get_system_attribute_for_key(const string_type & key)
@@ -201,7 +247,7 @@ namespace TF::Linux::Udev
         {
             throw std::invalid_argument{"key argument not valid"};
         }
-        return get_value(udev_device_get_sysattr_value, key_cstring_value.get());
+        return get_value<udev_device_get_sysattr_value>(key_cstring_value.get());
     }
 
     void Device::set_system_attribute_value(const string_type & key, const string_type & value)
@@ -229,47 +275,47 @@ namespace TF::Linux::Udev
 
     Device::string_type Device::get_syspath() const
     {
-        return get_property(udev_device_get_syspath);
+        return get_property<udev_device_get_syspath>();
     }
 
     Device::string_type Device::get_sysname() const
     {
-        return get_property(udev_device_get_sysname);
+        return get_property<udev_device_get_sysname>();
     }
 
     Device::string_type Device::get_sysnum() const
     {
-        return get_property(udev_device_get_sysnum);
+        return get_property<udev_device_get_sysnum>();
     }
 
     Device::string_type Device::get_devpath() const
     {
-        return get_property(udev_device_get_devpath);
+        return get_property<udev_device_get_devpath>();
     }
 
     Device::string_type Device::get_devnode() const
     {
-        return get_property(udev_device_get_devnode);
+        return get_property<udev_device_get_devnode>();
     }
 
     Device::string_type Device::get_devtype() const
     {
-        return get_property(udev_device_get_devtype);
+        return get_property<udev_device_get_devtype>();
     }
 
     Device::string_type Device::get_subsystem() const
     {
-        return get_property(udev_device_get_subsystem);
+        return get_property<udev_device_get_subsystem>();
     }
 
     Device::string_type Device::get_driver() const
     {
-        return get_property(udev_device_get_driver);
+        return get_property<udev_device_get_driver>();
     }
 
     Device::string_type Device::get_action() const
     {
-        return get_property(udev_device_get_action);
+        return get_property<udev_device_get_action>();
     }
 
     dev_t Device::get_devnum() const
@@ -277,6 +323,108 @@ namespace TF::Linux::Udev
         return udev_device_get_devnum(m_device);
     }
 
+    uint64_t Device::make_devnum_key(char type, dev_t devnum)
+    {
+        return (static_cast<uint64_t>(devnum) << 1) | (type == 'b' ? uint64_t{1} : uint64_t{0});
+    }
+
+    ListEntryView Device::view_devlinks() const
+    {
+        return ListEntryView{udev_device_get_devlinks_list_entry(m_device)};
+    }
+
+    ListEntryView Device::view_properties() const
+    {
+        return ListEntryView{udev_device_get_properties_list_entry(m_device)};
+    }
+
+    CompactPropertyMap Device::get_compact_properties(StringPool & pool) const
+    {
+        return CompactPropertyMap{pool, view_properties()};
+    }
+
+    ListEntryView Device::view_tags() const
+    {
+        return ListEntryView{udev_device_get_tags_list_entry(m_device)};
+    }
+
+    ListEntryView Device::view_current_tags() const
+    {
+#if defined(HAVE_UDEV_DEVICE_GET_CURRENT_TAGS_LIST_ENTRY)
+        return ListEntryView{udev_device_get_current_tags_list_entry(m_device)};
+#else
+        return ListEntryView{nullptr};
+#endif
+    }
+
+    ListEntryView Device::view_system_attributes() const
+    {
+        return ListEntryView{udev_device_get_sysattr_list_entry(m_device)};
+    }
+
+    std::string_view Device::get_property_value_view(const char * key) const
+    {
+        if (key == nullptr)
+        {
+            throw std::invalid_argument{"key argument not valid"};
+        }
+        return ListEntryView::to_view(udev_device_get_property_value(m_device, key));
+    }
+
+    std::string_view Device::get_system_attribute_view(const char * key) const
+    {
+        if (key == nullptr)
+        {
+            throw std::invalid_argument{"key argument not valid"};
+        }
+        return ListEntryView::to_view(udev_device_get_sysattr_value(m_device, key));
+    }
+
+    std::string_view Device::get_syspath_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_syspath(m_device));
+    }
+
+    std::string_view Device::get_sysname_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_sysname(m_device));
+    }
+
+    std::string_view Device::get_sysnum_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_sysnum(m_device));
+    }
+
+    std::string_view Device::get_devpath_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_devpath(m_device));
+    }
+
+    std::string_view Device::get_devnode_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_devnode(m_device));
+    }
+
+    std::string_view Device::get_devtype_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_devtype(m_device));
+    }
+
+    std::string_view Device::get_subsystem_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_subsystem(m_device));
+    }
+
+    std::string_view Device::get_driver_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_driver(m_device));
+    }
+
+    std::string_view Device::get_action_view() const
+    {
+        return ListEntryView::to_view(udev_device_get_action(m_device));
+    }
+
     std::optional<Device> Device::get_parent()
     {
         auto parent_device = udev_device_get_parent(m_device);
@@ -336,14 +484,125 @@ namespace TF::Linux::Udev
         return attribute_map;
     }
 
+    Device::string_map_type Device::load_attributes_from_sysfs() const
+    {
+        string_map_type attribute_map;
+        SysfsAttributeLoader loader;
+
+        // Parent devices returned by udev_device_get_parent are owned by the child, so the walk
+        // up the tree does not need to manage reference counts.
+        for (auto device = m_device; device != nullptr; device = udev_device_get_parent(device))
+        {
+            auto syspath = get_attribute_directory(device);
+            if (syspath == nullptr)
+            {
+                break;
+            }
+
+            // Load each level into its own map and merge it so that the child's attributes take
+            // precedence over the parent's, exactly as load_attributes_from_device_path does.
+            string_map_type level_map;
+            loader.load(syspath, level_map);
+            attribute_map.merge(level_map);
+        }
+        return attribute_map;
+    }
+
+    AttributeMapChain Device::load_attributes_from_sysfs(AttributeCache & cache) const
+    {
+        AttributeMapChain::map_list_type maps;
+        std::optional<SysfsAttributeLoader> loader;
+
+        for (auto device = m_device; device != nullptr; device = udev_device_get_parent(device))
+        {
+            auto syspath_value = get_attribute_directory(device);
+            if (syspath_value == nullptr)
+            {
+                break;
+            }
+
+            string_type syspath{syspath_value};
+            auto generation = cache.get_generation();
+            auto map = cache.get(syspath);
+            if (! map)
+            {
+                // Only pay for the loader buffers when something actually needs reading.
+                if (! loader)
+                {
+                    loader.emplace();
+                }
+                string_map_type level_map;
+                loader->load(syspath, level_map);
+                map = cache.insert(syspath, std::move(level_map), generation);
+            }
+            maps.push_back(std::move(map));
+        }
+        return AttributeMapChain{std::move(maps)};
+    }
+
+    Device::string_map_type Device::load_attributes_for_keys(const string_set_type & keys) const
+    {
+        string_map_type attribute_map;
+        SysfsAttributeLoader loader;
+
+        for (auto device = m_device; device != nullptr && attribute_map.size() < keys.size();
+             device = udev_device_get_parent(device))
+        {
+            auto syspath = get_attribute_directory(device);
+            if (syspath == nullptr)
+            {
+                break;
+            }
+
+            // load_keys skips keys already in the map, so a child's attribute takes precedence
+            // over a parent's attribute with the same name.
+            loader.load_keys(syspath, attribute_map, keys);
+        }
+        return attribute_map;
+    }
+
+    Device::string_map_type Device::load_attributes_matching(const string_list_type & patterns) const
+    {
+        string_map_type attribute_map;
+        SysfsAttributeLoader loader;
+
+        for (auto device = m_device; device != nullptr; device = udev_device_get_parent(device))
+        {
+            auto syspath = get_attribute_directory(device);
+            if (syspath == nullptr)
+            {
+                break;
+            }
+
+            string_map_type level_map;
+            loader.load_matching(syspath, level_map, patterns);
+            attribute_map.merge(level_map);
+        }
+        return attribute_map;
+    }
+
+    LazyAttributeMap Device::get_lazy_attributes() const
+    {
+        LazyAttributeMap::string_list_type paths;
+        for (auto device = m_device; device != nullptr; device = udev_device_get_parent(device))
+        {
+            auto syspath = get_attribute_directory(device);
+            if (syspath == nullptr)
+            {
+                break;
+            }
+            paths.emplace_back(syspath);
+        }
+        return LazyAttributeMap{std::move(paths)};
+    }
+
     std::ostream & Device::description(std::ostream & o) const
     {
         bool needs_comma{false};
 
-        auto data_writer = [&o, &needs_comma](const string_type & text,
-                                              const std::function<string_type(const Device &)> & method,
+        auto data_writer = [&o, &needs_comma](const string_type & text, string_type (Device::*method)() const,
                                               const Device & device) {
-            if (const auto var = method(device); ! var.empty())
+            if (const auto var = (device.*method)(); ! var.empty())
             {
                 if (needs_comma)
                 {
@@ -375,10 +634,11 @@ namespace TF::Linux::Udev
         return o;
     }
 
-    Device::string_map_type Device::get_values(const std::function<udev_list_entry *(udev_device *)> & f) const
+    template<udev_list_entry * (*F)(udev_device *)>
+    Device::string_map_type Device::get_values() const
     {
         string_map_type result_map;
-        auto entries = f(m_device);
+        auto entries = F(m_device);
         if (entries == nullptr)
         {
             return result_map;
@@ -396,12 +656,11 @@ namespace TF::Linux::Udev
         return result_map;
     }
 
-    Device::string_type Device::get_value(const std::function<const char *(udev_device *, const char * Key)> & f,
-                                          const string_type & key)
+    template<const char * (*F)(udev_device *, const char *)>
+    Device::string_type Device::get_value(const char * key) const
     {
         string_type string_result;
-        auto key_cstring_value = key.cStr();
-        auto api_result = f(m_device, key_cstring_value.get());
+        auto api_result = F(m_device, key);
         if (api_result)
         {
             string_result = api_result;
@@ -409,10 +668,11 @@ namespace TF::Linux::Udev
         return string_result;
     }
 
-    Device::string_type Device::get_property(const std::function<const char *(udev_device *)> & f) const
+    template<const char * (*F)(udev_device *)>
+    Device::string_type Device::get_property() const
     {
         string_type string_result;
-        auto api_result = f(m_device);
+        auto api_result = F(m_device);
         if (api_result)
         {
             string_result = api_result;
@@ -510,6 +770,15 @@ namespace TF::Linux::Udev
         }
     }
 
+    const char * Device::get_attribute_directory(udev_device * device)
+    {
+        if (udev_device_get_property_value(device, "DEVPATH") == nullptr)
+        {
+            return nullptr;
+        }
+        return udev_device_get_syspath(device);
+    }
+
     std::ostream & operator<<(std::ostream & o, const Device & d)
     {
         return d.description(o);
@@ -664,7 +933,67 @@ namespace TF::Linux::Udev
         return query_results_list;
     }
 
-    Monitor::Monitor(const context_type & ctx, const string_type & name) : m_monitor{nullptr}
+    Query::DeviceRange Query::devices()
+    {
+        udev_enumerate_scan_devices(m_enumerator);
+        return DeviceRange{udev_enumerate_get_udev(m_enumerator), udev_enumerate_get_list_entry(m_enumerator)};
+    }
+
+    Device Query::make_device(udev_device * device)
+    {
+        return Device{device};
+    }
+
+    Query::DeviceRange::iterator::iterator(udev * context, udev_list_entry * entry) :
+        m_context{context}, m_entry{entry}, m_device{}
+    {
+        create_device();
+    }
+
+    Query::DeviceRange::iterator::reference Query::DeviceRange::iterator::operator*() const
+    {
+        return *m_device;
+    }
+
+    Query::DeviceRange::iterator::pointer Query::DeviceRange::iterator::operator->() const
+    {
+        return &(*m_device);
+    }
+
+    Query::DeviceRange::iterator & Query::DeviceRange::iterator::operator++()
+    {
+        m_entry = udev_list_entry_get_next(m_entry);
+        create_device();
+        return *this;
+    }
+
+    void Query::DeviceRange::iterator::operator++(int)
+    {
+        ++(*this);
+    }
+
+    bool Query::DeviceRange::iterator::operator==(const iterator & i) const
+    {
+        return m_entry == i.m_entry;
+    }
+
+    void Query::DeviceRange::iterator::create_device()
+    {
+        m_device.reset();
+        for (; m_entry != nullptr; m_entry = udev_list_entry_get_next(m_entry))
+        {
+            auto device = udev_device_new_from_syspath(m_context, udev_list_entry_get_name(m_entry));
+            if (device != nullptr)
+            {
+                m_device.emplace(make_device(device));
+                return;
+            }
+        }
+    }
+
+    Monitor::Monitor(const context_type & ctx, const string_type & name) :
+        m_monitor{nullptr}, m_filtered_message_count{0}, m_attribute_cache{ctx.m_attribute_cache},
+        m_string_pool{ctx.m_string_pool}, m_stop_fd{-1}, m_has_matches{false}, m_timing_enabled{false}
     {
         auto name_cstring_contents = name.cStr();
         m_monitor = udev_monitor_new_from_netlink(ctx.m_context, name_cstring_contents.get());
@@ -672,11 +1001,20 @@ namespace TF::Linux::Udev
         {
             throw system_no_code_error{"new monitor from netlink failed"};
         }
+
+        m_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_stop_fd < 0)
+        {
+            auto error = errno;
+            udev_monitor_unref(m_monitor);
+            throw std::system_error{error, std::system_category(), "eventfd failed"};
+        }
     }
 
     Monitor::~Monitor()
     {
         udev_monitor_unref(m_monitor);
+        close(m_stop_fd);
     }
 
     void Monitor::match_subsystem_and_devtype(const string_type & subsystem, const string_type & devtype)
@@ -689,6 +1027,8 @@ namespace TF::Linux::Udev
         {
             throw system_no_code_error{"add match subsystem and devtype failed"};
         }
+        m_match_subsystems.emplace_back(subsystem);
+        m_has_matches = true;
     }
 
     void Monitor::match_subsystem(const string_type & subsystem)
@@ -700,6 +1040,8 @@ namespace TF::Linux::Udev
         {
             throw system_no_code_error{"add match subsystem and devtype failed (no devtype)"};
         }
+        m_match_subsystems.emplace_back(subsystem);
+        m_has_matches = true;
     }
 
     void Monitor::match_tag(const string_type & tag)
@@ -710,6 +1052,33 @@ namespace TF::Linux::Udev
         {
             throw system_no_code_error{"add match tag failed"};
         }
+        m_match_tags.emplace_back(tag);
+        m_has_matches = true;
+    }
+
+    void Monitor::set_filter(const MonitorFilter & filter)
+    {
+        m_filter = filter;
+        attach_filter();
+    }
+
+    void Monitor::remove_filter()
+    {
+        m_filter.reset();
+
+        // The kernel checks the option length even though SO_DETACH_FILTER takes no value.
+        int unused_value{0};
+        auto result =
+            setsockopt(get_file_descriptor(), SOL_SOCKET, SO_DETACH_FILTER, &unused_value, sizeof(unused_value));
+        if (result < 0 && errno != ENOENT)
+        {
+            throw std::system_error{errno, std::system_category(), "detach socket filter failed"};
+        }
+    }
+
+    size_t Monitor::get_filtered_message_count() const
+    {
+        return m_filtered_message_count;
     }
 
     int Monitor::get_file_descriptor() const
@@ -719,9 +1088,7 @@ namespace TF::Linux::Udev
 
     Monitor::context_type Monitor::get_context() const
     {
-        Context ctx;
-        ctx.m_context = udev_monitor_get_udev(m_monitor);
-        return ctx;
+        return Context{udev_ref(udev_monitor_get_udev(m_monitor)), m_attribute_cache, m_string_pool};
     }
 
     void Monitor::set_receive_buffer_size(int size)
@@ -740,19 +1107,362 @@ namespace TF::Linux::Udev
         {
             throw system_no_code_error{"enable receiving failed"};
         }
+
+        // Enabling receiving updates libudev's own socket filter, so attach ours again.
+        if (m_filter)
+        {
+            attach_filter();
+        }
     }
 
     Monitor::device_type Monitor::get_device()
     {
         device_type dev;
-        dev.m_device = udev_monitor_receive_device(m_monitor);
+        dev.m_device = receive_device();
         if (dev.m_device == nullptr)
         {
             throw system_no_code_error{"receive device failed"};
         }
+
+        device_received(dev.m_device);
         return dev;
     }
 
+    std::optional<Monitor::device_type> Monitor::try_get_device()
+    {
+        // libudev creates the monitor socket non-blocking, so this returns nullptr straight away
+        // when nothing is queued.
+        auto device = receive_device();
+        if (device == nullptr)
+        {
+            return {};
+        }
+
+        device_received(device);
+        return std::optional<device_type>{device_type{device}};
+    }
+
+    Monitor::device_list_type Monitor::drain_devices(size_t max_devices)
+    {
+        device_list_type devices;
+        while (max_devices == 0 || devices.size() < max_devices)
+        {
+            auto device = receive_device();
+            if (device == nullptr)
+            {
+                break;
+            }
+
+            device_received(device);
+            devices.emplace_back(device_type{device});
+        }
+        return devices;
+    }
+
+    void Monitor::run(const batch_callback_type & callback, size_t batch_size)
+    {
+        constexpr uint32_t monitor_event_id = 0;
+        constexpr uint32_t stop_event_id = 1;
+
+        AutoFileDescriptor epoll_fd{epoll_create1(EPOLL_CLOEXEC)};
+        if (*epoll_fd < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_create1 failed"};
+        }
+
+        MonitorEpollAdaptor adaptor{*this, batch_size};
+        epoll_data_t monitor_data{};
+        monitor_data.u32 = monitor_event_id;
+        adaptor.add_to_epoll(*epoll_fd, monitor_data);
+
+        epoll_event stop_event{};
+        stop_event.events = EPOLLIN;
+        stop_event.data.u32 = stop_event_id;
+        if (epoll_ctl(*epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &stop_event) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "epoll_ctl failed"};
+        }
+
+        bool keep_monitoring{true};
+        while (keep_monitoring)
+        {
+            // With an edge-triggered registration, epoll does not report the monitor again while
+            // events remain queued from an earlier batch, so only poll when there is a backlog.
+            epoll_event events[2];
+            auto event_count = epoll_wait(*epoll_fd, events, 2, adaptor.has_pending() ? 0 : -1);
+            if (event_count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                throw std::system_error{errno, std::system_category(), "epoll_wait failed"};
+            }
+
+            bool monitor_ready = adaptor.has_pending();
+            for (int i = 0; i < event_count; i++)
+            {
+                if (events[i].data.u32 == stop_event_id)
+                {
+                    keep_monitoring = false;
+                }
+                else
+                {
+                    monitor_ready = true;
+                }
+            }
+
+            if (keep_monitoring && monitor_ready)
+            {
+                auto devices = adaptor.handle_ready();
+                if (! devices.empty())
+                {
+                    callback(devices);
+                }
+            }
+        }
+
+        // Clear the stop signal so that the loop can be run again.
+        uint64_t stop_value;
+        (void)!read(m_stop_fd, &stop_value, sizeof(stop_value));
+    }
+
+    void Monitor::stop()
+    {
+        uint64_t stop_value{1};
+        (void)!write(m_stop_fd, &stop_value, sizeof(stop_value));
+    }
+
+    void Monitor::set_timing_enabled(bool enabled)
+    {
+        m_timing_enabled = enabled;
+        m_queued_since.reset();
+    }
+
+    bool Monitor::get_timing_enabled() const
+    {
+        return m_timing_enabled;
+    }
+
+    const Monitor::EventTiming & Monitor::get_last_event_timing() const
+    {
+        return m_last_event_timing;
+    }
+
+    const LatencyHistogram & Monitor::get_latency_histogram() const
+    {
+        return m_latency_histogram;
+    }
+
+    Monitor::Statistics Monitor::get_statistics() const
+    {
+        return m_statistics;
+    }
+
+    void Monitor::reset_statistics()
+    {
+        m_statistics = Statistics{};
+        m_latency_histogram.clear();
+    }
+
+    void Monitor::set_resync_callback(const resync_callback_type & callback)
+    {
+        m_resync_callback = callback;
+    }
+
+    void Monitor::resync()
+    {
+        Query query{get_context()};
+        for (auto & subsystem : m_match_subsystems)
+        {
+            query.match_subsystem(subsystem);
+        }
+        for (auto & tag : m_match_tags)
+        {
+            query.match_tag(tag);
+        }
+
+        auto syspaths = query.run();
+        m_statistics.resyncs++;
+        if (m_resync_callback)
+        {
+            m_resync_callback(syspaths);
+        }
+    }
+
+    void Monitor::device_received(udev_device * device)
+    {
+        if (m_attribute_cache)
+        {
+            auto syspath = udev_device_get_syspath(device);
+            if (syspath != nullptr)
+            {
+                m_attribute_cache->invalidate(syspath);
+            }
+        }
+
+        auto seqnum = static_cast<uint64_t>(udev_device_get_seqnum(device));
+        record_sequence_number(seqnum);
+        m_statistics.received++;
+
+        auto now = clock_type::now();
+        m_last_event_timing.seqnum = seqnum;
+        m_last_event_timing.received = now;
+        m_last_event_timing.queued = now;
+        m_last_event_timing.buffer_bytes = 0;
+        if (m_timing_enabled)
+        {
+            m_last_event_timing.queued = m_queued_since.value_or(now);
+            m_last_event_timing.buffer_bytes = get_buffer_bytes();
+            m_latency_histogram.add(now - m_last_event_timing.queued);
+            m_statistics.max_buffer_bytes = std::max(m_statistics.max_buffer_bytes, m_last_event_timing.buffer_bytes);
+
+            // Once the queue is empty, the next event can only have arrived after this point.
+            if (m_last_event_timing.buffer_bytes == 0)
+            {
+                m_queued_since.reset();
+            }
+        }
+    }
+
+    udev_device * Monitor::receive_device()
+    {
+        if (m_timing_enabled && ! m_queued_since)
+        {
+            m_queued_since = clock_type::now();
+        }
+
+        while (true)
+        {
+            udev_device * device{nullptr};
+            if (! m_filter || discard_filtered_messages())
+            {
+                device = udev_monitor_receive_device(m_monitor);
+            }
+
+            // The kernel reports an overflow once, to the next receive, and the messages that fit
+            // are still queued behind it.
+            if (device == nullptr && errno == ENOBUFS)
+            {
+                buffer_overflowed();
+                continue;
+            }
+
+            if (device == nullptr)
+            {
+                m_queued_since.reset();
+            }
+            return device;
+        }
+    }
+
+    void Monitor::buffer_overflowed()
+    {
+        m_statistics.buffer_overflows++;
+        if (m_attribute_cache)
+        {
+            m_attribute_cache->clear();
+        }
+        if (m_resync_callback)
+        {
+            resync();
+        }
+    }
+
+    void Monitor::record_sequence_number(uint64_t seqnum)
+    {
+        if (seqnum == 0)
+        {
+            return;
+        }
+
+        auto last_seqnum = m_statistics.last_seqnum;
+        if (! m_has_matches && ! m_filter && last_seqnum != 0)
+        {
+            if (seqnum > last_seqnum + 1)
+            {
+                m_statistics.sequence_gaps += seqnum - last_seqnum - 1;
+            }
+            else if (seqnum < last_seqnum && m_statistics.sequence_gaps > 0)
+            {
+                // A late event fills one of the gaps counted earlier.
+                m_statistics.sequence_gaps--;
+            }
+        }
+        m_statistics.last_seqnum = std::max(last_seqnum, seqnum);
+    }
+
+    size_t Monitor::get_buffer_bytes() const
+    {
+        uint32_t memory_info[SK_MEMINFO_VARS]{};
+        socklen_t length = sizeof(memory_info);
+        if (getsockopt(get_file_descriptor(), SOL_SOCKET, SO_MEMINFO, memory_info, &length) < 0 ||
+            length < sizeof(uint32_t) * (SK_MEMINFO_RMEM_ALLOC + 1))
+        {
+            return 0;
+        }
+        return memory_info[SK_MEMINFO_RMEM_ALLOC];
+    }
+
+    bool Monitor::discard_filtered_messages()
+    {
+        if (m_message_buffer.empty())
+        {
+            m_message_buffer.resize(INITIAL_MESSAGE_BUFFER_SIZE);
+        }
+
+        auto fd = get_file_descriptor();
+        while (true)
+        {
+            // Look at the next message without taking it off the socket, so that libudev can
+            // still receive it if it passes.
+            auto length =
+                recv(fd, m_message_buffer.data(), m_message_buffer.size(), MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT);
+            if (length < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                // Looking at the queue takes the overflow error that libudev would have reported.
+                if (errno == ENOBUFS)
+                {
+                    buffer_overflowed();
+                    continue;
+                }
+                // Nothing queued, or an error libudev will report when it receives.
+                return errno != EAGAIN && errno != EWOULDBLOCK;
+            }
+
+            if (static_cast<size_t>(length) > m_message_buffer.size())
+            {
+                m_message_buffer.resize(static_cast<size_t>(length));
+                continue;
+            }
+
+            if (m_filter->matches(std::string_view{m_message_buffer.data(), static_cast<size_t>(length)}))
+            {
+                return true;
+            }
+
+            (void)recv(fd, nullptr, 0, MSG_TRUNC | MSG_DONTWAIT);
+            m_filtered_message_count++;
+        }
+    }
+
+    void Monitor::attach_filter()
+    {
+        auto program = m_filter->compile();
+        sock_fprog program_description{};
+        program_description.len = static_cast<unsigned short>(program.size());
+        program_description.filter = program.data();
+        if (setsockopt(get_file_descriptor(), SOL_SOCKET, SO_ATTACH_FILTER, &program_description,
+                       sizeof(program_description)) < 0)
+        {
+            throw std::system_error{errno, std::system_category(), "attach socket filter failed"};
+        }
+    }
+
     void Monitor::retain()
     {
         udev_monitor_ref(m_monitor);
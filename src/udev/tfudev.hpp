@@ -28,14 +28,26 @@ SOFTWARE.
 #ifndef TFUDEV_HPP
 #define TFUDEV_HPP
 
+#include <cstdint>
 #include <ostream>
+#include <chrono>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
+#include <string_view>
+#include <iterator>
+#include <utility>
 #include <functional>
 #include <optional>
+#include <memory>
 #include <libudev.h>
 #include "TFFoundation.hpp"
+#include "tfattributecache.hpp"
+#include "tflatencyhistogram.hpp"
+#include "tfmonitorfilter.hpp"
+#include "tfstringpool.hpp"
+#include "tfsysfsattributeloader.hpp"
 
 using namespace TF::Foundation;
 
@@ -51,6 +63,16 @@ namespace TF::Linux::Udev
      * Operations on libudev require a struct udev context object.  This Context
      * class wraps the udev object and provides simple memory management for
      * the context.
+     *
+     * Thread safety: libudev objects are not thread-safe and their reference counts are
+     * not atomic.  Every Device, Query and Monitor keeps using the udev object of the context
+     * it was created from, for example to create the parent of a device, so a Context, the
+     * objects created from it and all of their copies must be used by one thread at a time.
+     * They may be handed to another thread together, as long as the thread that used them
+     * stops.  Copies of a context share the same udev object, so a copy is not a way to hand
+     * a context to another thread; use a ContextPool to give each thread a context of its
+     * own.  The attribute cache and string pool are the exception: they are thread-safe and
+     * may be shared freely.  Every class in this library that uses a context follows this rule.
      */
     class Context
     {
@@ -60,11 +82,25 @@ namespace TF::Linux::Udev
          */
         Context();
 
+        /**
+         * @brief copy constructor, the copy shares the udev object, attribute cache and string pool.
+         * @param ctx the other context
+         */
+        Context(const Context & ctx);
+
         /**
          * @brief destructor
          */
         ~Context();
 
+        /**
+         * @brief copy assignment operator, the context shares the other context's udev object,
+         * attribute cache and string pool.
+         * @param ctx the other context
+         * @return this context.
+         */
+        Context & operator=(const Context & ctx);
+
         /**
          * @brief method to increase the reference count of the udev context.
          */
@@ -75,8 +111,38 @@ namespace TF::Linux::Udev
          */
         void release();
 
+        /**
+         * @brief method to get the attribute cache shared by everything using this context.
+         * @return the attribute cache.
+         *
+         * Copies of the context share the same cache.
+         */
+        [[nodiscard]] AttributeCache & get_attribute_cache() const;
+
+        /**
+         * @brief method to get the string pool shared by everything using this context.
+         * @return the string pool.
+         *
+         * Copies of the context share the same pool.
+         */
+        [[nodiscard]] StringPool & get_string_pool() const;
+
     private:
+        /**
+         * @brief constructor with the shared objects of another context
+         * @param context the udev object, the new context takes over one reference.
+         * @param attribute_cache the attribute cache
+         * @param string_pool the string pool
+         */
+        Context(struct udev * context, std::shared_ptr<AttributeCache> attribute_cache,
+                std::shared_ptr<StringPool> string_pool);
+
         struct udev * m_context;
+        std::shared_ptr<AttributeCache> m_attribute_cache;
+        std::shared_ptr<StringPool> m_string_pool;
+
+        // ContextPool creates contexts that share one attribute cache and string pool.
+        friend class ContextPool;
 
         // Query needs access to the udev *.
         friend class Query;
@@ -88,14 +154,136 @@ namespace TF::Linux::Udev
         friend class Monitor;
     };
 
+    /**
+     * The ListEntryView class is a non-owning range over a libudev list of name/value pairs,
+     * such as the properties or tags of a device.
+     *
+     * The names and values are presented as std::string_view objects that point directly at the
+     * strings held by libudev, so iterating a view never allocates.  A view, its iterators and
+     * the string views they return are only valid while the Device that produced them exists.
+     * Entries without a value (for example the entries of the system attribute list) have an
+     * empty value view.
+     */
+    class ListEntryView
+    {
+    public:
+        using value_type = std::pair<std::string_view, std::string_view>;
+
+        /**
+         * The iterator class walks the entries of the list.
+         */
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = ListEntryView::value_type;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            /** @brief default constructor, creates the end iterator. */
+            iterator() = default;
+
+            /**
+             * @brief constructor with a list entry
+             * @param entry the entry, nullptr creates the end iterator.
+             */
+            explicit iterator(udev_list_entry * entry) : m_entry{entry} {}
+
+            value_type operator*() const
+            {
+                return value_type{to_view(udev_list_entry_get_name(m_entry)),
+                                  to_view(udev_list_entry_get_value(m_entry))};
+            }
+
+            iterator & operator++()
+            {
+                m_entry = udev_list_entry_get_next(m_entry);
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto previous = *this;
+                ++(*this);
+                return previous;
+            }
+
+            bool operator==(const iterator & i) const = default;
+
+        private:
+            udev_list_entry * m_entry{nullptr};
+        };
+
+        /**
+         * @brief constructor with the first entry of a list
+         * @param first the first entry, nullptr creates an empty view.
+         */
+        explicit ListEntryView(udev_list_entry * first) : m_first{first} {}
+
+        [[nodiscard]] iterator begin() const
+        {
+            return iterator{m_first};
+        }
+
+        [[nodiscard]] iterator end() const
+        {
+            return iterator{};
+        }
+
+        [[nodiscard]] bool empty() const
+        {
+            return m_first == nullptr;
+        }
+
+        /**
+         * @brief method to find the value of an entry by name.
+         * @param name the name of the entry
+         * @return the value of the entry or an empty optional if the list has no entry for @e name.
+         */
+        [[nodiscard]] std::optional<std::string_view> find(const char * name) const
+        {
+            if (m_first == nullptr || name == nullptr)
+            {
+                return {};
+            }
+
+            auto entry = udev_list_entry_get_by_name(m_first, name);
+            if (entry == nullptr)
+            {
+                return {};
+            }
+            return to_view(udev_list_entry_get_value(entry));
+        }
+
+        /**
+         * @brief helper function to turn a possibly null C string from libudev into a view.
+         * @param s the C string
+         * @return a view of @e s, or an empty view if @e s is nullptr.
+         */
+        static std::string_view to_view(const char * s)
+        {
+            return s != nullptr ? std::string_view{s} : std::string_view{};
+        }
+
+    private:
+        udev_list_entry * m_first;
+    };
+
     /**
      * The Device class encapsulates the udev device functionality.
+     *
+     * Thread safety: libudev caches attribute values, properties and the parent inside the
+     * device object, so even the const methods of a Device change shared state.  A device
+     * belongs to the context it was created from and follows the rule given for Context.
      */
     class Device
     {
     public:
         using context_type = Context;
         using string_type = String;
+        using string_list_type = std::vector<String>;
+        using string_set_type = std::unordered_set<String>;
         using string_map_type = std::unordered_map<String, String>;
 
         /**
@@ -282,6 +470,122 @@ namespace TF::Linux::Udev
          */
         [[nodiscard]] dev_t get_devnum() const;
 
+        /**
+         * @brief function to combine a device type and device number into one value.
+         * @param type 'b' for a block device or 'c' for a character device.
+         * @param devnum the device number
+         * @return a value that is different for every type and number, for use as a hash key.
+         */
+        [[nodiscard]] static uint64_t make_devnum_key(char type, dev_t devnum);
+
+        /**
+         * @brief method to view the links associated with the device without copying them.
+         * @return the view of the links, valid while this device object exists.
+         */
+        [[nodiscard]] ListEntryView view_devlinks() const;
+
+        /**
+         * @brief method to view the properties associated with the device.
+         * @return the view of the properties.
+         */
+        [[nodiscard]] ListEntryView view_properties() const;
+
+        /**
+         * @brief method to get the properties associated with the device as interned ids.
+         * @param pool the pool to intern the names and values in, usually Context::get_string_pool.
+         * @return the property map, which refers to @e pool.
+         *
+         * The map holds the same entries as get_properties in a fraction of the memory, which
+         * matters when the properties of many devices are kept.
+         */
+        [[nodiscard]] CompactPropertyMap get_compact_properties(StringPool & pool) const;
+
+        /**
+         * @brief method to view the tags associated with the device.
+         * @return the view of the tags.
+         */
+        [[nodiscard]] ListEntryView view_tags() const;
+
+        /**
+         * @brief method to view the 'current' tags associated with the device.
+         * @return the view of the 'current' tags.
+         */
+        [[nodiscard]] ListEntryView view_current_tags() const;
+
+        /**
+         * @brief method to view the names of the system attributes of the device.
+         * @return the view of the attribute names, the values are empty.
+         */
+        [[nodiscard]] ListEntryView view_system_attributes() const;
+
+        /**
+         * @brief method to view a property value for a given property key.
+         * @param key the key
+         * @return the value associated with key.
+         */
+        [[nodiscard]] std::string_view get_property_value_view(const char * key) const;
+
+        /**
+         * @brief method to view a system attribute value for a key.
+         * @param key the key
+         * @return the value associated with the key.
+         */
+        [[nodiscard]] std::string_view get_system_attribute_view(const char * key) const;
+
+        /**
+         * @brief method to view the sys path of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_syspath_view() const;
+
+        /**
+         * @brief method to view the system name of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_sysname_view() const;
+
+        /**
+         * @brief method to view the system number of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_sysnum_view() const;
+
+        /**
+         * @brief method to view the device path of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_devpath_view() const;
+
+        /**
+         * @brief method to view the device node of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_devnode_view() const;
+
+        /**
+         * @brief method to view the device type of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_devtype_view() const;
+
+        /**
+         * @brief method to view the subsystem of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_subsystem_view() const;
+
+        /**
+         * @brief method to view the driver of the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_driver_view() const;
+
+        /**
+         * @brief method to view the action associated with the device without copying it.
+         * @return the view, valid while this device object exists.
+         */
+        [[nodiscard]] std::string_view get_action_view() const;
+
         /**
          * @brief method to return the parent of a device
          * @return a result object whose succeeded member is
@@ -309,6 +613,59 @@ namespace TF::Linux::Udev
          */
         [[nodiscard]] string_map_type load_attributes_from_device_path();
 
+        /**
+         * @brief method to load attributes of a device from the system path of the device using
+         * directory relative system calls.
+         * @return a map of the key/value pairs of attributes.
+         *
+         * This method produces the same map as load_attributes_from_device_path but reads the
+         * device directories with a SysfsAttributeLoader, which avoids rebuilding paths and
+         * reopening files through the FileManager for every attribute.  Like
+         * load_attributes_from_device_path it walks back up the tree of parents and collects those
+         * attributes as well.
+         */
+        [[nodiscard]] string_map_type load_attributes_from_sysfs() const;
+
+        /**
+         * @brief method to load attributes of a device and its parents through an attribute cache.
+         * @param cache the cache, usually the one returned by Context::get_attribute_cache.
+         * @return a chain of the attribute maps of the device and its parents.
+         *
+         * Each device directory not already in @e cache is read once with a SysfsAttributeLoader and
+         * added to the cache, so loading many children of the same parent reads the parent's
+         * directory only once.  The chain references the cached maps instead of merging copies of them.
+         */
+        [[nodiscard]] AttributeMapChain load_attributes_from_sysfs(AttributeCache & cache) const;
+
+        /**
+         * @brief method to load only the named attributes of a device and its parents.
+         * @param keys the attribute names, for example "size" or "queue/physical_block_size".
+         * @return a map of the key/value pairs of the attributes that were found.
+         *
+         * Only the attribute files named by @e keys are opened, so slow attributes that are not
+         * needed are never read.  The walk up the tree of parents stops as soon as every key has
+         * been found.
+         */
+        [[nodiscard]] string_map_type load_attributes_for_keys(const string_set_type & keys) const;
+
+        /**
+         * @brief method to load the attributes of a device and its parents whose names match
+         * glob patterns.
+         * @param patterns the fnmatch(3) patterns, see SysfsAttributeLoader::load_matching.
+         * @return a map of the key/value pairs of the matching attributes.
+         */
+        [[nodiscard]] string_map_type load_attributes_matching(const string_list_type & patterns) const;
+
+        /**
+         * @brief method to get a map of the attributes of the device and its parents that reads
+         * each attribute the first time it is requested.
+         * @return the lazy attribute map.
+         *
+         * The map only holds the system paths of the devices, so it remains usable after this
+         * device object is destroyed.
+         */
+        [[nodiscard]] LazyAttributeMap get_lazy_attributes() const;
+
         /**
          * @brief method for helping write a device object to a stream
          * @param o the stream object
@@ -326,26 +683,31 @@ namespace TF::Linux::Udev
         /**
          * @brief method to help with the udev library functions that all return
          * key/value pairs.
-         * @param f the udev function to execute
+         * @tparam F the udev function to execute
          * @return a map of the key value pairs returned by the udev function call.
+         *
+         * The udev function is a template parameter rather than a std::function argument so that
+         * each getter compiles to a direct call with no type erasure or allocation.
          */
-        [[nodiscard]] string_map_type get_values(const std::function<udev_list_entry *(udev_device *)> & f) const;
+        template<udev_list_entry * (*F)(udev_device *)>
+        [[nodiscard]] string_map_type get_values() const;
 
         /**
          * @brief helper method for udev functions that take a key and return a value.
-         * @param f the udev function
+         * @tparam F the udev function
          * @param key the key
          * @return the value associated with key.
          */
-        [[nodiscard]] string_type get_value(const std::function<const char *(udev_device *, const char * Key)> & f,
-                                            const string_type & key);
+        template<const char * (*F)(udev_device *, const char *)>
+        [[nodiscard]] string_type get_value(const char * key) const;
 
         /**
          * @brief helper method for udev functions that return a property-like value.
-         * @param f the udev library function
+         * @tparam F the udev library function
          * @return the property-like value returned from the library function.
          */
-        [[nodiscard]] string_type get_property(const std::function<const char *(udev_device *)> & f) const;
+        template<const char * (*F)(udev_device *)>
+        [[nodiscard]] string_type get_property() const;
 
         /**
          * @brief helper method to assist in loading attributes for a device from the /sys
@@ -360,6 +722,14 @@ namespace TF::Linux::Udev
         static void load_sub_attributes_into_map(FileManager & manager, string_map_type & map, const string_type & path,
                                                  const string_type & prefix, bool is_sub_dir);
 
+        /**
+         * @brief helper method to get the directory the sysfs attribute loaders read for a device.
+         * @param device the device
+         * @return the syspath of the device, or nullptr if the device has no DEVPATH property.  Like
+         * load_attributes_from_device_path, the loaders stop walking up the device tree there.
+         */
+        static const char * get_attribute_directory(udev_device * device);
+
         udev_device * m_device;
 
         // A query needs access to the libudev udev_device pointer.
@@ -382,6 +752,95 @@ namespace TF::Linux::Udev
         using string_type = String;
         using string_list_type = std::vector<string_type>;
 
+        /**
+         * The DeviceRange class is a single pass range over the devices matched by a query.
+         *
+         * Each Device is created from its libudev list entry when the iterator reaches it, so a
+         * loop that stops early (for example after finding the first matching device) never
+         * creates the remaining devices or copies their syspaths.  Devices that disappear
+         * between the scan and the iteration are skipped.  The range is only valid while the
+         * Query that produced it exists and until the query is run again.
+         */
+        class DeviceRange
+        {
+        public:
+            /**
+             * The iterator class walks the devices of the range.  Iterators are move-only
+             * because each one owns the device it points at.
+             */
+            class iterator
+            {
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using value_type = Device;
+                using difference_type = std::ptrdiff_t;
+                using pointer = Device *;
+                using reference = Device &;
+
+                /** @brief default constructor, creates the end iterator. */
+                iterator() = default;
+
+                /**
+                 * @brief constructor with a context and list entry
+                 * @param context the udev context used to create the devices.
+                 * @param entry the first entry, nullptr creates the end iterator.
+                 */
+                iterator(udev * context, udev_list_entry * entry);
+
+                iterator(const iterator &) = delete;
+                iterator(iterator &&) = default;
+                iterator & operator=(const iterator &) = delete;
+                iterator & operator=(iterator &&) = default;
+
+                reference operator*() const;
+
+                pointer operator->() const;
+
+                iterator & operator++();
+
+                void operator++(int);
+
+                bool operator==(const iterator & i) const;
+
+            private:
+                /**
+                 * @brief helper method to create the device for the current entry, moving past
+                 * entries whose device cannot be created.
+                 */
+                void create_device();
+
+                udev * m_context{nullptr};
+                udev_list_entry * m_entry{nullptr};
+                mutable std::optional<Device> m_device{};
+            };
+
+            /**
+             * @brief constructor with a context and the first entry of the query results
+             * @param context the udev context used to create the devices.
+             * @param first the first entry, nullptr creates an empty range.
+             */
+            DeviceRange(udev * context, udev_list_entry * first) : m_context{context}, m_first{first} {}
+
+            [[nodiscard]] iterator begin() const
+            {
+                return iterator{m_context, m_first};
+            }
+
+            [[nodiscard]] iterator end() const
+            {
+                return iterator{};
+            }
+
+            [[nodiscard]] bool empty() const
+            {
+                return m_first == nullptr;
+            }
+
+        private:
+            udev * m_context;
+            udev_list_entry * m_first;
+        };
+
         /**
          * @brief constructor
          * @param ctx the context object.
@@ -458,7 +917,25 @@ namespace TF::Linux::Udev
          */
         string_list_type run();
 
+        /**
+         * @brief method to run the query and iterate over the matching devices.
+         * @return a range that creates each device as the iteration reaches it.
+         *
+         * Use this instead of run when the devices themselves are needed:
+         * @code
+         * for (Device & device : query.devices())
+         * @endcode
+         */
+        [[nodiscard]] DeviceRange devices();
+
     private:
+        /**
+         * @brief helper method to wrap a udev_device created by a DeviceRange iterator.
+         * @param device the device, the new Device takes over its reference.
+         * @return the Device.
+         */
+        static Device make_device(udev_device * device);
+
         udev_enumerate * m_enumerator;
 
         // Need access to Device internal for setting parent.
@@ -478,7 +955,48 @@ namespace TF::Linux::Udev
     public:
         using context_type = Context;
         using device_type = Device;
+        using device_list_type = std::vector<Device>;
         using string_type = String;
+        using batch_callback_type = std::function<void(device_list_type &)>;
+        using clock_type = std::chrono::steady_clock;
+        using resync_callback_type = std::function<void(Query::string_list_type &)>;
+
+        /**
+         * The EventTiming struct describes when the monitor received an event.
+         *
+         * The kernel does not timestamp netlink messages, so @e queued is the time the monitor
+         * first found the event's socket queue not empty: the start of the receive call, or of
+         * the earliest receive call since the queue was last empty.  The time from @e queued to
+         * @e received is the time the event waited while the monitor was already busy with it
+         * or with the events ahead of it, which grows when handlers fall behind a burst.
+         */
+        struct EventTiming
+        {
+            uint64_t seqnum{0};
+            clock_type::time_point queued{};
+            clock_type::time_point received{};
+            // Receive buffer memory still in use by queued messages, only set when timing is enabled.
+            size_t buffer_bytes{0};
+        };
+
+        /**
+         * The Statistics struct counts the events received by a monitor and the events lost.
+         *
+         * A buffer overflow is reported once by the kernel however many messages it dropped.
+         * Sequence gaps count the kernel sequence numbers missing between the events received,
+         * less those that arrive later out of order.  Sequence numbers are shared by every
+         * device, so gaps are only counted by monitors without matches or a filter, and udevd
+         * finishes events out of order, so on a "udev" monitor a gap can be filled later.
+         */
+        struct Statistics
+        {
+            size_t received{0};
+            size_t buffer_overflows{0};
+            size_t sequence_gaps{0};
+            size_t resyncs{0};
+            uint64_t last_seqnum{0};
+            size_t max_buffer_bytes{0};
+        };
 
         /**
          * @brief constructor with context and name
@@ -487,6 +1005,10 @@ namespace TF::Linux::Udev
          */
         Monitor(const context_type & ctx, const string_type & name);
 
+        // A monitor owns its udev_monitor and stop descriptor, so copies would close them twice.
+        Monitor(const Monitor &) = delete;
+        Monitor & operator=(const Monitor &) = delete;
+
         /** destructor */
         ~Monitor();
 
@@ -509,6 +1031,29 @@ namespace TF::Linux::Udev
          */
         void match_tag(const string_type & tag);
 
+        /**
+         * @brief method to filter the monitor with a MonitorFilter.
+         * @param filter the filter
+         *
+         * The filter is compiled to a BPF program and attached to the monitor socket, replacing
+         * the socket filter libudev builds from match_subsystem, match_subsystem_and_devtype and
+         * match_tag, so put every rule in the filter rather than mixing the two.  Messages the
+         * kernel passes are checked against the rest of the filter before a device is created
+         * for them.  The filter can be set before or after calling monitor().
+         */
+        void set_filter(const MonitorFilter & filter);
+
+        /**
+         * @brief method to remove the filter set with set_filter.
+         */
+        void remove_filter();
+
+        /**
+         * @brief method to get the number of messages discarded in user space by the filter.
+         * @return the number of messages discarded.
+         */
+        [[nodiscard]] size_t get_filtered_message_count() const;
+
         /**
          * @brief method to get the file descriptor for the monitor
          * @return the file descriptor
@@ -536,9 +1081,102 @@ namespace TF::Linux::Udev
         /**
          * @brief method to get a device from the monitor when a device matches
          * @return a device that matched the monitor specifications.
+         *
+         * Any attributes cached for the device's syspath in the context's attribute cache
+         * are invalidated before the device is returned.
          */
         [[nodiscard]] device_type get_device();
 
+        /**
+         * @brief method to get a device from the monitor without blocking.
+         * @return the next device that matched the monitor specifications, or an empty
+         * optional if no device is queued.
+         */
+        [[nodiscard]] std::optional<device_type> try_get_device();
+
+        /**
+         * @brief method to receive all the devices queued on the monitor in one call.
+         * @param max_devices the largest number of devices to receive, 0 means no limit.
+         * @return the devices in the order they were received, empty if no device is queued.
+         */
+        [[nodiscard]] device_list_type drain_devices(size_t max_devices = 0);
+
+        /**
+         * @brief method to run an event loop that delivers devices in batches.
+         * @param callback the function to call with each batch of devices.
+         * @param batch_size the largest number of devices delivered in one batch.
+         *
+         * The method blocks, waiting on the monitor file descriptor with an edge-triggered
+         * epoll set, until another thread calls stop.  Each time the monitor becomes readable,
+         * the queued devices are received in batches of up to @e batch_size and passed to
+         * @e callback, so a burst of hotplug events is handled with one wakeup instead of one
+         * per device.  Call monitor() before calling run.
+         */
+        void run(const batch_callback_type & callback, size_t batch_size = DEFAULT_BATCH_SIZE);
+
+        /**
+         * @brief method to make a running event loop return.
+         */
+        void stop();
+
+        /**
+         * @brief method to turn the latency measurements on or off.
+         * @param enabled true to measure each event
+         *
+         * When enabled, each receive records the time the event waited in the latency histogram
+         * and reads the receive buffer usage from the socket, which is one extra system call per
+         * event.  Timing is off by default.
+         */
+        void set_timing_enabled(bool enabled);
+
+        /**
+         * @brief method to find out if the latency measurements are on.
+         * @return true if timing is enabled.
+         */
+        [[nodiscard]] bool get_timing_enabled() const;
+
+        /**
+         * @brief method to get the sequence number and timing of the last device received.
+         * @return the timing, for a batch the timing of the last device in it.
+         */
+        [[nodiscard]] const EventTiming & get_last_event_timing() const;
+
+        /**
+         * @brief method to get the time waited by each event received while timing was enabled.
+         * @return the latency histogram.
+         */
+        [[nodiscard]] const LatencyHistogram & get_latency_histogram() const;
+
+        /**
+         * @brief method to get the counts of events received and lost.
+         * @return the statistics.
+         */
+        [[nodiscard]] Statistics get_statistics() const;
+
+        /**
+         * @brief method to set the statistics and the latency histogram back to zero.
+         */
+        void reset_statistics();
+
+        /**
+         * @brief method to set a function to call with a fresh enumeration when events are lost.
+         * @param callback the function, or an empty function to stop resynchronizing.
+         *
+         * When the receive buffer overflows, the monitor runs a Query with the subsystems and
+         * tags it matches and passes the syspaths found to @e callback before it returns the
+         * next device, so the caller can rebuild whatever state it keeps from events.  A devtype
+         * match re-enumerates its whole subsystem and a MonitorFilter does not narrow the query.
+         * The attribute cache of the context is cleared on an overflow whether or not a callback
+         * is set, since the invalidations carried by the lost events are gone.
+         */
+        void set_resync_callback(const resync_callback_type & callback);
+
+        /**
+         * @brief method to re-enumerate the devices the monitor matches and pass them to the
+         * resync callback.
+         */
+        void resync();
+
         /**
          * @brief method to increase the reference count on the monitor object.
          */
@@ -549,8 +1187,79 @@ namespace TF::Linux::Udev
          */
         void release();
 
+        constexpr static size_t DEFAULT_BATCH_SIZE = 64;
+
     private:
+        constexpr static size_t INITIAL_MESSAGE_BUFFER_SIZE = 8192;
+
+        /**
+         * @brief helper method to do the bookkeeping for a device received from libudev.
+         * @param device the device
+         */
+        void device_received(udev_device * device);
+
+        /**
+         * @brief helper method to receive the next device that passes the filter.
+         * @return the device, or nullptr if no device is queued.
+         */
+        udev_device * receive_device();
+
+        /**
+         * @brief helper method to discard queued messages that do not pass the filter.
+         * @return true if a message that passes the filter is queued and false otherwise.
+         */
+        bool discard_filtered_messages();
+
+        /**
+         * @brief helper method to attach the compiled filter to the monitor socket.
+         */
+        void attach_filter();
+
+        /**
+         * @brief helper method to handle the kernel reporting that the receive buffer overflowed.
+         */
+        void buffer_overflowed();
+
+        /**
+         * @brief helper method to update the sequence gap count for a device received.
+         * @param seqnum the sequence number of the device
+         */
+        void record_sequence_number(uint64_t seqnum);
+
+        /**
+         * @brief helper method to get the receive buffer memory in use by queued messages.
+         * @return the number of bytes, 0 if the socket cannot report it.
+         */
+        size_t get_buffer_bytes() const;
+
         udev_monitor * m_monitor;
+
+        // The filter set with set_filter and the buffer used to look at queued messages.
+        std::optional<MonitorFilter> m_filter;
+        std::vector<char> m_message_buffer;
+        size_t m_filtered_message_count;
+
+        // The attribute cache of the context, invalidated for each device received.
+        std::shared_ptr<AttributeCache> m_attribute_cache;
+
+        // The string pool of the context, returned with it by get_context.
+        std::shared_ptr<StringPool> m_string_pool;
+
+        // eventfd used by stop to wake up run.
+        int m_stop_fd;
+
+        // The subsystems and tags matched, used by resync, and whether anything narrows the monitor.
+        std::vector<string_type> m_match_subsystems;
+        std::vector<string_type> m_match_tags;
+        bool m_has_matches;
+
+        // Sequence numbers, counters and timing of the events received.
+        bool m_timing_enabled;
+        std::optional<clock_type::time_point> m_queued_since;
+        EventTiming m_last_event_timing;
+        Statistics m_statistics;
+        LatencyHistogram m_latency_histogram;
+        resync_callback_type m_resync_callback;
     };
 
 } // namespace TF::Linux::Udev
@@ -6,5 +6,6 @@
 ################################################################################
 
 include(tests/cmake/config.cmake)
+include(tests/files/config.cmake)
 include(tests/udev/config.cmake)
 
@@ -0,0 +1,12 @@
+################################################################################
+#####
+##### Tectiform TFLinux CMake Configuration File
+##### Created by: Steve Wilson
+#####
+################################################################################
+
+build_and_run_test(
+        files_test
+        FilesTest
+        tests/files/files_tests.cpp
+)
@@ -0,0 +1,675 @@
+/******************************************************************************
+
+Tectiform Open Source License (TOS)
+
+Copyright (c) 2022 to 2022 Tectiform Inc.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (dthe "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+
+******************************************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <climits>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TFFoundation.hpp"
+#include "TFLinux.hpp"
+#include "gtest/gtest.h"
+
+using namespace TF::Foundation;
+using namespace TF::Linux;
+
+namespace
+{
+    // Unprivileged processes may only create FAN_REPORT_FID groups, and only on kernels from 5.13.
+    std::unique_ptr<FileObserver> make_observer()
+    {
+        try
+        {
+            return std::make_unique<FileObserver>(FAN_CLASS_NOTIF | FAN_REPORT_FID | FAN_CLOEXEC, O_RDONLY | O_CLOEXEC);
+        }
+        catch (const std::system_error &)
+        {
+            return nullptr;
+        }
+    }
+
+    // Permission events need CAP_SYS_ADMIN.
+    std::unique_ptr<FileObserver> make_permission_observer()
+    {
+        try
+        {
+            return std::make_unique<FileObserver>(FAN_CLASS_CONTENT | FAN_CLOEXEC, O_RDONLY | O_CLOEXEC);
+        }
+        catch (const std::system_error &)
+        {
+            return nullptr;
+        }
+    }
+
+    // A file in the test's temporary directory, removed when the object is destroyed.
+    class TemporaryFile
+    {
+    public:
+        explicit TemporaryFile(const std::string & name) : m_path{::testing::TempDir() + name}
+        {
+            AutoFileDescriptor fd{open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)};
+            if (! fd.is_valid() || write(*fd, "data", 4) != 4)
+            {
+                throw std::system_error{errno, std::system_category(), "cannot create " + m_path};
+            }
+        }
+
+        ~TemporaryFile()
+        {
+            (void)std::remove(m_path.c_str());
+        }
+
+        [[nodiscard]] int open_descriptor() const
+        {
+            return open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+        }
+
+        [[nodiscard]] const std::string & get_path() const
+        {
+            return m_path;
+        }
+
+        void append(std::string_view data) const
+        {
+            AutoFileDescriptor fd{open(m_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC)};
+            if (! fd.is_valid() || write(*fd, data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+            {
+                throw std::system_error{errno, std::system_category(), "cannot append to " + m_path};
+            }
+        }
+
+    private:
+        std::string m_path;
+    };
+
+    bool is_open(int fd)
+    {
+        return fcntl(fd, F_GETFD) != -1;
+    }
+
+    // Append an info record to an event buffer, padded to keep the next record aligned.
+    void append_record(std::vector<unsigned char> & buffer, const void * record, size_t length)
+    {
+        auto padded_length = (length + 7) / 8 * 8;
+        auto offset = buffer.size();
+        buffer.resize(offset + padded_length, 0);
+        std::memcpy(buffer.data() + offset, record, length);
+        reinterpret_cast<fanotify_event_info_header *>(buffer.data() + offset)->len =
+            static_cast<uint16_t>(padded_length);
+    }
+
+    // A file id record with an 8 byte handle, followed by @e name for FAN_EVENT_INFO_TYPE_DFID_NAME.
+    std::vector<unsigned char> make_file_id_record(uint8_t info_type, unsigned char handle_value,
+                                                   std::string_view name = {})
+    {
+        std::vector<unsigned char> record(sizeof(fanotify_event_info_fid) + sizeof(struct file_handle) + 8, 0);
+        auto file_id = reinterpret_cast<fanotify_event_info_fid *>(record.data());
+        file_id->hdr.info_type = info_type;
+        auto handle = reinterpret_cast<struct file_handle *>(record.data() + sizeof(fanotify_event_info_fid));
+        handle->handle_bytes = 8;
+        handle->handle_type = 1;
+        std::memset(record.data() + sizeof(fanotify_event_info_fid) + sizeof(struct file_handle), handle_value, 8);
+        if (! name.empty())
+        {
+            record.insert(record.end(), name.begin(), name.end());
+            record.push_back('\0');
+        }
+        return record;
+    }
+
+    // An event as fanotify would report it for a descriptor, without info records.
+    FileEvent make_event(int fd, uint64_t mask, pid_t pid)
+    {
+        fanotify_event_metadata metadata{};
+        metadata.event_len = sizeof(metadata);
+        metadata.vers = FANOTIFY_METADATA_VERSION;
+        metadata.metadata_len = sizeof(metadata);
+        metadata.mask = mask;
+        metadata.fd = fd;
+        metadata.pid = pid;
+        return FileEvent{&metadata};
+    }
+} // namespace
+
+TEST(FILES, observer_statistics_test)
+{
+    using namespace std::chrono_literals;
+
+    FileObserver::Statistics statistics{};
+    EXPECT_EQ(statistics.get_reads_per_second(), 0.0);
+    EXPECT_EQ(statistics.get_events_per_read(), 0.0);
+
+    statistics.reads = 10;
+    statistics.events = 25;
+    statistics.elapsed = 2s;
+    EXPECT_DOUBLE_EQ(statistics.get_reads_per_second(), 5.0);
+    EXPECT_DOUBLE_EQ(statistics.get_events_per_read(), 2.5);
+
+    auto observer = make_observer();
+    if (! observer)
+    {
+        GTEST_SKIP() << "fanotify is not available";
+    }
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    EXPECT_EQ(observer->get_buffer_size(), FileObserver::DEFAULT_BUFFER_SIZE);
+    observer->set_buffer_size(1);
+    EXPECT_EQ(observer->get_buffer_size(), page_size);
+    observer->set_buffer_size(page_size * 2 + 1);
+    EXPECT_EQ(observer->get_buffer_size(), page_size * 3);
+    EXPECT_EQ(observer->get_statistics().reads, size_t{0});
+}
+
+TEST(FILES, observer_handle_test)
+{
+    using namespace std::chrono_literals;
+
+    auto observer = make_observer();
+    if (! observer)
+    {
+        GTEST_SKIP() << "fanotify is not available";
+    }
+
+    AutoFileDescriptor event_fd{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)};
+    ASSERT_TRUE(event_fd.is_valid());
+    std::atomic<uint64_t> received{0};
+    observer->add_handle(*event_fd, [&received](int fd) {
+        uint64_t value{0};
+        if (read(fd, &value, sizeof(value)) == sizeof(value))
+        {
+            received += value;
+        }
+    });
+
+    std::thread runner{[&observer]() {
+        observer->run([](FileObserver::event_list_type) {});
+    }};
+
+    uint64_t value{3};
+    ASSERT_EQ(write(*event_fd, &value, sizeof(value)), static_cast<ssize_t>(sizeof(value)));
+    for (int i = 0; i < 1000 && received < 3; i++)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_EQ(received, uint64_t{3});
+
+    // stop wakes the idle loop, so run returns without another event.
+    observer->stop();
+    runner.join();
+
+    observer->remove_handle(*event_fd);
+    ASSERT_EQ(write(*event_fd, &value, sizeof(value)), static_cast<ssize_t>(sizeof(value)));
+    std::thread second_runner{[&observer]() {
+        observer->run([](FileObserver::event_list_type) {});
+    }};
+    std::this_thread::sleep_for(20ms);
+    observer->stop();
+    second_runner.join();
+    EXPECT_EQ(received, uint64_t{3});
+}
+
+TEST(FILES, dispatcher_order_test)
+{
+    TemporaryFile first_file{"files_dispatcher_order_test.first"};
+    TemporaryFile second_file{"files_dispatcher_order_test.second"};
+
+    std::mutex mutex;
+    std::map<FileEventDispatcher::key_type, std::vector<pid_t>> handled;
+    FileEventDispatcher dispatcher{[&mutex, &handled](FileEvent & event) {
+                                       auto key = FileEventDispatcher::get_file_key(event);
+                                       std::lock_guard<std::mutex> lock{mutex};
+                                       handled[key].push_back(event.get_pid());
+                                   },
+                                   4, 8};
+
+    constexpr pid_t event_count = 200;
+    for (pid_t i = 0; i < event_count; i++)
+    {
+        auto fd = (i % 2 == 0 ? first_file : second_file).open_descriptor();
+        ASSERT_GE(fd, 0);
+        dispatcher.dispatch(make_event(fd, FAN_OPEN, i));
+    }
+    dispatcher.wait();
+
+    // Every descriptor of one file maps to the same key, and its events are handled in order.
+    ASSERT_EQ(handled.size(), size_t{2});
+    for (auto & [key, pids] : handled)
+    {
+        EXPECT_NE(key, FileEventDispatcher::key_type{0});
+        EXPECT_EQ(pids.size(), size_t{event_count / 2});
+        EXPECT_TRUE(std::is_sorted(pids.begin(), pids.end()));
+    }
+
+    auto statistics = dispatcher.get_statistics();
+    EXPECT_EQ(statistics.dispatched, size_t{event_count});
+    EXPECT_EQ(statistics.handled, size_t{event_count});
+    EXPECT_LE(statistics.max_queue_length, size_t{8});
+
+    // Events that refer to no file, such as a queue overflow, share key 0.
+    EXPECT_EQ(FileEventDispatcher::get_file_key(make_event(FAN_NOFD, FAN_Q_OVERFLOW, 0)),
+              FileEventDispatcher::key_type{0});
+}
+
+TEST(FILES, dispatcher_backpressure_test)
+{
+    using namespace std::chrono_literals;
+
+    std::atomic<bool> released{false};
+    std::atomic<size_t> handled{0};
+    FileEventDispatcher dispatcher{[&released, &handled](FileEvent &) {
+                                       while (! released)
+                                       {
+                                           std::this_thread::sleep_for(1ms);
+                                       }
+                                       handled++;
+                                   },
+                                   1, 1};
+
+    // The worker holds the first event and the queue holds one more, so the third dispatch waits.
+    std::thread dispatcher_thread{[&dispatcher]() {
+        for (pid_t i = 0; i < 3; i++)
+        {
+            dispatcher.dispatch(make_event(FAN_NOFD, FAN_OPEN, i));
+        }
+    }};
+    for (int i = 0; i < 1000 && dispatcher.get_statistics().blocked == 0; i++)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    EXPECT_GE(dispatcher.get_statistics().blocked, size_t{1});
+    EXPECT_EQ(handled, size_t{0});
+
+    released = true;
+    dispatcher_thread.join();
+    dispatcher.wait();
+    EXPECT_EQ(handled, size_t{3});
+    EXPECT_EQ(dispatcher.get_statistics().max_queue_length, size_t{1});
+}
+
+TEST(FILES, auto_file_descriptor_test)
+{
+    AutoFileDescriptor empty{};
+    EXPECT_FALSE(empty.is_valid());
+    EXPECT_EQ(*empty, -1);
+
+    auto fd = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    AutoFileDescriptor owner{fd};
+    EXPECT_TRUE(owner.is_valid());
+
+    // Moving transfers ownership without closing the descriptor.
+    AutoFileDescriptor moved{std::move(owner)};
+    EXPECT_FALSE(owner.is_valid());
+    EXPECT_EQ(*moved, fd);
+    EXPECT_TRUE(is_open(fd));
+
+    AutoFileDescriptor assigned{};
+    assigned = std::move(moved);
+    EXPECT_FALSE(moved.is_valid());
+    EXPECT_EQ(*assigned, fd);
+    EXPECT_TRUE(is_open(fd));
+
+    // Move assignment closes the descriptor it replaces.
+    auto other_fd = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(other_fd, 0);
+    AutoFileDescriptor other{other_fd};
+    other = std::move(assigned);
+    EXPECT_FALSE(is_open(other_fd));
+    EXPECT_EQ(*other, fd);
+
+    // release gives the descriptor up without closing it.
+    auto released = other.release();
+    EXPECT_EQ(released, fd);
+    EXPECT_FALSE(other.is_valid());
+    EXPECT_TRUE(is_open(fd));
+
+    // reset closes the held descriptor and takes the new one.
+    other.reset(released);
+    EXPECT_TRUE(is_open(fd));
+    other.reset();
+    EXPECT_FALSE(is_open(fd));
+    EXPECT_FALSE(other.is_valid());
+}
+
+TEST(FILES, file_event_ownership_test)
+{
+    TemporaryFile file{"files_file_event_ownership_test"};
+
+    auto fd = file.open_descriptor();
+    ASSERT_GE(fd, 0);
+    {
+        auto event = make_event(fd, FAN_OPEN, 42);
+        EXPECT_EQ(event.get_file_descriptor(), fd);
+        EXPECT_EQ(event.get_mask(), uint64_t{FAN_OPEN});
+        EXPECT_EQ(event.get_pid(), 42);
+        EXPECT_EQ(event.get_pidfd(), -1);
+        EXPECT_TRUE(event.get_path().stlString().ends_with("files_file_event_ownership_test"));
+
+        // The moved-to event owns the descriptor, the moved-from event keeps only the metadata.
+        auto moved = std::move(event);
+        EXPECT_EQ(moved.get_file_descriptor(), fd);
+        EXPECT_EQ(event.get_file_descriptor(), -1);
+        EXPECT_EQ(event.get_metadata().fd, fd);
+        EXPECT_TRUE(is_open(fd));
+    }
+    EXPECT_FALSE(is_open(fd));
+
+    fd = file.open_descriptor();
+    ASSERT_GE(fd, 0);
+    {
+        auto event = make_event(fd, FAN_OPEN, 42);
+        EXPECT_EQ(event.release_file_descriptor(), fd);
+        EXPECT_EQ(event.get_file_descriptor(), -1);
+        EXPECT_EQ(event.get_metadata().fd, fd);
+    }
+    EXPECT_TRUE(is_open(fd));
+    (void)close(fd);
+
+    // Events without a descriptor, as in FAN_REPORT_FID mode, have no path.
+    auto fid_event = make_event(FAN_NOFD, FAN_CREATE, 42);
+    EXPECT_TRUE(fid_event.get_path().empty());
+    EXPECT_EQ(fid_event.get_file_id_record(), nullptr);
+    EXPECT_TRUE(fid_event.get_name().empty());
+    EXPECT_THROW((void)fid_event.open_file_by_handle(AT_FDCWD), std::logic_error);
+}
+
+TEST(FILES, file_event_info_record_test)
+{
+    auto pidfd = eventfd(0, EFD_CLOEXEC);
+    ASSERT_GE(pidfd, 0);
+
+    // A directory record with a name, then the file's own record, then a pidfd.
+    std::vector<unsigned char> buffer(sizeof(fanotify_event_metadata), 0);
+    auto directory_record = make_file_id_record(FAN_EVENT_INFO_TYPE_DFID_NAME, 0x11, "child.txt");
+    append_record(buffer, directory_record.data(), directory_record.size());
+    auto file_record = make_file_id_record(FAN_EVENT_INFO_TYPE_FID, 0x22);
+    append_record(buffer, file_record.data(), file_record.size());
+    fanotify_event_info_pidfd pidfd_record{};
+    pidfd_record.hdr.info_type = FAN_EVENT_INFO_TYPE_PIDFD;
+    pidfd_record.pidfd = pidfd;
+    append_record(buffer, &pidfd_record, sizeof(pidfd_record));
+
+    auto metadata = reinterpret_cast<fanotify_event_metadata *>(buffer.data());
+    metadata->event_len = static_cast<uint32_t>(buffer.size());
+    metadata->vers = FANOTIFY_METADATA_VERSION;
+    metadata->metadata_len = sizeof(fanotify_event_metadata);
+    metadata->mask = FAN_CREATE;
+    metadata->fd = FAN_NOFD;
+    metadata->pid = 42;
+
+    {
+        FileEvent event{metadata};
+        // The event copied the records, so the read buffer may be reused.
+        std::fill(buffer.begin(), buffer.end(), 0);
+
+        EXPECT_EQ(event.get_file_descriptor(), -1);
+        EXPECT_EQ(event.get_pidfd(), pidfd);
+        EXPECT_EQ(event.get_name(), "child.txt");
+
+        // The file's own record is preferred over its directory's.
+        auto record = event.get_file_id_record();
+        ASSERT_NE(record, nullptr);
+        EXPECT_EQ(record->hdr.info_type, FAN_EVENT_INFO_TYPE_FID);
+        auto handle = reinterpret_cast<const struct file_handle *>(record->handle);
+        EXPECT_EQ(handle->handle_bytes, 8u);
+        EXPECT_EQ(handle->f_handle[0], 0x22);
+    }
+    EXPECT_FALSE(is_open(pidfd));
+
+    // A record that claims to run past the end of the event is ignored.
+    std::vector<unsigned char> truncated(sizeof(fanotify_event_metadata), 0);
+    append_record(truncated, directory_record.data(), directory_record.size());
+    metadata = reinterpret_cast<fanotify_event_metadata *>(truncated.data());
+    metadata->event_len = static_cast<uint32_t>(truncated.size() - 8);
+    metadata->vers = FANOTIFY_METADATA_VERSION;
+    metadata->metadata_len = sizeof(fanotify_event_metadata);
+    metadata->fd = FAN_NOFD;
+    FileEvent truncated_event{metadata};
+    EXPECT_EQ(truncated_event.get_file_id_record(), nullptr);
+    EXPECT_TRUE(truncated_event.get_name().empty());
+
+    // A record too short to hold a file handle, ending exactly at the end of the event.
+    std::vector<unsigned char> short_record(sizeof(fanotify_event_metadata) + sizeof(fanotify_event_info_fid), 0);
+    auto short_header = reinterpret_cast<fanotify_event_info_header *>(short_record.data() +
+                                                                       sizeof(fanotify_event_metadata));
+    short_header->info_type = FAN_EVENT_INFO_TYPE_DFID_NAME;
+    short_header->len = sizeof(fanotify_event_info_fid);
+    metadata = reinterpret_cast<fanotify_event_metadata *>(short_record.data());
+    metadata->event_len = static_cast<uint32_t>(short_record.size());
+    metadata->vers = FANOTIFY_METADATA_VERSION;
+    metadata->metadata_len = sizeof(fanotify_event_metadata);
+    metadata->fd = FAN_NOFD;
+    FileEvent short_event{metadata};
+    EXPECT_EQ(short_event.get_file_id_record(), nullptr);
+    EXPECT_TRUE(short_event.get_name().empty());
+
+    // A record whose handle claims more bytes than the record holds.
+    auto oversized_record = make_file_id_record(FAN_EVENT_INFO_TYPE_DFID_NAME, 0x33, "child.txt");
+    reinterpret_cast<struct file_handle *>(oversized_record.data() + sizeof(fanotify_event_info_fid))->handle_bytes =
+        4096;
+    std::vector<unsigned char> oversized(sizeof(fanotify_event_metadata), 0);
+    append_record(oversized, oversized_record.data(), oversized_record.size());
+    metadata = reinterpret_cast<fanotify_event_metadata *>(oversized.data());
+    metadata->event_len = static_cast<uint32_t>(oversized.size());
+    metadata->vers = FANOTIFY_METADATA_VERSION;
+    metadata->metadata_len = sizeof(fanotify_event_metadata);
+    metadata->fd = FAN_NOFD;
+    FileEvent oversized_event{metadata};
+    EXPECT_EQ(oversized_event.get_file_id_record(), nullptr);
+    EXPECT_TRUE(oversized_event.get_name().empty());
+}
+
+TEST(FILES, dispatcher_error_test)
+{
+    using namespace std::chrono_literals;
+
+    TemporaryFile file{"files_dispatcher_error_test"};
+    FileEventDispatcher dispatcher{[](FileEvent &) {
+                                       throw std::runtime_error{"handler failed"};
+                                   },
+                                   1, 4};
+
+    dispatcher.dispatch(make_event(FAN_NOFD, FAN_OPEN, 1));
+    for (int i = 0; i < 1000 && dispatcher.get_statistics().handled == 0; i++)
+    {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_EQ(dispatcher.get_statistics().handled, size_t{1});
+
+    // The next batch rethrows the error, and the descriptors in it are closed, not leaked.
+    std::vector<fanotify_event_metadata> metadata(3);
+    std::vector<fanotify_event_metadata *> events;
+    for (auto & event : metadata)
+    {
+        event.event_len = sizeof(event);
+        event.vers = FANOTIFY_METADATA_VERSION;
+        event.metadata_len = sizeof(event);
+        event.mask = FAN_OPEN;
+        event.fd = file.open_descriptor();
+        ASSERT_GE(event.fd, 0);
+        events.push_back(&event);
+    }
+    EXPECT_THROW(dispatcher.dispatch(FileObserver::event_list_type{events}), std::runtime_error);
+    for (auto & event : metadata)
+    {
+        EXPECT_FALSE(is_open(event.fd));
+    }
+
+    // The error is reported once.
+    EXPECT_NO_THROW(dispatcher.wait());
+}
+
+TEST(FILES, observer_respond_test)
+{
+    auto observer = make_observer();
+    if (! observer)
+    {
+        GTEST_SKIP() << "fanotify is not available";
+    }
+
+    // No event is waiting for any of these, so the kernel rejects every response.  Each one is
+    // skipped and counted, across more than one writev.
+    AutoFileDescriptor fd{eventfd(0, EFD_CLOEXEC)};
+    ASSERT_TRUE(fd.is_valid());
+    std::vector<FileObserver::response_type> responses(IOV_MAX + 10, FileObserver::response_type{*fd, FAN_ALLOW});
+    EXPECT_EQ(observer->respond(responses), responses.size());
+    EXPECT_EQ(observer->respond({}), size_t{0});
+
+    auto permission_observer = make_permission_observer();
+    if (! permission_observer)
+    {
+        GTEST_SKIP() << "fanotify permission events need CAP_SYS_ADMIN";
+    }
+
+    // A rejected response must not stop the ones after it from being written.
+    TemporaryFile file{"files_observer_respond_test"};
+    permission_observer->mark(String{file.get_path().c_str()}, FAN_MARK_ADD, FAN_OPEN_PERM);
+    size_t rejected{0};
+    std::thread runner{[&permission_observer, &fd, &rejected]() {
+        permission_observer->run([&permission_observer, &fd, &rejected](FileObserver::event_list_type events) {
+            std::vector<FileObserver::response_type> batch{};
+            for (auto event : events)
+            {
+                batch.push_back(FileObserver::response_type{*fd, FAN_ALLOW});
+                batch.push_back(FileObserver::response_type{event->fd, FAN_ALLOW});
+            }
+            batch.push_back(FileObserver::response_type{*fd, FAN_ALLOW});
+            rejected += permission_observer->respond(batch);
+            for (auto event : events)
+            {
+                (void)close(event->fd);
+            }
+            permission_observer->stop();
+        });
+    }};
+    AutoFileDescriptor opened{file.open_descriptor()};
+    runner.join();
+    EXPECT_TRUE(opened.is_valid());
+    EXPECT_EQ(rejected, size_t{2});
+}
+
+TEST(FILES, permission_handler_cache_test)
+{
+    auto observer = make_observer();
+    if (! observer)
+    {
+        GTEST_SKIP() << "fanotify is not available";
+    }
+
+    TemporaryFile first_file{"files_permission_handler_cache_test.first"};
+    TemporaryFile second_file{"files_permission_handler_cache_test.second"};
+    TemporaryFile third_file{"files_permission_handler_cache_test.third"};
+
+    size_t decisions{0};
+    FilePermissionHandler::Options options{};
+    options.cache_capacity = 2;
+    FilePermissionHandler handler{*observer,
+                                  [&decisions, &second_file](FileEvent & event) {
+                                      decisions++;
+                                      return event.get_path().stlString() == second_file.get_path()
+                                                 ? FilePermissionHandler::Verdict::DENY
+                                                 : FilePermissionHandler::Verdict::ALLOW;
+                                  },
+                                  options};
+
+    // Hand the handler a permission event for a fresh descriptor of a file, as run would.
+    auto open_file = [&handler](const TemporaryFile & file) {
+        fanotify_event_metadata metadata{};
+        metadata.event_len = sizeof(metadata);
+        metadata.vers = FANOTIFY_METADATA_VERSION;
+        metadata.metadata_len = sizeof(metadata);
+        metadata.mask = FAN_OPEN_PERM;
+        metadata.fd = file.open_descriptor();
+        metadata.pid = getpid();
+        ASSERT_GE(metadata.fd, 0);
+        fanotify_event_metadata * events[] = {&metadata};
+        handler.handle(FileObserver::event_list_type{events});
+        EXPECT_FALSE(is_open(metadata.fd));
+    };
+
+    // The second open of an unchanged file is answered from the cache.
+    open_file(first_file);
+    open_file(first_file);
+    EXPECT_EQ(decisions, size_t{1});
+    EXPECT_EQ(handler.get_statistics().cache_hits, size_t{1});
+
+    // Changing the file changes its stamp, so the cached verdict no longer applies.
+    first_file.append("more");
+    open_file(first_file);
+    EXPECT_EQ(decisions, size_t{2});
+    EXPECT_EQ(handler.get_cache_size(), size_t{1});
+
+    // The least recently used verdict is evicted once the cache is full.
+    open_file(second_file);
+    open_file(third_file);
+    EXPECT_EQ(decisions, size_t{4});
+    EXPECT_EQ(handler.get_cache_size(), size_t{2});
+    open_file(third_file);
+    EXPECT_EQ(decisions, size_t{4});
+    open_file(first_file);
+    EXPECT_EQ(decisions, size_t{5});
+    open_file(second_file);
+    EXPECT_EQ(decisions, size_t{6});
+
+    // invalidate drops a single verdict.
+    struct stat file_stat{};
+    ASSERT_EQ(stat(second_file.get_path().c_str(), &file_stat), 0);
+    handler.invalidate(file_stat.st_dev, file_stat.st_ino);
+    EXPECT_EQ(handler.get_cache_size(), size_t{1});
+    open_file(second_file);
+    EXPECT_EQ(decisions, size_t{7});
+
+    auto statistics = handler.get_statistics();
+    EXPECT_EQ(statistics.events, size_t{9});
+    EXPECT_EQ(statistics.denied, size_t{3});
+    EXPECT_EQ(statistics.allowed, size_t{6});
+    EXPECT_EQ(statistics.cache_hits, size_t{2});
+    EXPECT_EQ(statistics.cache_misses, size_t{7});
+
+    // Nothing was waiting for these answers, so the kernel rejected each one.
+    EXPECT_EQ(statistics.response_writes, size_t{9});
+    EXPECT_EQ(statistics.rejected_responses, size_t{9});
+
+    handler.clear_cache();
+    EXPECT_EQ(handler.get_cache_size(), size_t{0});
+    handler.reset_statistics();
+    EXPECT_EQ(handler.get_statistics().events, size_t{0});
+}
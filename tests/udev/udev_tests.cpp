@@ -25,6 +25,13 @@ SOFTWARE.
 
 ******************************************************************************/
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <thread>
 #include "TFFoundation.hpp"
 #include "TFLinux.hpp"
 #include "gtest/gtest.h"
@@ -54,3 +61,922 @@ TEST(UDEV, compile_test)
         }
     }
 }
+
+TEST(UDEV, sysfs_attribute_loader_test)
+{
+    Context context{};
+    Query query{context};
+
+    query.match_subsystem("block");
+    auto query_results = query.run();
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+
+        auto file_manager_map = device.load_attributes_from_device_path();
+        auto sysfs_map = device.load_attributes_from_sysfs();
+        EXPECT_EQ(file_manager_map.size(), sysfs_map.size());
+        for (auto & [key, value] : file_manager_map)
+        {
+            EXPECT_TRUE(sysfs_map.contains(key));
+        }
+
+        // Values that do not change while the test runs must match, not just the keys.
+        for (auto key : {"dev", "size", "removable", "queue/physical_block_size"})
+        {
+            if (file_manager_map.contains(key))
+            {
+                ASSERT_TRUE(sysfs_map.contains(key));
+                EXPECT_EQ(file_manager_map[key], sysfs_map[key]) << key;
+            }
+        }
+    }
+}
+
+TEST(UDEV, attribute_cache_test)
+{
+    Context context{};
+    Query query{context};
+
+    query.match_subsystem("block");
+    auto query_results = query.run();
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+
+        auto attribute_chain = device.load_attributes_from_sysfs(context.get_attribute_cache());
+        auto sysfs_map = device.load_attributes_from_sysfs();
+        EXPECT_EQ(attribute_chain.flatten().size(), sysfs_map.size());
+
+        // Loading the same device again must reuse the cached maps.
+        auto cache_size = context.get_attribute_cache().size();
+        auto second_chain = device.load_attributes_from_sysfs(context.get_attribute_cache());
+        EXPECT_EQ(cache_size, context.get_attribute_cache().size());
+        ASSERT_EQ(attribute_chain.get_maps().size(), second_chain.get_maps().size());
+        for (size_t i = 0; i < attribute_chain.get_maps().size(); i++)
+        {
+            EXPECT_EQ(attribute_chain.get_maps()[i], second_chain.get_maps()[i]);
+        }
+
+        context.get_attribute_cache().invalidate(device.get_syspath());
+        EXPECT_EQ(cache_size - 1, context.get_attribute_cache().size());
+    }
+
+    // A map read before an invalidation must not be cached after it.
+    AttributeCache cache{};
+    auto generation = cache.get_generation();
+    cache.invalidate("/sys/devices/virtual/block/loop0");
+    auto map = cache.insert("/sys/devices/virtual/block/loop0", {{"size", "0"}}, generation);
+    ASSERT_TRUE(map);
+    EXPECT_EQ(map->at("size"), "0");
+    EXPECT_EQ(cache.size(), size_t{0});
+    EXPECT_FALSE(cache.get("/sys/devices/virtual/block/loop0"));
+
+    auto fresh_map = cache.insert("/sys/devices/virtual/block/loop0", {{"size", "0"}}, cache.get_generation());
+    EXPECT_EQ(cache.size(), size_t{1});
+    EXPECT_EQ(cache.get("/sys/devices/virtual/block/loop0"), fresh_map);
+}
+
+TEST(UDEV, selective_attribute_loading_test)
+{
+    Context context{};
+    Query query{context};
+
+    query.match_subsystem("block");
+    auto query_results = query.run();
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+
+        auto sysfs_map = device.load_attributes_from_sysfs();
+        auto keys_map = device.load_attributes_for_keys({"size", "queue/physical_block_size"});
+        auto matching_map = device.load_attributes_matching({"queue/*"});
+        auto lazy_map = device.get_lazy_attributes();
+
+        EXPECT_EQ(sysfs_map.contains("size"), keys_map.contains("size"));
+        EXPECT_EQ(sysfs_map.contains("queue/physical_block_size"), lazy_map.contains("queue/physical_block_size"));
+        EXPECT_EQ(lazy_map.loaded_count(), size_t{1});
+        for (auto & [key, value] : matching_map)
+        {
+            EXPECT_TRUE(sysfs_map.contains(key));
+            EXPECT_EQ(sysfs_map[key], value);
+        }
+
+        if (sysfs_map.contains("size"))
+        {
+            ASSERT_TRUE(lazy_map.get("size") != nullptr);
+            EXPECT_EQ(*lazy_map.get("size"), sysfs_map["size"]);
+            EXPECT_EQ(keys_map["size"], sysfs_map["size"]);
+        }
+    }
+}
+
+TEST(UDEV, device_view_test)
+{
+    Context context{};
+    Query query{context};
+
+    query.match_subsystem("block");
+    auto query_results = query.run();
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+
+        auto property_map = device.get_properties();
+        size_t property_count{0};
+        for (auto [name, value] : device.view_properties())
+        {
+            auto key = String{name.data(), name.length()};
+            ASSERT_TRUE(property_map.contains(key));
+            EXPECT_EQ(property_map[key], String(value.data(), value.length()));
+            property_count++;
+        }
+        EXPECT_EQ(property_count, property_map.size());
+
+        EXPECT_EQ(device.get_syspath(), String(device.get_syspath_view().data(), device.get_syspath_view().length()));
+        EXPECT_EQ(device.get_subsystem_view(), "block");
+        EXPECT_EQ(device.get_property_value_view("SUBSYSTEM"), device.get_subsystem_view());
+    }
+}
+
+TEST(UDEV, monitor_run_and_stop_test)
+{
+    Context context{};
+    Monitor monitor{context, "udev"};
+    monitor.match_subsystem("block");
+    monitor.monitor();
+
+    // Nothing should be queued for a monitor that has just started listening, so these must not block.
+    (void)monitor.try_get_device();
+    (void)monitor.drain_devices();
+
+    std::thread stopper{[&monitor]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        monitor.stop();
+    }};
+
+    monitor.run([](Monitor::device_list_type & devices) {
+        EXPECT_FALSE(devices.empty());
+    });
+    stopper.join();
+}
+
+TEST(UDEV, monitor_filter_test)
+{
+    using namespace std::string_literals;
+
+    // A message in the format the kernel sends on the uevent socket.
+    auto message = "add@/devices/virtual/block/loop0\0ACTION=add\0DEVPATH=/devices/virtual/block/loop0\0"
+                   "SUBSYSTEM=block\0DEVTYPE=disk\0DEVNAME=loop0\0SEQNUM=42\0"s;
+
+    MonitorFilter filter{};
+    EXPECT_TRUE(filter.empty());
+    EXPECT_TRUE(filter.matches(message));
+
+    filter.match_subsystem_and_devtype("block", "disk");
+    filter.match_action("add");
+    filter.match_action("change");
+    filter.match_property("DEVNAME", "loop0");
+    filter.match_system_name("loop*");
+    EXPECT_FALSE(filter.empty());
+    EXPECT_TRUE(filter.matches(message));
+    EXPECT_FALSE(filter.compile().empty());
+
+    MonitorFilter remove_filter{};
+    remove_filter.match_action("remove");
+    EXPECT_FALSE(remove_filter.matches(message));
+
+    MonitorFilter property_filter{};
+    property_filter.match_property("DEVNAME", "loop1");
+    EXPECT_FALSE(property_filter.matches(message));
+
+    MonitorFilter name_filter{};
+    name_filter.match_system_name("sd*");
+    EXPECT_FALSE(name_filter.matches(message));
+
+    EXPECT_FALSE(filter.matches("not a uevent"));
+
+    Context context{};
+    Monitor monitor{context, "udev"};
+    monitor.set_filter(filter);
+    monitor.monitor();
+    (void)monitor.try_get_device();
+    EXPECT_EQ(monitor.get_filtered_message_count(), size_t{0});
+    monitor.remove_filter();
+}
+
+TEST(UDEV, monitor_coalescer_test)
+{
+    using namespace std::chrono_literals;
+
+    Context context{};
+    Query query{context};
+
+    query.match_subsystem("block");
+    auto query_results = query.run();
+
+    MonitorCoalescer coalescer{50ms};
+    auto start = MonitorCoalescer::clock_type::now();
+    for (auto & path : query_results)
+    {
+        coalescer.add(Device{context, path}, start);
+        coalescer.add(Device{context, path}, start + 10ms);
+    }
+
+    EXPECT_EQ(coalescer.get_received_count(), query_results.size() * 2);
+    EXPECT_EQ(coalescer.get_pending_count(), query_results.size());
+    EXPECT_TRUE(coalescer.take_ready(start + 40ms).empty());
+
+    auto events = coalescer.take_ready(start + 60ms);
+    EXPECT_EQ(events.size(), query_results.size());
+    for (auto & event : events)
+    {
+        EXPECT_EQ(event.event_count, size_t{2});
+        EXPECT_EQ(event.last_added - event.first_added, 10ms);
+    }
+    EXPECT_EQ(coalescer.get_delivered_count(), query_results.size());
+    EXPECT_EQ(coalescer.get_pending_count(), size_t{0});
+    EXPECT_FALSE(coalescer.time_until_ready(start + 60ms).has_value());
+}
+
+TEST(UDEV, parallel_query_test)
+{
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+    auto query_results = query.run();
+
+    Query parallel_source_query{context};
+    parallel_source_query.match_subsystem("block");
+    ParallelQuery::result_list_type results;
+    {
+        ParallelQuery parallel_query{context, 4, 2};
+        results = parallel_query.run(parallel_source_query);
+
+        // The workers reuse their contexts while the devices of the first run are still held.
+        auto second_results = parallel_query.run(parallel_source_query);
+        EXPECT_EQ(second_results.size(), results.size());
+    }
+
+    // The devices belong to the query's context, so they outlive the ParallelQuery.
+    ASSERT_EQ(results.size(), query_results.size());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        EXPECT_EQ(results[i].syspath, query_results[i]);
+        EXPECT_FALSE(results[i].error);
+        ASSERT_TRUE(results[i].device.has_value());
+        EXPECT_EQ(results[i].attributes.size(), results[i].device->load_attributes_from_sysfs().size());
+        (void)results[i].device->get_parent();
+    }
+
+    EXPECT_THROW(ParallelQuery(context, 1, 0), std::invalid_argument);
+}
+
+TEST(UDEV, query_device_range_test)
+{
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+    auto query_results = query.run();
+
+    size_t index{0};
+    for (Device & device : query.devices())
+    {
+        ASSERT_LT(index, query_results.size());
+        EXPECT_EQ(device.get_syspath(), query_results[index]);
+        EXPECT_EQ(device.get_subsystem_view(), "block");
+        index++;
+    }
+    EXPECT_EQ(index, query_results.size());
+
+    // Stopping early only creates the devices that were reached.
+    auto range = query.devices();
+    auto first = range.begin();
+    if (! query_results.empty())
+    {
+        ASSERT_TRUE(first != range.end());
+        EXPECT_EQ(first->get_syspath(), query_results.front());
+    }
+    else
+    {
+        EXPECT_TRUE(first == range.end());
+    }
+}
+
+TEST(UDEV, device_inventory_test)
+{
+    Context context{};
+    DeviceInventory inventory{};
+    inventory.set_attribute_keys({"size"});
+    inventory.build(context);
+
+    Query query{context};
+    EXPECT_EQ(inventory.size(), query.run().size());
+
+    Query block_query{context};
+    block_query.match_subsystem("block");
+    auto block_results = block_query.run();
+    auto block_records = inventory.find_by_subsystem("block");
+    ASSERT_EQ(block_records.size(), block_results.size());
+    for (size_t i = 0; i < block_records.size(); i++)
+    {
+        EXPECT_EQ(block_records[i]->syspath, block_results[i]);
+        EXPECT_EQ(inventory.find_by_devnum('b', block_records[i]->devnum), block_records[i]);
+    }
+
+    auto snapshot_path = String{::testing::TempDir().c_str()} + "udev_inventory_test.snapshot";
+    inventory.save(snapshot_path);
+
+    DeviceInventory loaded_inventory{};
+    EXPECT_FALSE(loaded_inventory.load(snapshot_path));
+    loaded_inventory.set_attribute_keys({"size"});
+    ASSERT_TRUE(loaded_inventory.load(snapshot_path));
+    ASSERT_EQ(loaded_inventory.size(), inventory.size());
+    for (auto record : inventory.get_records())
+    {
+        auto loaded_record = loaded_inventory.find(record->syspath);
+        ASSERT_TRUE(loaded_record != nullptr);
+        EXPECT_EQ(loaded_record->properties, record->properties);
+        EXPECT_EQ(loaded_record->attributes, record->attributes);
+        EXPECT_EQ(loaded_record->parent_syspath, record->parent_syspath);
+        EXPECT_EQ(loaded_record->devnum, record->devnum);
+    }
+
+    auto statistics = loaded_inventory.refresh(context);
+    EXPECT_EQ(statistics.added, size_t{0});
+    EXPECT_EQ(statistics.removed, size_t{0});
+    EXPECT_EQ(statistics.unchanged + statistics.updated, inventory.size());
+    (void)std::remove(snapshot_path.stlString().c_str());
+}
+
+TEST(UDEV, device_inventory_index_test)
+{
+    Context context{};
+    DeviceInventory inventory{};
+    inventory.build(context);
+
+    for (auto record : inventory.get_records())
+    {
+        auto parent = inventory.find(record->parent_syspath);
+        if (parent != nullptr)
+        {
+            EXPECT_EQ(inventory.find_parent(record->syspath), parent);
+            EXPECT_EQ(inventory.find_ancestor(record->syspath, parent->subsystem, parent->devtype)->subsystem,
+                      parent->subsystem);
+            auto children = inventory.find_children(parent->syspath);
+            EXPECT_TRUE(std::find(children.begin(), children.end(), record) != children.end());
+        }
+
+        auto devname = record->properties.find("DEVNAME");
+        if (devname != record->properties.end())
+        {
+            auto records = inventory.find_by_property("DEVNAME", devname->second);
+            ASSERT_EQ(records.size(), size_t{1});
+            EXPECT_EQ(records.front(), record);
+        }
+    }
+    EXPECT_TRUE(inventory.find_parent("/sys") == nullptr);
+
+    Monitor monitor{context, "udev"};
+    monitor.monitor();
+    auto size = inventory.size();
+    EXPECT_EQ(inventory.update(monitor), size_t{0});
+    EXPECT_EQ(inventory.size(), size);
+}
+
+TEST(UDEV, compact_property_map_test)
+{
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+    auto query_results = query.run();
+
+    auto & pool = context.get_string_pool();
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+
+        auto property_map = device.get_properties();
+        auto compact_map = device.get_compact_properties(pool);
+        EXPECT_EQ(compact_map.size(), property_map.size());
+        EXPECT_EQ(compact_map.to_map(), property_map);
+        for (auto & [name, value] : property_map)
+        {
+            auto compact_value = compact_map.find(name.stlString());
+            ASSERT_TRUE(compact_value.has_value());
+            EXPECT_EQ(String(compact_value->data(), compact_value->length()), value);
+        }
+        EXPECT_FALSE(compact_map.contains("NOT_A_PROPERTY"));
+        EXPECT_EQ(compact_map.find("SUBSYSTEM"), std::optional<std::string_view>{"block"});
+    }
+
+    // Interning a string twice returns the same id.
+    auto id = pool.intern("SUBSYSTEM");
+    EXPECT_EQ(pool.intern("SUBSYSTEM"), id);
+    EXPECT_EQ(pool.view(id), "SUBSYSTEM");
+    EXPECT_EQ(pool.intern(""), StringPool::id_type{0});
+}
+
+TEST(UDEV, device_tree_test)
+{
+    Context context{};
+    DeviceTree tree{context};
+
+    Query query{context};
+    auto query_results = query.run();
+    EXPECT_GE(tree.size(), query_results.size());
+
+    size_t visited{0};
+    tree.visit_depth_first([&tree, &visited](const DeviceTreeNode & node) {
+        EXPECT_EQ(tree.find(node.syspath), &node);
+        EXPECT_EQ(node.device.get_syspath(), node.syspath);
+        EXPECT_EQ(node.device.get_subsystem(), node.subsystem);
+        EXPECT_EQ(node.device.get_devtype(), node.devtype);
+        if (node.parent != nullptr)
+        {
+            EXPECT_EQ(node.depth, node.parent->depth + 1);
+            EXPECT_EQ(node.syspath.stlString().rfind(node.parent->syspath.stlString() + "/", 0), size_t{0});
+        }
+        else
+        {
+            EXPECT_EQ(node.depth, size_t{0});
+        }
+        visited++;
+        return true;
+    });
+    EXPECT_EQ(visited, tree.size());
+
+    Query block_query{context};
+    block_query.match_subsystem("block");
+    for (auto & path : block_query.run())
+    {
+        auto node = tree.find(path);
+        ASSERT_TRUE(node != nullptr);
+        for (auto partition : tree.find_descendants(*node, "block", "partition"))
+        {
+            EXPECT_EQ(DeviceTree::find_ancestor(*partition, "block", "disk"), node);
+        }
+    }
+
+    // Breadth first visits never go back up in depth, and returning false prunes the subtree.
+    for (auto root : tree.get_roots())
+    {
+        size_t depth{0};
+        tree.visit_breadth_first(*root, [&depth](const DeviceTreeNode & node) {
+            EXPECT_GE(node.depth, depth);
+            depth = node.depth;
+            return true;
+        });
+
+        size_t pruned_count{0};
+        tree.visit_depth_first(*root, [&pruned_count](const DeviceTreeNode &) {
+            pruned_count++;
+            return false;
+        });
+        EXPECT_EQ(pruned_count, size_t{1});
+    }
+
+    // The queries only read the copies in the nodes, so several threads may run them at once.
+    auto count_block_devices = [&tree]() {
+        size_t count{0};
+        for (auto root : tree.get_roots())
+        {
+            count += tree.find_descendants(*root, "block").size();
+        }
+        return count;
+    };
+    size_t first_count{0};
+    size_t second_count{0};
+    std::thread first_reader{[&]() {
+        first_count = count_block_devices();
+    }};
+    std::thread second_reader{[&]() {
+        second_count = count_block_devices();
+    }};
+    first_reader.join();
+    second_reader.join();
+    EXPECT_EQ(first_count, second_count);
+}
+
+TEST(UDEV, attribute_writer_test)
+{
+    EXPECT_TRUE(AttributeWriter::value_matches("128\n", "128"));
+    EXPECT_TRUE(AttributeWriter::value_matches("mq-deadline [none] kyber", "none"));
+    EXPECT_FALSE(AttributeWriter::value_matches("mq-deadline [none] kyber", "kyber"));
+    EXPECT_FALSE(AttributeWriter::value_matches("128", "256"));
+
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+    auto query_results = query.run();
+
+    // Writing the values the devices already have must not write anything.
+    AttributeWriter::request_list_type requests;
+    for (auto & path : query_results)
+    {
+        Device device{context, path};
+        auto read_ahead = device.get_system_attribute_view("queue/read_ahead_kb");
+        if (! read_ahead.empty())
+        {
+            requests.push_back({path, "queue/read_ahead_kb", String{read_ahead.data(), read_ahead.length()}});
+        }
+    }
+    requests.push_back({"/sys/devices/not_a_device", "queue/read_ahead_kb", "128"});
+
+    AttributeWriter writer{context, 4};
+    auto report = writer.apply(requests);
+    ASSERT_EQ(report.results.size(), requests.size());
+    EXPECT_EQ(report.written, size_t{0});
+    EXPECT_EQ(report.unchanged, requests.size() - 1);
+    EXPECT_EQ(report.failed, size_t{1});
+    EXPECT_EQ(report.results.back().status, AttributeWriter::Status::FAILED);
+    EXPECT_TRUE(report.results.back().error);
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        EXPECT_EQ(report.results[i].request.syspath, requests[i].syspath);
+    }
+}
+
+TEST(UDEV, context_pool_test)
+{
+    // Copies share the udev object and the shared caches.
+    Context context{};
+    Context context_copy{context};
+    EXPECT_EQ(&context_copy.get_attribute_cache(), &context.get_attribute_cache());
+    EXPECT_EQ(&context_copy.get_string_pool(), &context.get_string_pool());
+    {
+        Monitor monitor{context, "udev"};
+        auto monitor_context = monitor.get_context();
+        EXPECT_EQ(&monitor_context.get_attribute_cache(), &context.get_attribute_cache());
+        Query query{monitor_context};
+        EXPECT_FALSE(query.run().empty());
+    }
+
+    ContextPool pool{2};
+    Query query{context};
+    auto expected_count = query.run().size();
+
+    std::vector<std::thread> threads;
+    std::vector<size_t> counts(4, 0);
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        threads.emplace_back([&pool, &counts, i]() {
+            auto handle = pool.acquire();
+            Query thread_query{*handle};
+            for (Device & device : thread_query.devices())
+            {
+                (void)device.get_properties();
+                counts[i]++;
+            }
+        });
+    }
+    for (auto & thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto count : counts)
+    {
+        EXPECT_EQ(count, expected_count);
+    }
+    EXPECT_LE(pool.get_context_count(), size_t{2});
+    EXPECT_EQ(pool.get_idle_count(), pool.get_context_count());
+
+    auto first = pool.acquire();
+    auto second = pool.acquire();
+    EXPECT_NE(&first.get(), &second.get());
+    EXPECT_FALSE(pool.try_acquire().has_value());
+    EXPECT_EQ(&first->get_attribute_cache(), &pool.get_attribute_cache());
+
+    // A pool made from a context shares its caches but not its udev object.
+    ContextPool sharing_pool{context, 1};
+    EXPECT_EQ(&sharing_pool.get_attribute_cache(), &context.get_attribute_cache());
+    EXPECT_EQ(&sharing_pool.get_string_pool(), &context.get_string_pool());
+    auto shared = sharing_pool.acquire();
+    EXPECT_NE(&shared.get(), &context);
+    EXPECT_EQ(&shared->get_attribute_cache(), &context.get_attribute_cache());
+}
+
+TEST(UDEV, event_replay_test)
+{
+    using namespace std::chrono_literals;
+
+    Context context{};
+    Query query{context};
+    query.match_subsystem("block");
+
+    // Record an event for each block device as if it had just been added.
+    auto recording_path = String{::testing::TempDir().c_str()} + "udev_event_replay_test.recording";
+    std::vector<DeviceEvent> events;
+    {
+        EventRecorder recorder{recording_path};
+        auto start = DeviceEvent::clock_type::now();
+        for (Device & device : query.devices())
+        {
+            auto event = DeviceEvent::from_device(device);
+            event.action = "add";
+            event.seqnum = events.size() + 1;
+            event.received = start + std::chrono::milliseconds{events.size()};
+            recorder.record(event);
+            events.push_back(std::move(event));
+        }
+        EXPECT_EQ(recorder.get_event_count(), events.size());
+    }
+
+    EventReplayer replayer{recording_path};
+    ASSERT_EQ(replayer.get_events().size(), events.size());
+
+    int sockets[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets), 0);
+    SocketEventSource source{sockets[1]};
+    EXPECT_FALSE(source.try_get_event().has_value());
+
+    EventReplayer::Options options{};
+    options.mode = EventReplayer::Mode::BURST;
+    options.stamp_send_time = true;
+    std::thread sender{[&replayer, &options, &sockets]() {
+        (void)replayer.replay(sockets[0], options);
+    }};
+
+    for (auto & expected : events)
+    {
+        auto event = source.get_event(1000ms);
+        ASSERT_TRUE(event.has_value());
+        EXPECT_EQ(event->action, "add");
+        EXPECT_EQ(event->devpath, expected.devpath);
+        EXPECT_EQ(event->get_syspath(), expected.get_syspath());
+        EXPECT_EQ(event->subsystem, "block");
+        EXPECT_EQ(event->seqnum, expected.seqnum);
+        auto send_time = EventReplayer::get_send_time(*event);
+        ASSERT_TRUE(send_time.has_value());
+        EXPECT_LE(*send_time, event->received);
+    }
+    sender.join();
+    EXPECT_EQ(source.get_dropped_message_count(), size_t{0});
+
+    // Modes other than FIXED_RATE ignore events_per_second, so 0 is allowed there.
+    using namespace std::string_literals;
+    auto message = "change@/devices/virtual/block/loop0\0ACTION=change\0DEVPATH=/devices/virtual/block/loop0\0"s;
+    EventReplayer synthetic_replayer{EventReplayer::event_list_type{{0ns, message}}};
+    options.events_per_second = 0.0;
+    options.stamp_send_time = false;
+    EXPECT_EQ(synthetic_replayer.replay(sockets[0], options), size_t{1});
+    auto synthetic_event = source.get_event(1000ms);
+    ASSERT_TRUE(synthetic_event.has_value());
+    EXPECT_EQ(synthetic_event->action, "change");
+    options.mode = EventReplayer::Mode::FIXED_RATE;
+    EXPECT_THROW((void)synthetic_replayer.replay(sockets[0], options), std::invalid_argument);
+
+    // A stop issued before a replay starts is not lost, and only ends that replay.
+    options.mode = EventReplayer::Mode::BURST;
+    synthetic_replayer.stop();
+    EXPECT_EQ(synthetic_replayer.replay(sockets[0], options), size_t{0});
+    EXPECT_EQ(synthetic_replayer.replay(sockets[0], options), size_t{1});
+    EXPECT_TRUE(source.get_event(1000ms).has_value());
+
+    (void)close(sockets[0]);
+    (void)close(sockets[1]);
+    (void)std::remove(recording_path.stlString().c_str());
+
+    EXPECT_FALSE(DeviceEvent::parse("not a uevent").has_value());
+}
+
+namespace
+{
+    AsyncGenerator<int> count_to(int limit)
+    {
+        for (int i = 1; i <= limit; i++)
+        {
+            co_yield i;
+        }
+    }
+
+    DetachedTask sum_generator(AsyncGenerator<int> generator, int & sum, bool & finished)
+    {
+        while (auto value = co_await generator.next())
+        {
+            sum += *value;
+        }
+        finished = true;
+    }
+
+    DetachedTask wait_for_devices(AsyncMonitor & monitor, size_t & received, size_t & finished)
+    {
+        auto devices = monitor.devices();
+        while (auto device = co_await devices.next())
+        {
+            received++;
+        }
+        finished++;
+    }
+
+    DetachedTask wait_for_device(AsyncMonitor & monitor, std::optional<String> & sysname)
+    {
+        if (auto device = co_await monitor.next_event())
+        {
+            sysname = device->get_sysname();
+        }
+    }
+
+    DetachedTask collect_devices(AsyncMonitor & monitor, std::vector<String> & sysnames)
+    {
+        auto devices = monitor.devices();
+        while (auto device = co_await devices.next())
+        {
+            sysnames.push_back(device->get_sysname());
+        }
+    }
+
+    // Ask the kernel to send a change event for a device, which needs root.
+    bool trigger_change(const std::string & syspath)
+    {
+        auto file = std::fopen((syspath + "/uevent").c_str(), "w");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        auto written = std::fputs("change", file) >= 0;
+        return std::fclose(file) == 0 && written;
+    }
+} // namespace
+
+TEST(UDEV, async_monitor_test)
+{
+    using namespace std::chrono_literals;
+
+    int sum{0};
+    bool generator_finished{false};
+    sum_generator(count_to(4), sum, generator_finished);
+    EXPECT_EQ(sum, 10);
+    EXPECT_TRUE(generator_finished);
+
+    Context context{};
+    Monitor monitor{context, "udev"};
+    monitor.match_subsystem("block");
+    monitor.monitor();
+
+    Reactor reactor{};
+    AsyncMonitor async_monitor{monitor, reactor};
+
+    // Many coroutines can wait on one monitor without a thread each.
+    size_t received{0};
+    size_t finished{0};
+    for (size_t i = 0; i < 100; i++)
+    {
+        wait_for_devices(async_monitor, received, finished);
+    }
+    EXPECT_EQ(async_monitor.get_waiting_count(), size_t{100});
+    EXPECT_EQ(reactor.get_watch_count(), size_t{1});
+    (void)reactor.run_once(10ms);
+
+    async_monitor.cancel();
+    EXPECT_EQ(finished, size_t{100});
+    EXPECT_EQ(async_monitor.get_waiting_count(), size_t{0});
+    EXPECT_EQ(reactor.get_watch_count(), size_t{0});
+
+    std::thread stopper{[&reactor]() {
+        std::this_thread::sleep_for(50ms);
+        reactor.stop();
+    }};
+    reactor.run();
+    stopper.join();
+}
+
+TEST(UDEV, async_monitor_delivery_test)
+{
+    using namespace std::chrono_literals;
+
+    Context context{};
+    Monitor monitor{context, "kernel"};
+    monitor.match_subsystem("mem");
+    monitor.monitor();
+
+    Reactor reactor{};
+    AsyncMonitor async_monitor{monitor, reactor};
+
+    // Each device goes to the coroutine that has waited longest.
+    std::optional<String> first_sysname{};
+    std::optional<String> second_sysname{};
+    wait_for_device(async_monitor, first_sysname);
+    wait_for_device(async_monitor, second_sysname);
+    EXPECT_EQ(async_monitor.get_waiting_count(), size_t{2});
+
+    if (! trigger_change("/sys/devices/virtual/mem/null") || ! trigger_change("/sys/devices/virtual/mem/zero"))
+    {
+        async_monitor.cancel();
+        GTEST_SKIP() << "cannot trigger uevents";
+    }
+    for (size_t i = 0; i < 100 && ! second_sysname; i++)
+    {
+        (void)reactor.run_once(50ms);
+    }
+    if (! first_sysname)
+    {
+        async_monitor.cancel();
+        GTEST_SKIP() << "uevents are not delivered to this network namespace";
+    }
+    ASSERT_TRUE(second_sysname.has_value());
+    EXPECT_EQ(*first_sysname, "null");
+    EXPECT_EQ(*second_sysname, "zero");
+    EXPECT_EQ(async_monitor.get_waiting_count(), size_t{0});
+    EXPECT_EQ(reactor.get_watch_count(), size_t{0});
+
+    // The generator yields devices in the order they arrive until the monitor is cancelled.
+    std::vector<String> sysnames{};
+    collect_devices(async_monitor, sysnames);
+    ASSERT_TRUE(trigger_change("/sys/devices/virtual/mem/zero"));
+    ASSERT_TRUE(trigger_change("/sys/devices/virtual/mem/null"));
+    for (size_t i = 0; i < 100 && sysnames.size() < 2; i++)
+    {
+        (void)reactor.run_once(50ms);
+    }
+    async_monitor.cancel();
+    ASSERT_EQ(sysnames.size(), size_t{2});
+    EXPECT_EQ(sysnames[0], "zero");
+    EXPECT_EQ(sysnames[1], "null");
+}
+
+TEST(UDEV, monitor_statistics_test)
+{
+    using namespace std::chrono_literals;
+
+    LatencyHistogram histogram{};
+    EXPECT_EQ(histogram.percentile(50), 0ns);
+    EXPECT_EQ(LatencyHistogram::get_bucket(500ns), size_t{0});
+    EXPECT_EQ(LatencyHistogram::get_bucket(1us), size_t{1});
+    EXPECT_EQ(LatencyHistogram::get_bucket(3us), size_t{2});
+    EXPECT_EQ(LatencyHistogram::get_bucket(10000s), LatencyHistogram::BUCKET_COUNT - 1);
+    for (int i = 0; i < 99; i++)
+    {
+        histogram.add(3us);
+    }
+    histogram.add(10ms);
+    EXPECT_EQ(histogram.get_count(), uint64_t{100});
+    EXPECT_EQ(histogram.percentile(50), 4us);
+    EXPECT_EQ(histogram.percentile(100), 10ms);
+    EXPECT_EQ(histogram.get_max(), 10ms);
+
+    Context context{};
+    Monitor monitor{context, "udev"};
+    monitor.match_subsystem("block");
+    monitor.set_timing_enabled(true);
+    EXPECT_TRUE(monitor.get_timing_enabled());
+    monitor.monitor();
+
+    (void)monitor.drain_devices();
+    auto statistics = monitor.get_statistics();
+    EXPECT_EQ(statistics.buffer_overflows, size_t{0});
+    EXPECT_EQ(statistics.sequence_gaps, size_t{0});
+
+    // Resynchronizing enumerates the subsystems the monitor matches.
+    Query::string_list_type syspaths{};
+    monitor.set_resync_callback([&syspaths](Query::string_list_type & found) {
+        syspaths = found;
+    });
+    monitor.resync();
+    EXPECT_FALSE(syspaths.empty());
+    EXPECT_EQ(monitor.get_statistics().resyncs, size_t{1});
+
+    monitor.reset_statistics();
+    EXPECT_EQ(monitor.get_statistics().resyncs, size_t{0});
+    EXPECT_EQ(monitor.get_latency_histogram().get_count(), uint64_t{0});
+}
+
+TEST(UDEV, device_number_cache_test)
+{
+    struct stat null_stat{};
+    ASSERT_EQ(stat("/dev/null", &null_stat), 0);
+
+    Context context{};
+    DeviceNumberCache cache{context, 2};
+
+    auto device = cache.get_device('c', null_stat.st_rdev);
+    ASSERT_NE(device, nullptr);
+    EXPECT_EQ(device->get_devnum(), null_stat.st_rdev);
+    EXPECT_EQ(cache.get_device('c', null_stat.st_rdev), device);
+
+    auto attributes = cache.get_attributes('c', null_stat.st_rdev);
+    ASSERT_NE(attributes, nullptr);
+    EXPECT_EQ(attributes->count("dev"), size_t{1});
+    EXPECT_EQ(cache.get_attributes('c', null_stat.st_rdev), attributes);
+
+    // A number with no device is cached as well.
+    EXPECT_EQ(cache.get_device('b', 0), nullptr);
+    EXPECT_EQ(cache.get_device('b', 0), nullptr);
+
+    auto statistics = cache.get_statistics();
+    EXPECT_EQ(statistics.hits, size_t{4});
+    EXPECT_EQ(statistics.misses, size_t{2});
+
+    // The least recently used entry is dropped when the cache is full.
+    (void)cache.get_device('c', 0);
+    EXPECT_EQ(cache.size(), size_t{2});
+    EXPECT_EQ(cache.get_statistics().evictions, size_t{1});
+
+    cache.update(*device);
+    EXPECT_EQ(cache.get_statistics().invalidations, size_t{0});
+    (void)cache.get_device('c', null_stat.st_rdev);
+    cache.update(*device);
+    EXPECT_EQ(cache.get_statistics().invalidations, size_t{1});
+    EXPECT_EQ(cache.size(), size_t{1});
+}